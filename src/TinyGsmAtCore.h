@@ -0,0 +1,513 @@
+/**
+ * @file       TinyGsmAtCore.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * The part of the AT protocol that is the same for every modem: waiting for
+ * and matching the responses, reading numbers and text out of them and
+ * moving socket data.  Unlike the rest of the library it is a plain class,
+ * not a template, so there is a single copy of it in the program.  The
+ * drivers derive from it and handle their URC's in a handleURCs() they pass
+ * to it, see UrcHandler.
+ */
+
+#ifndef SRC_TINYGSMATCORE_H_
+#define SRC_TINYGSMATCORE_H_
+
+#include "TinyGsmCommon.h"
+
+// The line ending of the modem; a driver using another one defines it before
+// including the rest of the library
+#if !defined(GSM_NL)
+#define GSM_NL "\r\n"
+#endif
+
+static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
+static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
+#if defined       TINY_GSM_DEBUG
+static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
+static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#endif
+
+// A number taken a character at a time, as atoi() and atof() read one: blanks,
+// a sign, the digits and a decimal point, up to the first character that
+// can't be part of it.  It is kept as an integer, with the digits past the
+// decimals asked for dropped, so reading it needs no floating point and no
+// buffer.
+class TinyGsmNumber {
+ public:
+  explicit TinyGsmNumber(uint8_t decimals = 0)
+      : value(0),
+        decimals(decimals),
+        places(0),
+        state(BLANKS),
+        negative(false),
+        digits(false),
+        overflow(false),
+        cut(false) {}
+
+  void add(char c) {
+    if (state == BLANKS) {
+      if (isspace(static_cast<unsigned char>(c))) { return; }
+      state = WHOLE;
+      if (c == '-' || c == '+') {
+        negative = c == '-';
+        return;
+      }
+    }
+    if (c >= '0' && c <= '9' && state != DONE) {
+      int8_t digit = c - '0';
+      digits       = true;
+      if (state == FRACTION && places >= decimals) {
+        // Past the decimals kept
+      } else if (value > (INT32_MAX - digit) / 10) {
+        // Too many whole digits don't fit; a decimal that doesn't is dropped
+        // along with all the ones after it, which would otherwise take its
+        // place
+        if (state == WHOLE) {
+          overflow = true;
+        } else {
+          cut   = true;
+          state = DONE;
+        }
+      } else {
+        value = value * 10 + digit;
+        if (state == FRACTION) { places++; }
+      }
+    } else if (c == '.' && state == WHOLE) {
+      state = FRACTION;
+    } else {
+      state = DONE;
+    }
+  }
+
+  // The number times 10^decimals, false if there was none or it doesn't
+  // fit in an int32_t
+  bool get(int32_t& out) const {
+    if (!digits || overflow || cut) { return false; }
+    int32_t scaled = value;
+    for (uint8_t i = places; i < decimals; i++) {
+      if (scaled > INT32_MAX / 10) { return false; }
+      scaled *= 10;
+    }
+    out = negative ? -scaled : scaled;
+    return true;
+  }
+
+  // The number, with as many of its decimals as fit in an int32_t
+  bool get(float& out) const {
+    if (!digits || overflow) { return false; }
+    float divisor = 1;
+    for (uint8_t i = 0; i < places; i++) { divisor *= 10; }
+    out = (negative ? -static_cast<float>(value) : static_cast<float>(value)) /
+        divisor;
+    return true;
+  }
+
+ protected:
+  enum State : uint8_t { BLANKS, WHOLE, FRACTION, DONE };
+
+  int32_t value;     // The digits so far, without the point
+  uint8_t decimals;  // The decimals kept
+  uint8_t places;    // The decimals in value
+  State   state;
+  bool    negative;
+  bool    digits;    // Any were seen
+  bool    overflow;  // The whole part doesn't fit
+  bool    cut;       // Decimals asked for were dropped, as they didn't fit
+};
+
+class TinyGsmAtCore {
+ public:
+  // Called after each character read that ends none of the responses waited
+  // for, with the text read so far; the driver looks for its URC's at the
+  // end of it, and clears what it handled.  It is a plain function, not a
+  // virtual one, so the modem classes need no vtable.
+  typedef void (*UrcHandler)(TinyGsmAtCore& at, String& data);
+
+  explicit TinyGsmAtCore(Stream& stream, UrcHandler urcs = NULL)
+      : stream(stream), urcs(urcs) {}
+
+  /*
+   * Responses
+   */
+  // Waits up to timeout_ms for one of the responses and returns its number,
+  // 0 if none came; what was read is left in data
+  int8_t waitResponse(uint32_t timeout_ms, String& data,
+                      GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponses(timeout_ms, &data, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponses(timeout_ms, NULL, r1, r2, r3, r4, r5);
+  }
+
+  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+#if defined TINY_GSM_DEBUG
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+#else
+                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+#endif
+                      GsmConstStr r5 = NULL) {
+    return waitResponses(1000, NULL, r1, r2, r3, r4, r5);
+  }
+
+#if defined(TINY_GSM_STATS)
+  /*
+   * Instrumentation
+   */
+  TinyGsmStats& stats() {
+    return gsm_stats;
+  }
+#endif
+
+ public:
+  Stream& stream;
+
+ protected:
+  // The UrcHandler of a driver with a handleURCs(String&), which makes
+  // TinyGsmAtCore a friend for it
+  template <class modemType>
+  static void urcsOf(TinyGsmAtCore& at, String& data) {
+    static_cast<modemType&>(at).handleURCs(data);
+  }
+
+  // The matcher behind all of the waitResponse()'s; without data the text is
+  // kept in reply, and only as much of it as matching needs
+  int8_t waitResponses(uint32_t timeout_ms, String* out, GsmConstStr r1,
+                       GsmConstStr r2, GsmConstStr r3, GsmConstStr r4,
+                       GsmConstStr r5) {
+    /*String r1s(r1); r1s.trim();
+    String r2s(r2); r2s.trim();
+    String r3s(r3); r3s.trim();
+    String r4s(r4); r4s.trim();
+    String r5s(r5); r5s.trim();
+    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
+    String& data = out ? *out : reply;
+    if (!out) { reply = ""; }
+    uint8_t  index       = 0;
+    size_t   dropped     = 0;  // Bytes of reply let go, for the statistics
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    do {
+      TINY_GSM_YIELD();
+      while (stream.available() > 0) {
+        TINY_GSM_YIELD();
+        int8_t a = stream.read();
+        TINY_GSM_STAT(parsed(1));
+        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
+        data += static_cast<char>(a);
+        if (r1 && TinyGsmEndsWith(data, r1)) {
+          index = 1;
+          goto finish;
+        } else if (r2 && TinyGsmEndsWith(data, r2)) {
+          index = 2;
+          goto finish;
+        } else if (r3 && TinyGsmEndsWith(data, r3)) {
+#if defined TINY_GSM_DEBUG
+          if (r3 == GFP(GSM_CME_ERROR)) {
+            streamSkipUntil('\n');  // Read out the error
+          }
+#endif
+          index = 3;
+          goto finish;
+        } else if (r4 && TinyGsmEndsWith(data, r4)) {
+          index = 4;
+          goto finish;
+        } else if (r5 && TinyGsmEndsWith(data, r5)) {
+          index = 5;
+          goto finish;
+        } else {
+          if (urcs) { urcs(*this, data); }
+          // The responses and URC's all end with the line they are on, so
+          // reply only keeps the line ending before it once it grows long
+          if (!out && a == '\n' && data.length() > 64) {
+            dropped += data.length() - 2;
+            data = GSM_NL;
+          }
+        }
+      }
+    } while (TINY_GSM_MILLIS() - startMillis < timeout_ms);
+  finish:
+    if (!index) {
+      data.trim();
+      TINY_GSM_STAT(unhandled(data.length() + dropped));
+      if (data.length()) { DBG("### Unhandled:", data); }
+      data = "";
+    }
+    // data.replace(GSM_NL, "/");
+    // DBG('<', index, '>', data);
+    TINY_GSM_STAT(response(index, r1 != NULL));
+    return index;
+  }
+
+  /*
+   * Scanners
+   */
+  bool streamGetLength(char* buf, int8_t numChars,
+                       const uint32_t timeout_ms = 1000L) {
+    if (!buf) { return false; }
+
+    int8_t   numCharsReady = -1;
+    uint32_t startMillis   = TINY_GSM_MILLIS();
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms &&
+           (numCharsReady = stream.available()) < numChars) {
+      TINY_GSM_YIELD();
+    }
+
+    if (numCharsReady >= numChars) {
+      stream.readBytes(buf, numChars);
+      TINY_GSM_STAT(parsed(numChars));
+      return true;
+    }
+
+    return false;
+  }
+
+  // Reads numChars characters, once they are all there, as a number
+  bool streamGetNumberLength(TinyGsmNumber& number, int8_t numChars,
+                             const uint32_t timeout_ms = 1000L) {
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms &&
+           stream.available() < numChars) {
+      TINY_GSM_YIELD();
+    }
+    if (stream.available() < numChars) { return false; }
+    for (int8_t i = 0; i < numChars; i++) { number.add(stream.read()); }
+    TINY_GSM_STAT(parsed(numChars));
+    return true;
+  }
+
+  // Reads a number of at most maxChars characters up to lastChar, which is
+  // consumed; false if there is none, or if it is longer, when the first
+  // maxChars + 1 characters are consumed
+  bool streamGetNumberBefore(TinyGsmNumber& number, char lastChar,
+                             uint8_t        maxChars,
+                             const uint32_t timeout_ms = 1000L) {
+    uint8_t  len         = 0;
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms) {
+      if (!stream.available()) {
+        TINY_GSM_YIELD();
+        continue;
+      }
+      char c = stream.read();
+      if (c == lastChar) {
+        TINY_GSM_STAT(parsed(len + 1));
+        return len > 0;
+      }
+      if (++len > maxChars) {
+        TINY_GSM_STAT(parsed(len));
+        return false;
+      }
+      number.add(c);
+      startMillis = TINY_GSM_MILLIS();
+    }
+    TINY_GSM_STAT(parsed(len));
+    return len > 0;
+  }
+
+  int16_t streamGetIntLength(int8_t         numChars,
+                             const uint32_t timeout_ms = 1000L) {
+    TinyGsmNumber number;
+    int32_t       res;
+    if (streamGetNumberLength(number, numChars, timeout_ms) &&
+        number.get(res) && res >= INT16_MIN && res <= INT16_MAX) {
+      return res;
+    }
+    return -9999;
+  }
+
+  int16_t streamGetIntBefore(char lastChar) {
+    TinyGsmNumber number;
+    int32_t       res;
+    if (streamGetNumberBefore(number, lastChar, 6) && number.get(res) &&
+        res >= INT16_MIN && res <= INT16_MAX) {
+      return res;
+    }
+    return -9999;
+  }
+
+  float streamGetFloatLength(int8_t         numChars,
+                             const uint32_t timeout_ms = 1000L) {
+    TinyGsmNumber number(9);
+    float         res;
+    if (streamGetNumberLength(number, numChars, timeout_ms) &&
+        number.get(res)) {
+      return res;
+    }
+    return -9999.0F;
+  }
+
+  float streamGetFloatBefore(char lastChar) {
+    TinyGsmNumber number(9);
+    float         res;
+    if (streamGetNumberBefore(number, lastChar, 15) && number.get(res)) {
+      return res;
+    }
+    return -9999.0F;
+  }
+
+  // Reads a decimal number up to lastChar as a fixed point one, times
+  // 10^decimals, ie volts as millivolts with 3, without going through a
+  // float; false if there is none or it doesn't fit
+  bool streamGetDecimalBefore(char lastChar, uint8_t decimals,
+                              int32_t& value) {
+    TinyGsmNumber number(decimals);
+    return streamGetNumberBefore(number, lastChar, 15) && number.get(value);
+  }
+
+  // Reads up to lastChar, which is consumed but not kept, into out, cut to
+  // cap - 1 characters, and returns the length; gives up once the modem has
+  // been quiet for timeout_ms, as Stream::readStringUntil() does
+  size_t streamGetStringBefore(char lastChar, char* out, size_t cap,
+                               const uint32_t timeout_ms = 1000L) {
+    size_t   len         = 0;
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms) {
+      if (!stream.available()) {
+        TINY_GSM_YIELD();
+        continue;
+      }
+      char c = stream.read();
+      TINY_GSM_STAT(parsed(1));
+      if (c == lastChar) { break; }
+      if (len + 1 < cap) { out[len++] = c; }
+      startMillis = TINY_GSM_MILLIS();
+    }
+    if (cap) { out[len] = '\0'; }
+    return len;
+  }
+
+  // Reads the lines of a response up to its final OK into out, trimmed,
+  // without the empty ones and with sep between them, cut to cap - 1
+  // characters.  False if the response ends in an error or doesn't end in
+  // timeout_ms.  As in waitResponse(), each line is shown to the driver's
+  // URC handling as it comes, and left out if it was one.
+  bool streamGetLines(char* out, size_t cap, const char* sep,
+                      const uint32_t timeout_ms) {
+    const size_t sep_len = strlen(sep);
+    size_t       len     = 0;  // The lines kept so far
+    size_t       line    = 0;  // Where the line being read goes
+    size_t       pos     = 0;  // Where its next character goes
+    char         head[12];     // Its start, to spot the end of the response
+    uint8_t      head_len    = 0;
+    uint32_t     startMillis = TINY_GSM_MILLIS();
+    out[0]                   = '\0';
+    reply                    = GSM_NL;  // The line, as the URC handler sees it
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms) {
+      if (!stream.available()) {
+        TINY_GSM_YIELD();
+        continue;
+      }
+      char c = stream.read();
+      TINY_GSM_STAT(parsed(1));
+      if (c != '\n') {
+        if (head_len + 1u < sizeof(head)) { head[head_len++] = c; }
+        if (pos + 1 < cap) { out[pos++] = c; }
+        reply += c;
+        if (urcs) { urcs(*this, reply); }
+        if (!reply.length()) {
+          // The driver read out a URC, the line was not the response's
+          pos      = line;
+          head_len = 0;
+          reply    = GSM_NL;
+        }
+        continue;
+      }
+      reply          = GSM_NL;
+      head[head_len] = '\0';
+      head_len       = 0;
+      TinyGsmTrim(head);
+      if (!strcmp(head, "OK") || !strcmp(head, "ERROR") ||
+          !strncmp(head, "+CME ERROR", 10)) {
+        out[len] = '\0';
+        return head[0] == 'O';
+      }
+      out[pos]  = '\0';
+      size_t n  = line < pos ? TinyGsmTrim(out + line) : 0;
+      if (n) {
+        // Puts the separator in the room left for it
+        for (size_t i = len; i < line; i++) { out[i] = sep[i - len]; }
+        len = line + n;
+      }
+      out[len] = '\0';
+      line     = len ? TinyGsmMin(len + sep_len, cap - 1) : 0;
+      pos      = line;
+    }
+    out[len] = '\0';
+    return false;
+  }
+
+  bool streamSkipUntil(const char c, const uint32_t timeout_ms = 1000L) {
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (TINY_GSM_MILLIS() - startMillis < timeout_ms) {
+      while (TINY_GSM_MILLIS() - startMillis < timeout_ms &&
+             !stream.available()) {
+        TINY_GSM_YIELD();
+      }
+      TINY_GSM_STAT(parsed(1));
+      if (stream.read() == c) { return true; }
+    }
+    return false;
+  }
+
+  /*
+   * Socket data
+   */
+  // Reads len bytes of socket data into buf, as much as is there at a time,
+  // and returns how many were read; stops early once the modem has been
+  // quiet for timeout_ms.  With no buf the bytes are read and dropped.
+  size_t streamGetPayload(uint8_t* buf, size_t len, uint32_t timeout_ms) {
+    size_t   got         = 0;
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (got < len) {
+      int avail = stream.available();
+      if (avail <= 0) {
+        if (TINY_GSM_MILLIS() - startMillis >= timeout_ms) { break; }
+        TINY_GSM_YIELD();
+        continue;
+      }
+      if (buf) {
+        size_t n = TinyGsmMin(static_cast<size_t>(avail), len - got);
+        got += stream.readBytes(reinterpret_cast<char*>(buf) + got, n);
+      } else {
+        stream.read();
+        got++;
+      }
+      startMillis = TINY_GSM_MILLIS();
+    }
+    TINY_GSM_STAT(payload(got));
+    return got;
+  }
+
+  UrcHandler urcs;  // The driver's, set by its constructor; NULL for none
+  // The text being matched, when the caller keeps none; one String for all
+  // the waits, so they don't each make and free one
+  String reply;
+
+#if defined(TINY_GSM_STATS)
+  TinyGsmStats gsm_stats;
+#endif
+};
+
+#endif  // SRC_TINYGSMATCORE_H_
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(BATTERY)
 #define TINY_GSM_MODEM_HAS_BATTERY
+#endif
 
 template <class modemType>
 class TinyGsmBattery {
@@ -20,16 +22,20 @@ class TinyGsmBattery {
    * Battery functions
    */
   uint16_t getBattVoltage() {
+    TINY_GSM_STACK_CALL("getBattVoltage");
     return thisModem().getBattVoltageImpl();
   }
   int8_t getBattPercent() {
+    TINY_GSM_STACK_CALL("getBattPercent");
     return thisModem().getBattPercentImpl();
   }
   uint8_t getBattChargeState() {
+    TINY_GSM_STACK_CALL("getBattChargeState");
     return thisModem().getBattChargeStateImpl();
   }
   bool getBattStats(uint8_t& chargeState, int8_t& percent,
                     uint16_t& milliVolts) {
+    TINY_GSM_STACK_CALL("getBattStats");
     return thisModem().getBattStatsImpl(chargeState, percent, milliVolts);
   }
 
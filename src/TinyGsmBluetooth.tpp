@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(BLUETOOTH)
 #define TINY_GSM_MODEM_HAS_BLUETOOTH
+#endif
 
 template <class modemType>
 class TinyGsmBluetooth {
@@ -20,15 +22,19 @@ class TinyGsmBluetooth {
    * Bluetooth functions
    */
   bool enableBluetooth() {
+    TINY_GSM_STACK_CALL("enableBluetooth");
     return thisModem().enableBluetoothImpl();
   }
   bool disableBluetooth() {
+    TINY_GSM_STACK_CALL("disableBluetooth");
     return thisModem().disableBluetoothImpl();
   }
   bool setBluetoothVisibility(bool visible) {
+    TINY_GSM_STACK_CALL("setBluetoothVisibility");
     return thisModem().setBluetoothVisibilityImpl(visible);
   }
   bool setBluetoothHostName(const char* name) {
+    TINY_GSM_STACK_CALL("setBluetoothHostName");
 	return thisModem().setBluetoothHostNameImpl(name);
   }
   
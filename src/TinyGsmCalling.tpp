@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(CALLING)
 #define TINY_GSM_MODEM_HAS_CALLING
+#endif
 
 template <class modemType>
 class TinyGsmCalling {
@@ -20,15 +22,19 @@ class TinyGsmCalling {
    * Phone Call functions
    */
   bool callAnswer() {
+    TINY_GSM_STACK_CALL("callAnswer");
     return thisModem().callAnswerImpl();
   }
   bool callNumber(const String& number) {
+    TINY_GSM_STACK_CALL("callNumber");
     return thisModem().callNumberImpl(number);
   }
   bool callHangup() {
+    TINY_GSM_STACK_CALL("callHangup");
     return thisModem().callHangupImpl();
   }
   bool dtmfSend(char cmd, int duration_ms = 100) {
+    TINY_GSM_STACK_CALL("dtmfSend");
     return thisModem().dtmfSendImpl(cmd, duration_ms);
   }
 
@@ -12,107 +12,185 @@
 #if defined(TINY_GSM_MODEM_SIM800)
 #include "TinyGsmClientSIM800.h"
 typedef TinyGsmSim800                        TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim800::GsmClientSim800       TinyGsmClient;
+typedef TinyGsmSim800::GsmServer             TinyGsmServer;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSim800::GsmClientSecureSim800 TinyGsmClientSecure;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmSim800::GsmUDP                TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM808) || defined(TINY_GSM_MODEM_SIM868)
 #include "TinyGsmClientSIM808.h"
 typedef TinyGsmSim808                        TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim808::GsmClientSim800       TinyGsmClient;
+typedef TinyGsmSim808::GsmServer             TinyGsmServer;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSim808::GsmClientSecureSim800 TinyGsmClientSecure;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmSim808::GsmUDP                TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM900)
 #include "TinyGsmClientSIM800.h"
 typedef TinyGsmSim800                  TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim800::GsmClientSim800 TinyGsmClient;
+typedef TinyGsmSim800::GsmServer       TinyGsmServer;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmSim800::GsmUDP          TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM7000)
 #include "TinyGsmClientSIM7000.h"
 typedef TinyGsmSim7000                   TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim7000::GsmClientSim7000 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM7000SSL)
 #include "TinyGsmClientSIM7000SSL.h"
 typedef TinyGsmSim7000SSL                            TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim7000SSL::GsmClientSim7000SSL       TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSim7000SSL::GsmClientSecureSIM7000SSL TinyGsmClientSecure;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM7070) || defined(TINY_GSM_MODEM_SIM7080) || \
     defined(TINY_GSM_MODEM_SIM7090)
 #include "TinyGsmClientSIM7080.h"
 typedef TinyGsmSim7080                         TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim7080::GsmClientSim7080       TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSim7080::GsmClientSecureSIM7080 TinyGsmClientSecure;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmSim7080::GsmUDP                 TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM5320) || defined(TINY_GSM_MODEM_SIM5360) || \
     defined(TINY_GSM_MODEM_SIM5300) || defined(TINY_GSM_MODEM_SIM7100)
 #include "TinyGsmClientSIM5360.h"
 typedef TinyGsmSim5360                   TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim5360::GsmClientSim5360 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SIM7600) || defined(TINY_GSM_MODEM_SIM7800) || \
     defined(TINY_GSM_MODEM_SIM7500)
 #include "TinyGsmClientSIM7600.h"
 typedef TinyGsmSim7600                   TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSim7600::GsmClientSim7600 TinyGsmClient;
+typedef TinyGsmSim7600::GsmServer        TinyGsmServer;
+#endif
 
 #elif defined(TINY_GSM_MODEM_UBLOX)
 #include "TinyGsmClientUBLOX.h"
 typedef TinyGsmUBLOX                       TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmUBLOX::GsmClientUBLOX       TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmUBLOX::GsmClientSecureUBLOX TinyGsmClientSecure;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SARAR4)
 #include "TinyGsmClientSaraR4.h"
 typedef TinyGsmSaraR4                    TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSaraR4::GsmClientSaraR4   TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSaraR4::GsmClientSecureR4 TinyGsmClientSecure;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmSaraR4::GsmUDP            TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_M95)
 #include "TinyGsmClientM95.h"
 typedef TinyGsmM95               TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmM95::GsmClientM95 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_BG96)
 #include "TinyGsmClientBG96.h"
 typedef TinyGsmBG96                TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmBG96::GsmClientBG96 TinyGsmClient;
+typedef TinyGsmBG96::GsmServer     TinyGsmServer;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+typedef TinyGsmBG96::GsmUDP        TinyGsmUdp;
+#endif
 
 #elif defined(TINY_GSM_MODEM_A6) || defined(TINY_GSM_MODEM_A7)
 #include "TinyGsmClientA6.h"
 typedef TinyGsmA6              TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmA6::GsmClientA6 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_M590)
 #include "TinyGsmClientM590.h"
 typedef TinyGsmM590                TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmM590::GsmClientM590 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_MC60) || defined(TINY_GSM_MODEM_MC60E)
 #include "TinyGsmClientMC60.h"
 typedef TinyGsmMC60                TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmMC60::GsmClientMC60 TinyGsmClient;
+#endif
 
 #elif defined(TINY_GSM_MODEM_ESP8266)
 #define TINY_GSM_MODEM_HAS_WIFI
 #include "TinyGsmClientESP8266.h"
 typedef TinyGsmESP8266                         TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmESP8266::GsmClientESP8266       TinyGsmClient;
+typedef TinyGsmESP8266::GsmServer              TinyGsmServer;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmESP8266::GsmClientSecureESP8266 TinyGsmClientSecure;
+#endif
 
 #elif defined(TINY_GSM_MODEM_XBEE)
 #define TINY_GSM_MODEM_HAS_WIFI
 #include "TinyGsmClientXBee.h"
 typedef TinyGsmXBee                      TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmXBee::GsmClientXBee       TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmXBee::GsmClientSecureXBee TinyGsmClientSecure;
+#endif
 
 #elif defined(TINY_GSM_MODEM_SEQUANS_MONARCH)
 #include "TinyGsmClientSequansMonarch.h"
 typedef TinyGsmSequansMonarch                          TinyGsm;
+#if defined(TINY_GSM_MODEM_HAS_TCP)
 typedef TinyGsmSequansMonarch::GsmClientSequansMonarch TinyGsmClient;
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SSL)
 typedef TinyGsmSequansMonarch::GsmClientSecureSequansMonarch
     TinyGsmClientSecure;
+#endif
 
 #else
 #error "Please define GSM modem model"
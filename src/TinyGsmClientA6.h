@@ -23,14 +23,6 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -41,13 +33,25 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
-                  public TinyGsmGPRS<TinyGsmA6>,
+class TinyGsmA6 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                   public TinyGsmTCP<TinyGsmA6, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(CALLING)
                   public TinyGsmCalling<TinyGsmA6>,
+#endif
+#if TINY_GSM_USES(SMS)
                   public TinyGsmSMS<TinyGsmA6>,
+#endif
+#if TINY_GSM_USES(TIME)
                   public TinyGsmTime<TinyGsmA6>,
-                  public TinyGsmBattery<TinyGsmA6> {
+#endif
+#if TINY_GSM_USES(BATTERY)
+                  public TinyGsmBattery<TinyGsmA6>,
+#endif
+                  public TinyGsmModem<TinyGsmA6>,
+                  public TinyGsmGPRS<TinyGsmA6> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmA6>;
   friend class TinyGsmGPRS<TinyGsmA6>;
   friend class TinyGsmTCP<TinyGsmA6, TINY_GSM_MUX_COUNT>;
@@ -56,6 +60,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
   friend class TinyGsmTime<TinyGsmA6>;
   friend class TinyGsmBattery<TinyGsmA6>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -80,6 +85,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -94,6 +100,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       TINY_GSM_YIELD();
       at->sendAT(GF("+CIPCLOSE="), mux);
       sock_connected = false;
@@ -110,6 +117,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
   /*
    * Inner Secure Client
@@ -121,8 +129,11 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
    * Constructor
    */
  public:
-  explicit TinyGsmA6(Stream& stream) : stream(stream) {
+  explicit TinyGsmA6(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmA6>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -179,7 +190,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
   bool restartImpl(const char* pin = NULL) {
     if (!testAT()) { return false; }
     sendAT(GF("+RST=1"));
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return init(pin);
   }
 
@@ -208,14 +219,10 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     return (s == REG_OK_HOME || s == REG_OK_ROAMING);
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+CIFSR"));
-    String res;
-    if (waitResponse(10000L, res) != 1) { return ""; }
-    res.replace(GSM_NL "OK" GSM_NL, "");
-    res.replace(GSM_NL, "");
-    res.trim();
-    return res;
+    if (!streamGetLines(out, cap, "", 10000L)) { return 0; }
+    return strlen(out);
   }
 
   /*
@@ -261,31 +268,31 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     return false;
   }
 
-  String getOperatorImpl() {
+  size_t getOperatorImpl(char* out, size_t cap) {
     sendAT(GF("+COPS=3,0"));  // Set format
     waitResponse();
 
     sendAT(GF("+COPS?"));
-    if (waitResponse(GF(GSM_NL "+COPS:")) != 1) { return ""; }
+    if (waitResponse(GF(GSM_NL "+COPS:")) != 1) { return 0; }
     streamSkipUntil('"');  // Skip mode and format
-    String res = stream.readStringUntil('"');
+    size_t len = streamGetStringBefore('"', out, cap);
     waitResponse();
-    return res;
+    return len;
   }
 
   /*
    * SIM card functions
    */
  protected:
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+CCID"));
-    if (waitResponse(GF(GSM_NL "+SCID: SIM Card ID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+SCID: SIM Card ID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
+#if TINY_GSM_USES(CALLING)
   /*
    * Phone Call functions
    */
@@ -326,11 +333,12 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
 
     sendAT(GF("+VTS="), cmd);
     if (waitResponse(10000L) == 1) {
-      delay(duration_ms);
+      TINY_GSM_DELAY(duration_ms);
       return true;
     }
     return false;
   }
+#endif
 
   /*
    * Audio functions
@@ -351,31 +359,33 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     return waitResponse() == 1;
   }
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
  protected:
-  String sendUSSDImpl(const String& code) {
+  size_t sendUSSDImpl(const char* code, char* out, size_t cap) {
     sendAT(GF("+CMGF=1"));
     waitResponse();
     sendAT(GF("+CSCS=\"HEX\""));
     waitResponse();
     sendAT(GF("+CUSD=1,\""), code, GF("\",15"));
-    if (waitResponse(10000L) != 1) { return ""; }
-    if (waitResponse(GF(GSM_NL "+CUSD:")) != 1) { return ""; }
+    if (waitResponse(10000L) != 1) { return 0; }
+    if (waitResponse(GF(GSM_NL "+CUSD:")) != 1) { return 0; }
     streamSkipUntil('"');
-    String hex = stream.readStringUntil('"');
+    size_t len = streamGetStringBefore('"', out, cap);
     streamSkipUntil(',');
     int8_t dcs = streamGetIntBefore('\n');
 
     if (dcs == 15) {
-      return TinyGsmDecodeHex7bit(hex);
+      return TinyGsmDecodeHex7bit(out, len);
     } else if (dcs == 72) {
-      return TinyGsmDecodeHex16bit(hex);
+      return TinyGsmDecodeHex16bit(out, len, cap);
     } else {
-      return hex;
+      return len;
     }
   }
+#endif
 
   /*
    * Time functions
@@ -384,6 +394,7 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
   // Can follow the standard CCLK function in the template
   // Note - the clock probably has to be set manaually first
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -414,14 +425,16 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     waitResponse();
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
  protected:
   bool modemConnect(const char* host, uint16_t port, uint8_t* mux,
                     int timeout_s = 75) {
-    uint32_t startMillis = millis();
+    uint32_t startMillis = TINY_GSM_MILLIS();
     uint32_t timeout_ms  = ((uint32_t)timeout_s) * 1000;
 
     sendAT(GF("+CIPSTART="), GF("\"TCP"), GF("\",\""), host, GF("\","), port);
@@ -429,8 +442,9 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     int8_t newMux = streamGetIntBefore('\n');
 
     int8_t rsp = waitResponse(
-        (timeout_ms - (millis() - startMillis)), GF("CONNECT OK" GSM_NL),
-        GF("CONNECT FAIL" GSM_NL), GF("ALREADY CONNECT" GSM_NL));
+        (timeout_ms - (TINY_GSM_MILLIS() - startMillis)),
+        GF("CONNECT OK" GSM_NL), GF("CONNECT FAIL" GSM_NL),
+        GF("ALREADY CONNECT" GSM_NL));
     if (waitResponse() != 1) { return false; }
     *mux = newMux;
 
@@ -453,127 +467,47 @@ class TinyGsmA6 : public TinyGsmModem<TinyGsmA6>,
     waitResponse();
     return 1 == res;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+CIPRCV:"))) {
-          int8_t  mux      = streamGetIntBefore(',');
-          int16_t len      = streamGetIntBefore(',');
-          int16_t len_orig = len;
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            if (len > sockets[mux]->rx.free()) {
-              DBG("### Buffer overflow: ", len, "->", sockets[mux]->rx.free());
-            } else {
-              DBG("### Got: ", len, "->", sockets[mux]->rx.free());
-            }
-            while (len--) { moveCharFromStreamToFifo(mux); }
-            // TODO(?) Deal with missing characters
-            if (len_orig > sockets[mux]->available()) {
-              DBG("### Fewer characters received than expected: ",
-                  sockets[mux]->available(), " vs ", len_orig);
-            }
-          }
-          data = "";
-        } else if (data.endsWith(GF("+TCPCLOSED:"))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+CIPRCV:"))) {
+      int8_t  mux      = streamGetIntBefore(',');
+      int16_t len      = streamGetIntBefore(',');
+      int16_t len_orig = len;
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        if (len > sockets[mux]->rx.free()) {
+          DBG("### Buffer overflow: ", len, "->", sockets[mux]->rx.free());
+        } else {
+          DBG("### Got: ", len, "->", sockets[mux]->rx.free());
         }
+        moveStreamToFifo(mux, len);
+        // TODO(?) Deal with missing characters
+        if (len_orig > sockets[mux]->available()) {
+          DBG("### Fewer characters received than expected: ",
+              sockets[mux]->available(), " vs ", len_orig);
+        }
+      }
+      data = "";
+    } else if (TinyGsmEndsWith(data, GF("+TCPCLOSED:"))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
+      DBG("### Closed: ", mux);
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
   }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientA6* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*  gsmNL = GSM_NL;
 };
 
@@ -24,14 +24,13 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTemperature.tpp"
 #include "TinyGsmTime.tpp"
+#include "TinyGsmUDP.tpp"
 #include "TinyGsmNTP.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_SERVER
+#define TINY_GSM_MODEM_HAS_KEEPALIVE
+#define TINY_GSM_MODEM_HAS_DNS
 #endif
 
 enum RegStatus {
@@ -44,19 +43,41 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
-                    public TinyGsmGPRS<TinyGsmBG96>,
+class TinyGsmBG96 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                     public TinyGsmTCP<TinyGsmBG96, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(UDP)
+                    public TinyGsmUDP<TinyGsmBG96, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(CALLING)
                     public TinyGsmCalling<TinyGsmBG96>,
+#endif
+#if TINY_GSM_USES(SMS)
                     public TinyGsmSMS<TinyGsmBG96>,
+#endif
+#if TINY_GSM_USES(TIME)
                     public TinyGsmTime<TinyGsmBG96>,
+#endif
+#if TINY_GSM_USES(NTP)
                     public TinyGsmNTP<TinyGsmBG96>,
+#endif
+#if TINY_GSM_USES(GPS)
                     public TinyGsmGPS<TinyGsmBG96>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                     public TinyGsmBattery<TinyGsmBG96>,
-                    public TinyGsmTemperature<TinyGsmBG96> {
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
+                    public TinyGsmTemperature<TinyGsmBG96>,
+#endif
+                    public TinyGsmModem<TinyGsmBG96>,
+                    public TinyGsmGPRS<TinyGsmBG96> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmBG96>;
   friend class TinyGsmGPRS<TinyGsmBG96>;
   friend class TinyGsmTCP<TinyGsmBG96, TINY_GSM_MUX_COUNT>;
+  friend class TinyGsmUDP<TinyGsmBG96, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmCalling<TinyGsmBG96>;
   friend class TinyGsmSMS<TinyGsmBG96>;
   friend class TinyGsmTime<TinyGsmBG96>;
@@ -65,6 +86,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
   friend class TinyGsmBattery<TinyGsmBG96>;
   friend class TinyGsmTemperature<TinyGsmBG96>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -98,6 +120,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -107,11 +130,12 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
-      uint32_t startMillis = millis();
+      TINY_GSM_STACK_CALL("stop");
+      uint32_t startMillis = TINY_GSM_MILLIS();
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+QICLOSE="), mux);
       sock_connected = false;
-      at->waitResponse((maxWaitMs - (millis() - startMillis)));
+      at->waitResponse((maxWaitMs - (TINY_GSM_MILLIS() - startMillis)));
     }
     void stop() override {
       stop(15000L);
@@ -123,7 +147,9 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -141,6 +167,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
 
   public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -150,13 +177,20 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
   */
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmBG96(Stream& stream) : stream(stream) {
+  explicit TinyGsmBG96(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmBG96>;
     memset(sockets, 0, sizeof(sockets));
+    dnsResult = -1;
+    dnsTtl    = 0;
+    listeners = 0;
+#endif
   }
 
   /*
@@ -291,13 +325,12 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
    * SIM card functions
    */
  protected:
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+QCCID"));
-    if (waitResponse(GF(GSM_NL "+QCCID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+QCCID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -321,6 +354,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
   // commands.  As this is a separate paid service which I do not have access
   // to, I am not implementing it here.
 
+#if TINY_GSM_USES(GPS)
   /*
    * GPS/GNSS/GLONASS location functions
    */
@@ -339,13 +373,12 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
   }
 
   // get the RAW GPS output
-  String getGPSrawImpl() {
+  size_t getGPSrawImpl(char* out, size_t cap) {
     sendAT(GF("+QGPSLOC=2"));
-    if (waitResponse(10000L, GF(GSM_NL "+QGPSLOC:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(10000L, GF(GSM_NL "+QGPSLOC:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // get GPS informations
@@ -414,27 +447,30 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     waitResponse();  // Final OK
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TIME)
   /*
    * Time functions
    */
  protected:
-  String getGSMDateTimeImpl(TinyGSMDateTimeFormat format) {
+  size_t getGSMDateTimeImpl(TinyGSMDateTimeFormat format, char* out,
+                            size_t cap) {
     sendAT(GF("+QLTS=2"));
-    if (waitResponse(2000L, GF("+QLTS: \"")) != 1) { return ""; }
+    if (waitResponse(2000L, GF("+QLTS: \"")) != 1) { return 0; }
 
-    String res;
+    size_t len = 0;
 
     switch (format) {
-      case DATE_FULL: res = stream.readStringUntil('"'); break;
+      case DATE_FULL: len = streamGetStringBefore('"', out, cap); break;
       case DATE_TIME:
         streamSkipUntil(',');
-        res = stream.readStringUntil('"');
+        len = streamGetStringBefore('"', out, cap);
         break;
-      case DATE_DATE: res = stream.readStringUntil(','); break;
+      case DATE_DATE: len = streamGetStringBefore(',', out, cap); break;
     }
     waitResponse();  // Ends with OK
-    return res;
+    return len;
   }
 
   // The BG96 returns UTC time instead of local time as other modules do in
@@ -479,7 +515,9 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     waitResponse();  // Ends with OK
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(NTP)
   /*
    * NTP server functions
    */
@@ -500,6 +538,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
   }
 
   String ShowNTPErrorImpl(byte error) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+#endif
 
   /*
    * Battery functions
@@ -507,6 +546,7 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
  protected:
   // Can follow CBC as in the template
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -524,7 +564,9 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     waitResponse();
     return res;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -538,22 +580,83 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     // <PDPcontextID>(1-16), <connectID>(0-11),
     // "TCP/UDP/TCP LISTENER/UDPSERVICE", "<IP_address>/<domain_name>",
     // <remote_port>,<local_port>,<access_mode>(0-2; 0=buffer)
-    sendAT(GF("+QIOPEN=1,"), mux, GF(",\""), GF("TCP"), GF("\",\""), host,
+    String      address;
+    const char* remote = dnsConnectTarget(host, address, timeout_ms);
+    if (!remote) { return false; }
+    // Keepalive is module-wide, so it is set for each socket that asks for it
+    // and turned back off for the sockets that do not
+    GsmClientBG96* client = sockets[mux];
+    if (client && (client->keep_alive_idle > 0 || keepAliveOn)) {
+      modemSetKeepAlive(mux, client->keep_alive_idle,
+                        client->keep_alive_interval, client->keep_alive_count);
+    }
+    sendAT(GF("+QIOPEN=1,"), mux, GF(",\""), GF("TCP"), GF("\",\""), remote,
            GF("\","), port, GF(",0,0"));
     waitResponse();
 
-    if (waitResponse(timeout_ms, GF(GSM_NL "+QIOPEN:")) != 1) { return false; }
+    bool opened = false;
+    if (waitResponse(timeout_ms, GF(GSM_NL "+QIOPEN:")) == 1 &&
+        streamGetIntBefore(',') == mux) {
+      // Read status
+      opened = (0 == streamGetIntBefore('\n'));
+    }
+    if (!opened && remote != host) { dnsCacheRemove(host); }
+    return opened;
+  }
 
-    if (streamGetIntBefore(',') != mux) { return false; }
-    // Read status
-    return (0 == streamGetIntBefore('\n'));
+  bool modemAbort(uint8_t mux) {
+    // AT+QICLOSE=<connectID>,<timeout>; a <timeout> of 0 closes the socket
+    // at once, without waiting the default 10 s for the FIN ACK
+    sendAT(GF("+QICLOSE="), mux, GF(",0"));
+    if (sockets[mux]) { sockets[mux]->sock_connected = false; }
+    waitResponse();
+    return true;
+  }
+
+  bool modemSetKeepAlive(uint8_t, uint16_t idle_s, uint16_t interval_s,
+                         uint8_t count) {
+    // AT+QICFG="tcp/keepalive",<enable>,<keepidle>,<keepinterval>,<keepcount>
+    // <keepidle> 1-120 minutes, <keepinterval> 25-100 s, <keepcount> 3-10
+    if (idle_s == 0) {
+      sendAT(GF("+QICFG=\"tcp/keepalive\",0"));
+    } else {
+      sendAT(GF("+QICFG=\"tcp/keepalive\",1,"),
+             constrain((idle_s + 59) / 60, 1, 120), ',',
+             constrain(interval_s, 25, 100), ',', constrain(count, 3, 10));
+    }
+    if (waitResponse() != 1) { return false; }
+    keepAliveOn = idle_s > 0;
+    return true;
+  }
+
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t& ttl_s) {
+    // AT+QIDNSGIP=<contextID>,<hostname>
+    dnsResult = -1;
+    dnsTtl    = ttl_s;
+    sendAT(GF("+QIDNSGIP=1,\""), host, '"');
+    if (waitResponse() != 1) { return false; }
+    // The answer arrives as +QIURC: "dnsgip" URC's, parsed in waitResponse
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (dnsResult < 0 && TINY_GSM_MILLIS() - startMillis < timeout_ms) {
+      waitResponse(100, NULL, NULL);
+    }
+    if (dnsResult != 1) { return false; }
+    ip    = dnsAddress;
+    ttl_s = dnsTtl;
+    return true;
   }
 
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     sendAT(GF("+QISEND="), mux, ',', (uint16_t)len);
     if (waitResponse(GF(">")) != 1) { return 0; }
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    streamWriteIoVec(iov, count);
     if (waitResponse(GF(GSM_NL "SEND OK")) != 1) { return 0; }
     // TODO(?): Wait for ACK? AT+QISEND=id,0
     return len;
@@ -565,15 +668,36 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     if (waitResponse(GF("+QIRD:")) != 1) { return 0; }
     int16_t len = streamGetIntBefore('\n');
 
-    for (int i = 0; i < len; i++) { moveCharFromStreamToFifo(mux); }
+    moveStreamToFifo(mux, len);
     waitResponse();
     // DBG("### READ:", len, "from", mux);
     sockets[mux]->sock_available = modemGetAvailable(mux);
     return len;
   }
 
+  void modemPollSockets() {
+    // +QIRD only reports on one socket, but a single +QISTATE gives the state
+    // of all of them
+    bool check_state = false;
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      GsmClientBG96* sock = sockets[mux];
+      if (sock && sock->got_data) {
+        sock->got_data       = false;
+        sock->sock_available = modemGetBuffered(mux);
+        if (!sock->sock_available) { check_state = true; }
+      }
+    }
+    if (check_state) { modemGetAllConnected(); }
+  }
+
   size_t modemGetAvailable(uint8_t mux) {
     if (!sockets[mux]) return 0;
+    size_t result = modemGetBuffered(mux);
+    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
+    return result;
+  }
+
+  size_t modemGetBuffered(uint8_t mux) {
     sendAT(GF("+QIRD="), mux, GF(",0"));
     size_t result = 0;
     if (waitResponse(GF("+QIRD:")) == 1) {
@@ -583,7 +707,6 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
       if (result) { DBG("### DATA AVAILABLE:", result, "on", mux); }
       waitResponse();
     }
-    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
     return result;
   }
 
@@ -606,122 +729,200 @@ class TinyGsmBG96 : public TinyGsmModem<TinyGsmBG96>,
     return 2 == res;
   }
 
+  // Updates sock_connected of every socket from a single +QISTATE
+  void modemGetAllConnected() {
+    // Lists every connection on PDP context 1, sockets missing from the list
+    // are closed
+    sendAT(GF("+QISTATE=0,1"));
+    bool   connected[TINY_GSM_MUX_COUNT] = {false};
+    int8_t res;
+    while ((res = waitResponse(GF("+QISTATE:"), GFP(GSM_OK),
+                               GFP(GSM_ERROR))) == 1) {
+      int8_t mux = streamGetIntBefore(',');
+      streamSkipUntil(',');                    // Skip socket type
+      streamSkipUntil(',');                    // Skip remote ip
+      streamSkipUntil(',');                    // Skip remote port
+      streamSkipUntil(',');                    // Skip local port
+      int8_t state = streamGetIntBefore(',');  // socket state
+      streamSkipUntil('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT) {
+        connected[mux] = (2 == state);
+      }
+    }
+    if (res != 2) { return; }  // Keep the old state if the list was cut short
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      if (sockets[mux]) { sockets[mux]->sock_connected = connected[mux]; }
+    }
+  }
+
   /*
-   * Utilities
+   * Server related functions
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
+ protected:
+  // The listeners take the connection numbers down from the one below the
+  // last, which is left to the default TinyGsmUdp
+  static uint8_t listenerMux(uint8_t server) {
+    return TINY_GSM_MUX_COUNT - 2 - server;
+  }
+
+  bool modemListen(uint16_t port, uint8_t server) {
+    if (server > TINY_GSM_MUX_COUNT - 2) { return false; }
+    uint8_t listener = listenerMux(server);
+#if TINY_GSM_USES(UDP)
+    if (udpOwns(listener)) {
+      DBG("### Connection", listener, "is a UDP socket's");
+      return false;
+    }
 #endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+QIURC:"))) {
-          streamSkipUntil('\"');
-          String urc = stream.readStringUntil('\"');
-          streamSkipUntil(',');
-          if (urc == "recv") {
-            int8_t mux = streamGetIntBefore('\n');
-            DBG("### URC RECV:", mux);
-            if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-              sockets[mux]->got_data = true;
-            }
-          } else if (urc == "closed") {
-            int8_t mux = streamGetIntBefore('\n');
-            DBG("### URC CLOSE:", mux);
-            if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-              sockets[mux]->sock_connected = false;
-            }
-          } else {
-            streamSkipUntil('\n');
-          }
-          data = "";
-        }
-      }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
+    sendAT(GF("+QIOPEN=1,"), listener, GF(",\"TCP LISTENER\",\"127.0.0.1\",0,"),
+           port, GF(",0"));
+    if (waitResponse() != 1) { return false; }
+    if (waitResponse(15000L, GF(GSM_NL "+QIOPEN:")) != 1 ||
+        streamGetIntBefore(',') != listener) {
+      return false;
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
+    if (0 != streamGetIntBefore('\n')) { return false; }
+    listeners |= (1U << listener);
+    return true;
   }
 
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+  void modemStopListen(uint16_t, uint8_t server) {
+    uint8_t listener = listenerMux(server);
+    sendAT(GF("+QICLOSE="), listener);
+    waitResponse();
+    listeners &= ~(1U << listener);
+  }
 #endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+
+#if TINY_GSM_USES(UDP)
+  /*
+   * UDP related functions
+   */
+ protected:
+  bool modemUdpBegin(uint8_t* mux, uint16_t local_port) {
+    // A "UDP SERVICE" socket sends to and receives from any peer.  It needs a
+    // local port, so an ephemeral one is picked when none is given.
+    if (local_port == 0) { local_port = 49152 + (TINY_GSM_MILLIS() & 0x3FFF); }
+    if (*mux < TINY_GSM_MUX_COUNT && (listeners & (1U << *mux))) {
+      DBG("### Connection", *mux, "is a listener's");
+      return false;
+    }
+    sendAT(GF("+QIOPEN=1,"), *mux, GF(",\"UDP SERVICE\",\"127.0.0.1\",0,"),
+           local_port, GF(",0"));
+    if (waitResponse() != 1) { return false; }
+    if (waitResponse(15000L, GF(GSM_NL "+QIOPEN:")) != 1 ||
+        streamGetIntBefore(',') != *mux) {
+      return false;
+    }
+    return 0 == streamGetIntBefore('\n');
   }
 
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+  bool modemUdpSend(uint8_t mux, const char* host, uint16_t port,
+                    const uint8_t* buf, size_t len, bool) {
+    // The remote address of a UDP SERVICE send must be an IP address
+    IPAddress ip;
+    if (!getHostByName(host, ip)) { return false; }
+    sendAT(GF("+QISEND="), mux, ',', (uint16_t)len, GF(",\""),
+           GsmClientBG96::TinyGsmStringFromIp(ip), GF("\","), port);
+    if (waitResponse(GF(">")) != 1) { return false; }
+    stream.write(buf, len);
+    stream.flush();
+    return waitResponse(GF(GSM_NL "SEND OK")) == 1;
   }
 
- public:
-  Stream& stream;
+  int modemUdpReceive(uint8_t mux, uint8_t* buf, size_t size, String& ip,
+                      uint16_t& port) {
+    // Each +QIRD on a UDP SERVICE socket returns a single datagram
+    sendAT(GF("+QIRD="), mux, ',', (uint16_t)size);
+    if (waitResponse(GF("+QIRD:")) != 1) { return 0; }
+    // +QIRD: <len>,"<remote IP>",<remote port>  or  +QIRD: 0
+    String  header = stream.readStringUntil('\n');
+    int16_t len    = header.toInt();
+    int     quote  = header.indexOf('"');
+    if (len > 0 && quote > 0) {
+      int end = header.indexOf('"', quote + 1);
+      ip      = header.substring(quote + 1, end);
+      port    = header.substring(end + 2).toInt();
+    }
+    if (len > 0) {
+      len = stream.readBytes(buf, TinyGsmMin(static_cast<size_t>(len), size));
+    }
+    waitResponse();
+    return len;
+  }
+
+  void modemUdpStop(uint8_t mux) {
+    sendAT(GF("+QICLOSE="), mux);
+    waitResponse();
+  }
+#endif
+
+  /*
+   * Utilities
+   */
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF(GSM_NL "+QIURC:"))) {
+      streamSkipUntil('\"');
+      String urc = stream.readStringUntil('\"');
+      streamSkipUntil(',');
+      if (urc == "recv") {
+        int8_t mux = streamGetIntBefore('\n');
+        DBG("### URC RECV:", mux);
+        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+          sockets[mux]->got_data = true;
+        }
+#if TINY_GSM_USES(UDP)
+        udpReceived(mux);
+#endif
+      } else if (urc == "closed") {
+        int8_t mux = streamGetIntBefore('\n');
+        DBG("### URC CLOSE:", mux);
+        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+          sockets[mux]->sock_connected = false;
+        }
+      } else if (urc == "incoming") {
+        // +QIURC: "incoming",<connectID>,<serverID>,<remoteIP>,<port>
+        int8_t mux = streamGetIntBefore(',');
+        streamSkipUntil('\n');
+        DBG("### URC INCOMING:", mux);
+        modemIncoming(mux);
+      } else if (urc == "dnsgip") {
+        // +QIURC: "dnsgip",<err>,<IP_count>,<DNS_ttl>
+        // followed by one +QIURC: "dnsgip","<hostIPaddr>" per address
+        String res = stream.readStringUntil('\n');
+        res.trim();
+        if (res.startsWith("\"")) {
+          res.replace("\"", "");
+          if (dnsResult < 0 && dnsAddress.fromString(res)) {
+            dnsResult = 1;
+          }
+        } else if (res.toInt() != 0 ||
+                   res.substring(res.indexOf(',') + 1).toInt() == 0) {
+          dnsResult = 0;  // lookup failed or found no addresses
+        } else {
+          dnsTtl = res.substring(res.lastIndexOf(',') + 1).toInt();
+        }
+        DBG("### URC DNS:", res);
+      } else {
+        streamSkipUntil('\n');
+      }
+      data = "";
+    }
+  }
+#endif
 
  protected:
-  GsmClientBG96* sockets[TINY_GSM_MUX_COUNT];
   const char*    gsmNL = GSM_NL;
+#if TINY_GSM_USES(TCP)
+  GsmClientBG96* sockets[TINY_GSM_MUX_COUNT];
+  int8_t         dnsResult;
+  IPAddress      dnsAddress;
+  uint32_t       dnsTtl;
+  uint16_t       listeners;  // The connections listening, a bit per mux
+  bool           keepAliveOn = false;
+#endif
 };
 
 #endif  // SRC_TINYGSMCLIENTBG96_H_
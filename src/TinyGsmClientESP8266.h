@@ -20,10 +20,11 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmWifi.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-static uint8_t    TINY_GSM_TCP_KEEP_ALIVE      = 120;
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_SERVER
+#endif
+
+static uint8_t TINY_GSM_TCP_KEEP_ALIVE = 120;
 
 // <stat> status of ESP8266 station interface
 // 2 : ESP8266 station connected to an AP and has obtained IP
@@ -38,15 +39,22 @@ enum RegStatus {
   REG_UNKNOWN   = 6,
 };
 
-class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
-                       public TinyGsmWifi<TinyGsmESP8266>,
+class TinyGsmESP8266 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                        public TinyGsmTCP<TinyGsmESP8266, TINY_GSM_MUX_COUNT>,
-                       public TinyGsmSSL<TinyGsmESP8266> {
+#endif
+#if TINY_GSM_USES(SSL)
+                       public TinyGsmSSL<TinyGsmESP8266>,
+#endif
+                       public TinyGsmModem<TinyGsmESP8266>,
+                       public TinyGsmWifi<TinyGsmESP8266> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmESP8266>;
   friend class TinyGsmWifi<TinyGsmESP8266>;
   friend class TinyGsmTCP<TinyGsmESP8266, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSSL<TinyGsmESP8266>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -77,6 +85,7 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -86,6 +95,7 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       TINY_GSM_YIELD();
       at->sendAT(GF("+CIPCLOSE="), mux);
       sock_connected = false;
@@ -102,7 +112,9 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -116,6 +128,7 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -124,13 +137,17 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     }
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmESP8266(Stream& stream) : stream(stream) {
+  explicit TinyGsmESP8266(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmESP8266>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -159,8 +176,8 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     return true;
   }
 
-  String getModemNameImpl() {
-    return "ESP8266";
+  size_t getModemNameImpl(char* out, size_t cap) {
+    return TinyGsmCopy(out, cap, "ESP8266");
   }
 
   void setBaudImpl(uint32_t baud) {
@@ -181,14 +198,10 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     return waitResponse() == 1;
   }
 
-  String getModemInfoImpl() {
+  size_t getModemInfoImpl(char* out, size_t cap) {
     sendAT(GF("+GMR"));
-    String res;
-    if (waitResponse(1000L, res) != 1) { return ""; }
-    res.replace(GSM_NL "OK" GSM_NL, "");
-    res.replace(GSM_NL, " ");
-    res.trim();
-    return res;
+    if (!streamGetLines(out, cap, " ", 1000L)) { return 0; }
+    return strlen(out);
   }
 
   /*
@@ -200,7 +213,7 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     sendAT(GF("+RST"));
     if (waitResponse(10000L) != 1) { return false; }
     if (waitResponse(10000L, GF(GSM_NL "ready" GSM_NL)) != 1) { return false; }
-    delay(500);
+    TINY_GSM_DELAY(500);
     return init(pin);
   }
 
@@ -258,31 +271,32 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
       return true;
     } else if (s == REG_OK_NO_TCP) {
       // with this, we may or may not be connected
-      if (getLocalIP() == "") {
-        return false;
-      } else {
-        return true;
-      }
+      char ip[TINY_GSM_SHORT_STRING];
+      return getLocalIP(ip, sizeof(ip)) > 0;
     } else {
       return false;
     }
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     // attempt with and without 'current' flag
     sendAT(GF("+CIPSTA?"));
     int8_t res1 = waitResponse(GF("ERROR"), GF("+CIPSTA:"));
     if (res1 != 2) {
       sendAT(GF("+CIPSTA_CUR?"));
       res1 = waitResponse(GF("ERROR"), GF("+CIPSTA_CUR:"));
-      if (res1 != 2) { return ""; }
+      if (res1 != 2) { return 0; }
     }
-    String res2 = stream.readStringUntil('\n');
-    res2.replace("ip:", "");  // newer firmwares have this
-    res2.replace("\"", "");
-    res2.trim();
+    streamGetStringBefore('\n', out, cap);
+    // Drops the "ip:" of newer firmwares, and the quotes
+    const char* from = strncmp(out, "ip:", 3) ? out : out + 3;
+    size_t      len  = 0;
+    for (; *from; from++) {
+      if (*from != '"') { out[len++] = *from; }
+    }
+    out[len] = '\0';
     waitResponse();
-    return res2;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -310,6 +324,7 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     return retVal;
   }
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -329,6 +344,8 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
                               GF("ALREADY CONNECT"));
     // if (rsp == 3) waitResponse();
     // May return "ERROR" after the "ALREADY CONNECT"
+    // The "<mux>,CONNECT" of our own connection isn't an incoming one
+    acceptPending &= ~(1U << mux);
     return (1 == rsp);
   }
 
@@ -378,107 +395,78 @@ class TinyGsmESP8266 : public TinyGsmModem<TinyGsmESP8266>,
     return verified_connections[mux];
   }
 
+  /*
+   * Server related functions
+   */
+ protected:
+  // The module runs a single server, incoming connections get free link
+  // numbers from the module
+  bool modemListen(uint16_t port, uint8_t) {
+    sendAT(GF("+CIPSERVER=1,"), port);
+    return waitResponse() == 1;
+  }
+
+  void modemStopListen(uint16_t, uint8_t) {
+    sendAT(GF("+CIPSERVER=0"));
+    waitResponse();
+  }
+#endif
+
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+IPD,"))) {
-          int8_t  mux      = streamGetIntBefore(',');
-          int16_t len      = streamGetIntBefore(':');
-          int16_t len_orig = len;
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            if (len > sockets[mux]->rx.free()) {
-              DBG("### Buffer overflow: ", len, "received vs",
-                  sockets[mux]->rx.free(), "available");
-            } else {
-              // DBG("### Got Data: ", len, "on", mux);
-            }
-            while (len--) { moveCharFromStreamToFifo(mux); }
-            // TODO(SRGDamia1): deal with buffer overflow/missed characters
-            if (len_orig > sockets[mux]->available()) {
-              DBG("### Fewer characters received than expected: ",
-                  sockets[mux]->available(), " vs ", len_orig);
-            }
-          }
-          data = "";
-        } else if (data.endsWith(GF("CLOSED"))) {
-          int8_t muxStart =
-              TinyGsmMax(0, data.lastIndexOf(GSM_NL, data.length() - 8));
-          int8_t coma = data.indexOf(',', muxStart);
-          int8_t mux  = data.substring(muxStart, coma).toInt();
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+IPD,"))) {
+      int8_t  mux      = streamGetIntBefore(',');
+      int16_t len      = streamGetIntBefore(':');
+      int16_t len_orig = len;
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        if (len > sockets[mux]->rx.free()) {
+          DBG("### Buffer overflow: ", len, "received vs",
+              sockets[mux]->rx.free(), "available");
+        } else {
+          // DBG("### Got Data: ", len, "on", mux);
         }
+        moveStreamToFifo(mux, len);
+        // TODO(SRGDamia1): deal with buffer overflow/missed characters
+        if (len_orig > sockets[mux]->available()) {
+          DBG("### Fewer characters received than expected: ",
+              sockets[mux]->available(), " vs ", len_orig);
+        }
+      } else if (len > 0) {
+        // No client has the connection yet, ie an incoming one not yet
+        // accepted; the data is read out and dropped, so it isn't taken for
+        // a response
+        DBG("### Dropped", len, "bytes on", mux);
+        streamGetPayload(NULL, len, 1000L);
+      }
+      data = "";
+    } else if (TinyGsmEndsWith(data, GF(",CONNECT"))) {
+      // <mux>,CONNECT for a new connection, incoming or our own
+      int8_t muxStart = TinyGsmMax(0, data.lastIndexOf('\n') + 1);
+      int8_t mux      = data.substring(muxStart, data.length() - 8).toInt();
+      modemIncoming(mux);
+      data = "";
+    } else if (TinyGsmEndsWith(data, GF("CLOSED"))) {
+      int8_t muxStart =
+          TinyGsmMax(0, data.lastIndexOf(GSM_NL, data.length() - 8));
+      int8_t coma = data.indexOf(',', muxStart);
+      int8_t mux  = data.substring(muxStart, coma).toInt();
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
+      DBG("### Closed: ", mux);
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
   }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
+#endif
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientESP8266* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*       gsmNL = GSM_NL;
 };
 
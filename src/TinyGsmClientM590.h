@@ -21,14 +21,6 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -39,17 +31,26 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
-                    public TinyGsmGPRS<TinyGsmM590>,
+class TinyGsmM590 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                     public TinyGsmTCP<TinyGsmM590, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SMS)
                     public TinyGsmSMS<TinyGsmM590>,
-                    public TinyGsmTime<TinyGsmM590> {
+#endif
+#if TINY_GSM_USES(TIME)
+                    public TinyGsmTime<TinyGsmM590>,
+#endif
+                    public TinyGsmModem<TinyGsmM590>,
+                    public TinyGsmGPRS<TinyGsmM590> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmM590>;
   friend class TinyGsmGPRS<TinyGsmM590>;
   friend class TinyGsmTCP<TinyGsmM590, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSMS<TinyGsmM590>;
   friend class TinyGsmTime<TinyGsmM590>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -80,6 +81,7 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -89,6 +91,7 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       TINY_GSM_YIELD();
       at->sendAT(GF("+TCPCLOSE="), mux);
       sock_connected = false;
@@ -105,13 +108,17 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmM590(Stream& stream) : stream(stream) {
+  explicit TinyGsmM590(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmM590>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -149,8 +156,8 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
   }
 
   // Doesn't support CGMI
-  String getModemNameImpl() {
-    return "Neoway M590";
+  size_t getModemNameImpl(char* out, size_t cap) {
+    return TinyGsmCopy(out, cap, "Neoway M590");
   }
 
   // Extra stuff here - pwr save, internal stack
@@ -208,14 +215,13 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
     return (s == REG_OK_HOME || s == REG_OK_ROAMING);
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+XIIC?"));
-    if (waitResponse(GF(GSM_NL "+XIIC:")) != 1) { return ""; }
+    if (waitResponse(GF(GSM_NL "+XIIC:")) != 1) { return 0; }
     streamSkipUntil(',');
-    String res = stream.readStringUntil('\n');
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -241,12 +247,13 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
     waitResponse();
 
     const uint32_t timeout_ms = 60000L;
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       if (isGprsConnected()) {
         // goto set_dns; // TODO
         return true;
       }
-      delay(500);
+      TINY_GSM_DELAY(500);
     }
     return false;
 
@@ -280,12 +287,14 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
  protected:
   // Able to follow all SIM card functions as inherited from the template
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
  protected:
   bool sendSMS_UTF16Impl(const String& number, const void* text,
                          size_t len) TINY_GSM_ATTR_NOT_AVAILABLE;
+#endif
 
   /*
    * Time functions
@@ -293,6 +302,7 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
  protected:
   // Can follow the standard CCLK function in the template
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -313,7 +323,7 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
         sendAT(GF("+TCPCLOSE="), mux);
         waitResponse();
       }
-      delay(1000);
+      TINY_GSM_DELAY(1000);
     }
     return false;
   }
@@ -345,128 +355,48 @@ class TinyGsmM590 : public TinyGsmModem<TinyGsmM590>,
     res.trim();
     return res;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+TCPRECV:"))) {
-          int8_t  mux      = streamGetIntBefore(',');
-          int16_t len      = streamGetIntBefore(',');
-          int16_t len_orig = len;
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            if (len > sockets[mux]->rx.free()) {
-              DBG("### Buffer overflow: ", len, "->", sockets[mux]->rx.free());
-            } else {
-              DBG("### Got: ", len, "->", sockets[mux]->rx.free());
-            }
-            while (len--) { moveCharFromStreamToFifo(mux); }
-            // TODO(?): Handle lost characters
-            if (len_orig > sockets[mux]->available()) {
-              DBG("### Fewer characters received than expected: ",
-                  sockets[mux]->available(), " vs ", len_orig);
-            }
-          }
-          data = "";
-        } else if (data.endsWith(GF("+TCPCLOSE:"))) {
-          int8_t mux = streamGetIntBefore(',');
-          streamSkipUntil('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+TCPRECV:"))) {
+      int8_t  mux      = streamGetIntBefore(',');
+      int16_t len      = streamGetIntBefore(',');
+      int16_t len_orig = len;
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        if (len > sockets[mux]->rx.free()) {
+          DBG("### Buffer overflow: ", len, "->", sockets[mux]->rx.free());
+        } else {
+          DBG("### Got: ", len, "->", sockets[mux]->rx.free());
         }
+        moveStreamToFifo(mux, len);
+        // TODO(?): Handle lost characters
+        if (len_orig > sockets[mux]->available()) {
+          DBG("### Fewer characters received than expected: ",
+              sockets[mux]->available(), " vs ", len_orig);
+        }
+      }
+      data = "";
+    } else if (TinyGsmEndsWith(data, GF("+TCPCLOSE:"))) {
+      int8_t mux = streamGetIntBefore(',');
+      streamSkipUntil('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
+      DBG("### Closed: ", mux);
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
   }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientM590* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*    gsmNL = GSM_NL;
 };
 
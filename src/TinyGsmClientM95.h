@@ -25,14 +25,6 @@
 #include "TinyGsmTemperature.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -43,14 +35,28 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
-                   public TinyGsmGPRS<TinyGsmM95>,
+class TinyGsmM95 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                    public TinyGsmTCP<TinyGsmM95, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(CALLING)
                    public TinyGsmCalling<TinyGsmM95>,
+#endif
+#if TINY_GSM_USES(SMS)
                    public TinyGsmSMS<TinyGsmM95>,
+#endif
+#if TINY_GSM_USES(TIME)
                    public TinyGsmTime<TinyGsmM95>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                    public TinyGsmBattery<TinyGsmM95>,
-                   public TinyGsmTemperature<TinyGsmM95> {
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
+                   public TinyGsmTemperature<TinyGsmM95>,
+#endif
+                   public TinyGsmModem<TinyGsmM95>,
+                   public TinyGsmGPRS<TinyGsmM95> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmM95>;
   friend class TinyGsmGPRS<TinyGsmM95>;
   friend class TinyGsmTCP<TinyGsmM95, TINY_GSM_MUX_COUNT>;
@@ -60,6 +66,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
   friend class TinyGsmBattery<TinyGsmM95>;
   friend class TinyGsmTemperature<TinyGsmM95>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -91,6 +98,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -100,12 +108,13 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
-      uint32_t startMillis = millis();
+      TINY_GSM_STACK_CALL("stop");
+      uint32_t startMillis = TINY_GSM_MILLIS();
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+QICLOSE="), mux);
       sock_connected = false;
-      at->waitResponse((maxWaitMs - (millis() - startMillis)), GF("CLOSED"),
-                       GF("CLOSE OK"), GF("ERROR"));
+      at->waitResponse((maxWaitMs - (TINY_GSM_MILLIS() - startMillis)),
+                       GF("CLOSED"), GF("CLOSE OK"), GF("ERROR"));
     }
     void stop() override {
       stop(75000L);
@@ -117,7 +126,9 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -135,6 +146,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
 
     public:
       int connect(const char* host, uint16_t port, int timeout_s) override {
+        TINY_GSM_STACK_CALL("connect");
         stop();
         TINY_GSM_YIELD();
         rx.clear();
@@ -144,13 +156,17 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
       TINY_GSM_CLIENT_CONNECT_OVERRIDES
     };
   */
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmM95(Stream& stream) : stream(stream) {
+  explicit TinyGsmM95(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<TinyGsmM95>) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -253,12 +269,11 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
     waitResponse();
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+QILOCIP"));
     streamSkipUntil('\n');
-    String res = stream.readStringUntil('\n');
-    res.trim();
-    return res;
+    streamGetStringBefore('\n', out, cap);
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -344,13 +359,12 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
    * SIM card functions
    */
  protected:
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+QCCID"));
-    if (waitResponse(GF(GSM_NL "+QCCID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+QCCID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -359,6 +373,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
  protected:
   // Can follow all of the phone call functions from the template
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
@@ -374,6 +389,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
     }
     return false;
   }
+#endif
 
   /*
    * Time functions
@@ -386,6 +402,7 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
    */
   // Can follow the battery functions in the template
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -404,7 +421,9 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
     waitResponse();
     return temp;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -472,12 +491,8 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
       // that much there. In that case, make sure we make sure we re-set the
       // amount of data available.
       if (len < size) { sockets[mux]->sock_available = len; }
-      for (uint16_t i = 0; i < len; i++) {
-        moveCharFromStreamToFifo(mux);
-        sockets[mux]->sock_available--;
-        // ^^ One less character available after moving from modem's FIFO to our
-        // FIFO
-      }
+      sockets[mux]->sock_available -= moveStreamToFifo(mux, len);
+      // ^^ Less characters available after moving from modem's FIFO to our FIFO
       waitResponse();  // ends with an OK
       // DBG("### READ:", len, "from", mux);
       return len;
@@ -510,126 +525,46 @@ class TinyGsmM95 : public TinyGsmModem<TinyGsmM95>,
     // 0 Initial, 1 Opening, 2 Connected, 3 Listening, 4 Closing
     return 2 == res;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+QIRDI:"))) {
-          streamSkipUntil(',');  // Skip the context
-          streamSkipUntil(',');  // Skip the role
-          int8_t mux = streamGetIntBefore('\n');
-          // DBG("### Got Data:", mux);
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            // We have no way of knowing how much data actually came in, so
-            // we set the value to 1500, the maximum possible size.
-            sockets[mux]->sock_available = 1500;
-          }
-          data = "";
-        } else if (data.endsWith(GF("CLOSED" GSM_NL))) {
-          int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
-          int8_t coma = data.indexOf(',', nl + 2);
-          int8_t mux  = data.substring(nl + 2, coma).toInt();
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("+QNITZ:"))) {
-          streamSkipUntil('\n');  // URC for time sync
-          data = "";
-          DBG("### Network time updated.");
-        }
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+QNITZ:"))) {
+      streamSkipUntil('\n');  // URC for time sync
+      data = "";
+      DBG("### Network time updated.");
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+QIRDI:"))) {
+      streamSkipUntil(',');  // Skip the context
+      streamSkipUntil(',');  // Skip the role
+      int8_t mux = streamGetIntBefore('\n');
+      // DBG("### Got Data:", mux);
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        // We have no way of knowing how much data actually came in, so
+        // we set the value to 1500, the maximum possible size.
+        sockets[mux]->sock_available = 1500;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+    } else if (TinyGsmEndsWith(data, GF("CLOSED" GSM_NL))) {
+      int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
+      int8_t coma = data.indexOf(',', nl + 2);
+      int8_t mux  = data.substring(nl + 2, coma).toInt();
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### Closed: ", mux);
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
   }
 
- public:
-  Stream& stream;
-
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientM95* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*   gsmNL = GSM_NL;
 };
 
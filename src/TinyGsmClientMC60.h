@@ -26,14 +26,6 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -44,13 +36,25 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
-                    public TinyGsmGPRS<TinyGsmMC60>,
+class TinyGsmMC60 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                     public TinyGsmTCP<TinyGsmMC60, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(CALLING)
                     public TinyGsmCalling<TinyGsmMC60>,
+#endif
+#if TINY_GSM_USES(SMS)
                     public TinyGsmSMS<TinyGsmMC60>,
+#endif
+#if TINY_GSM_USES(TIME)
                     public TinyGsmTime<TinyGsmMC60>,
-                    public TinyGsmBattery<TinyGsmMC60> {
+#endif
+#if TINY_GSM_USES(BATTERY)
+                    public TinyGsmBattery<TinyGsmMC60>,
+#endif
+                    public TinyGsmModem<TinyGsmMC60>,
+                    public TinyGsmGPRS<TinyGsmMC60> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmMC60>;
   friend class TinyGsmGPRS<TinyGsmMC60>;
   friend class TinyGsmTCP<TinyGsmMC60, TINY_GSM_MUX_COUNT>;
@@ -59,6 +63,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
   friend class TinyGsmTime<TinyGsmMC60>;
   friend class TinyGsmBattery<TinyGsmMC60>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -90,6 +95,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -99,12 +105,13 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
-      uint32_t startMillis = millis();
+      TINY_GSM_STACK_CALL("stop");
+      uint32_t startMillis = TINY_GSM_MILLIS();
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+QICLOSE="), mux);
       sock_connected = false;
-      at->waitResponse((maxWaitMs - (millis() - startMillis)), GF("CLOSED"),
-                       GF("CLOSE OK"), GF("ERROR"));
+      at->waitResponse((maxWaitMs - (TINY_GSM_MILLIS() - startMillis)),
+                       GF("CLOSED"), GF("CLOSE OK"), GF("ERROR"));
     }
     void stop() override {
       stop(75000L);
@@ -116,7 +123,9 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -134,6 +143,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
 
     public:
       int connect(const char* host, uint16_t port, int timeout_s) override {
+        TINY_GSM_STACK_CALL("connect");
         stop();
         TINY_GSM_YIELD();
         rx.clear();
@@ -143,13 +153,17 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
       TINY_GSM_CLIENT_CONNECT_OVERRIDES
     };
  */
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmMC60(Stream& stream) : stream(stream) {
+  explicit TinyGsmMC60(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<TinyGsmMC60>) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -201,7 +215,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
     if (!testAT()) { return false; }
     if (!setPhoneFunctionality(0)) { return false; }
     if (!setPhoneFunctionality(1, true)) { return false; }
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return init(pin);
   }
 
@@ -239,12 +253,11 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
     return (s == REG_OK_HOME || s == REG_OK_ROAMING);
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+QILOCIP"));
     streamSkipUntil('\n');
-    String res = stream.readStringUntil('\n');
-    res.trim();
-    return res;
+    streamGetStringBefore('\n', out, cap);
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -314,21 +327,22 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
    */
  protected:
   SimStatus getSimStatusImpl(uint32_t timeout_ms = 10000L) {
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       sendAT(GF("+CPIN?"));
       if (waitResponse(GF(GSM_NL "+CPIN:")) != 1) {
-        delay(1000);
+        TINY_GSM_DELAY(1000);
         continue;
       }
+      // "PH_SIM P" takes both PH_SIM PIN and PH_SIM PUK, before "SIM PIN"
+      // or "SIM PUK" can match their ends
       int8_t status = waitResponse(GF("READY"), GF("SIM PIN"), GF("SIM PUK"),
-                                   GF("NOT INSERTED"), GF("PH_SIM PIN"),
-                                   GF("PH_SIM PUK"));
+                                   GF("NOT INSERTED"), GF("PH_SIM P"));
       waitResponse();
       switch (status) {
         case 2:
         case 3: return SIM_LOCKED;
-        case 5:
-        case 6: return SIM_ANTITHEFT_LOCKED;
+        case 5: return SIM_ANTITHEFT_LOCKED;
         case 1: return SIM_READY;
         default: return SIM_ERROR;
       }
@@ -342,6 +356,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
  protected:
   // Can follow all of the phone call functions from the template
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
@@ -357,6 +372,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
     }
     return false;
   }
+#endif
 
   /*
    * Time functions
@@ -369,6 +385,7 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
    */
   // Can follow battery functions as in the template
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -445,12 +462,8 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
       // be different sizes.
       // If so, make sure we make sure we re-set the amount of data available.
       if (len < size) { sockets[mux]->sock_available = len; }
-      for (uint16_t i = 0; i < len; i++) {
-        moveCharFromStreamToFifo(mux);
-        sockets[mux]->sock_available--;
-        // ^^ One less character available after moving from modem's FIFO to our
-        // FIFO
-      }
+      sockets[mux]->sock_available -= moveStreamToFifo(mux, len);
+      // ^^ Less characters available after moving from modem's FIFO to our FIFO
       waitResponse();  // ends with an OK
       // DBG("### READ:", len, "from", mux);
       return len;
@@ -483,139 +496,55 @@ class TinyGsmMC60 : public TinyGsmModem<TinyGsmMC60>,
     // 0 Initial, 1 Opening, 2 Connected, 3 Listening, 4 Closing
     return 2 == res;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL, GsmConstStr r6 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    String r6s(r6); r6s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s, ",", r6s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (r6 && data.endsWith(r6)) {
-          index = 6;
-          goto finish;
-        } else if (data.endsWith(
-                       GF(GSM_NL "+QIRDI:"))) {  // TODO(?):  QIRD? or QIRDI?
-          // +QIRDI: <id>,<sc>,<sid>,<num>,<len>,< tlen>
-          streamSkipUntil(',');  // Skip the context
-          streamSkipUntil(',');  // Skip the role
-          // read the connection id
-          int8_t mux = streamGetIntBefore(',');
-          // read the number of packets in the buffer
-          int8_t num_packets = streamGetIntBefore(',');
-          // read the length of the current packet
-          streamSkipUntil(
-              ',');  // Skip the length of the current package in the buffer
-          int16_t len_total =
-              streamGetIntBefore('\n');  // Total length of all packages
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux] &&
-              num_packets >= 0 && len_total >= 0) {
-            sockets[mux]->sock_available = len_total;
-          }
-          data = "";
-          // DBG("### Got Data:", len_total, "on", mux);
-        } else if (data.endsWith(GF("CLOSED" GSM_NL))) {
-          int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
-          int8_t coma = data.indexOf(',', nl + 2);
-          int8_t mux  = data.substring(nl + 2, coma).toInt();
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("+QNITZ:"))) {
-          streamSkipUntil('\n');  // URC for time sync
-          DBG("### Network time updated.");
-          data = "";
-        }
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+QNITZ:"))) {
+      streamSkipUntil('\n');  // URC for time sync
+      DBG("### Network time updated.");
+      data = "";
+#if TINY_GSM_USES(TCP)
+    // TODO(?):  QIRD? or QIRDI?
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+QIRDI:"))) {
+      // +QIRDI: <id>,<sc>,<sid>,<num>,<len>,< tlen>
+      streamSkipUntil(',');  // Skip the context
+      streamSkipUntil(',');  // Skip the role
+      // read the connection id
+      int8_t mux = streamGetIntBefore(',');
+      // read the number of packets in the buffer
+      int8_t num_packets = streamGetIntBefore(',');
+      // read the length of the current packet
+      streamSkipUntil(
+          ',');  // Skip the length of the current package in the buffer
+      int16_t len_total =
+          streamGetIntBefore('\n');  // Total length of all packages
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux] &&
+          num_packets >= 0 && len_total >= 0) {
+        sockets[mux]->sock_available = len_total;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL, GsmConstStr r6 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5, r6);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+      // DBG("### Got Data:", len_total, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("CLOSED" GSM_NL))) {
+      int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
+      int8_t coma = data.indexOf(',', nl + 2);
+      int8_t mux  = data.substring(nl + 2, coma).toInt();
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### Closed: ", mux);
 #endif
-                      GsmConstStr r5 = NULL, GsmConstStr r6 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5, r6);
+    }
   }
 
- public:
-  Stream& stream;
-
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientMC60* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*    gsmNL = GSM_NL;
 };
 
@@ -25,14 +25,6 @@
 #include "TinyGsmTime.tpp"
 #include "TinyGsmNTP.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -43,15 +35,31 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
-                       public TinyGsmGPRS<TinyGsmSim5360>,
+class TinyGsmSim5360 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                        public TinyGsmTCP<TinyGsmSim5360, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SMS)
                        public TinyGsmSMS<TinyGsmSim5360>,
+#endif
+#if TINY_GSM_USES(TIME)
                        public TinyGsmTime<TinyGsmSim5360>,
+#endif
+#if TINY_GSM_USES(NTP)
                        public TinyGsmNTP<TinyGsmSim5360>,
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
                        public TinyGsmGSMLocation<TinyGsmSim5360>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                        public TinyGsmBattery<TinyGsmSim5360>,
-                       public TinyGsmTemperature<TinyGsmSim5360> {
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
+                       public TinyGsmTemperature<TinyGsmSim5360>,
+#endif
+                       public TinyGsmModem<TinyGsmSim5360>,
+                       public TinyGsmGPRS<TinyGsmSim5360> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmSim5360>;
   friend class TinyGsmGPRS<TinyGsmSim5360>;
   friend class TinyGsmTCP<TinyGsmSim5360, TINY_GSM_MUX_COUNT>;
@@ -62,6 +70,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
   friend class TinyGsmBattery<TinyGsmSim5360>;
   friend class TinyGsmTemperature<TinyGsmSim5360>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -95,6 +104,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -104,6 +114,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+CIPCLOSE="), mux);
       sock_connected = false;
@@ -119,7 +130,9 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -135,6 +148,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -144,13 +158,17 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
   */
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmSim5360(Stream& stream) : stream(stream) {
+  explicit TinyGsmSim5360(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<TinyGsmSim5360>) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -195,19 +213,16 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     }
   }
 
-  String getModemNameImpl() {
-    String name = "SIMCom SIM5360";
-
+  size_t getModemNameImpl(char* out, size_t cap) {
     sendAT(GF("+CGMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return name; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.replace("_", " ");
-    res2.trim();
-
-    name = res2;
-    DBG("### Modem:", name);
-    return name;
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "SIMCom SIM5360");
+    }
+    for (char* c = out; *c; c++) {
+      if (*c == '_') { *c = ' '; }
+    }
+    DBG("### Modem:", out);
+    return strlen(out);
   }
 
   bool factoryDefaultImpl() {  // these commands aren't supported
@@ -236,7 +251,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
 
   bool radioOffImpl() {
     if (!setPhoneFunctionality(4)) { return false; }
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return true;
   }
 
@@ -286,15 +301,11 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     return waitResponse() == 1;
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+IPADDR"));  // Inquire Socket PDP address
     // sendAT(GF("+CGPADDR=1"));  // Show PDP address
-    String res;
-    if (waitResponse(10000L, res) != 1) { return ""; }
-    res.replace(GSM_NL "OK" GSM_NL, "");
-    res.replace(GSM_NL, "");
-    res.trim();
-    return res;
+    if (!streamGetLines(out, cap, "", 10000L)) { return 0; }
+    return strlen(out);
   }
 
   /*
@@ -382,11 +393,13 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
   }
 
   bool gprsDisconnectImpl() {
+#if TINY_GSM_USES(TCP)
     // Close any open sockets
     for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
       GsmClientSim5360* sock = sockets[mux];
       if (sock) { sock->stop(); }
     }
+#endif
 
     // Stop the socket service
     // Note: all sockets should be closed first - on 3G/4G models the sockets
@@ -415,13 +428,12 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
    */
  protected:
   // Gets the CCID of a sim card via AT+CCID
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+CICCID"));
-    if (waitResponse(GF(GSM_NL "+ICCID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+ICCID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -448,6 +460,7 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
    */
   // Can sync with server using CNTP as per template
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -458,12 +471,11 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     if (waitResponse(GF(GSM_NL "+CBC:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip battery charge status
     streamSkipUntil(',');  // Skip battery charge level
-    // get voltage in VOLTS
-    float voltage = streamGetFloatBefore('\n');
+    // get voltage in VOLTS, as millivolts
+    int32_t res = 0;
+    streamGetDecimalBefore('\n', 3, res);
     // Wait for final OK
     waitResponse();
-    // Return millivolts
-    uint16_t res = voltage * 1000;
     return res;
   }
 
@@ -474,14 +486,17 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     if (waitResponse(GF(GSM_NL "+CBC:")) != 1) { return false; }
     chargeState = streamGetIntBefore(',');
     percent     = streamGetIntBefore(',');
-    // get voltage in VOLTS
-    float voltage = streamGetFloatBefore('\n');
-    milliVolts    = voltage * 1000;
+    // get voltage in VOLTS, as millivolts
+    int32_t voltage = 0;
+    streamGetDecimalBefore('\n', 3, voltage);
+    milliVolts = voltage;
     // Wait for final OK
     waitResponse();
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -499,7 +514,9 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     waitResponse();
     return res;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -547,11 +564,11 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     //  ^^ Requested number of data bytes (1-1460 bytes)to be read
     int16_t len_confirmed = streamGetIntBefore('\n');
     // ^^ The data length which not read in the buffer
-    for (int i = 0; i < len_requested; i++) {
-      uint32_t startMillis = millis();
 #ifdef TINY_GSM_USE_HEX
+    for (int i = 0; i < len_requested; i++) {
+      uint32_t startMillis = TINY_GSM_MILLIS();
       while (stream.available() < 2 &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
+             (TINY_GSM_MILLIS() - startMillis < sockets[mux]->_timeout)) {
         TINY_GSM_YIELD();
       }
       char buf[4] = {
@@ -560,15 +577,12 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
       buf[0] = stream.read();
       buf[1] = stream.read();
       char c = strtol(buf, NULL, 16);
-#else
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-#endif
       sockets[mux]->rx.put(c);
+      TINY_GSM_STAT(payload(1));
     }
+#else
+    moveStreamToFifo(mux, len_requested);
+#endif
     // DBG("### READ:", len_requested, "from", mux);
     // sockets[mux]->sock_available = modemGetAvailable(mux);
     sockets[mux]->sock_available = len_confirmed;
@@ -604,137 +618,57 @@ class TinyGsmSim5360 : public TinyGsmModem<TinyGsmSim5360>,
     if (!sockets[mux]) return false;
     return sockets[mux]->sock_connected;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+CIPRXGET:"))) {
-          int8_t mode = streamGetIntBefore(',');
-          if (mode == 1) {
-            int8_t mux = streamGetIntBefore('\n');
-            if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-              sockets[mux]->got_data = true;
-            }
-            data = "";
-            // DBG("### Got Data:", mux);
-          } else {
-            data += mode;
-          }
-        } else if (data.endsWith(GF(GSM_NL "+RECEIVE:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          // DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("+IPCLOSE:"))) {
-          int8_t mux = streamGetIntBefore(',');
-          streamSkipUntil('\n');  // Skip the reason code
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("+CIPEVENT:"))) {
-          // Need to close all open sockets and release the network library.
-          // User will then need to reconnect.
-          DBG("### Network error!");
-          if (!isGprsConnected()) { gprsDisconnect(); }
-          data = "";
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+CIPEVENT:"))) {
+      // Need to close all open sockets and release the network library.
+      // User will then need to reconnect.
+      DBG("### Network error!");
+      if (!isGprsConnected()) { gprsDisconnect(); }
+      data = "";
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+CIPRXGET:"))) {
+      int8_t mode = streamGetIntBefore(',');
+      if (mode == 1) {
+        int8_t mux = streamGetIntBefore('\n');
+        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+          sockets[mux]->got_data = true;
         }
+        data = "";
+        // DBG("### Got Data:", mux);
+      } else {
+        data += mode;
+      }
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+RECEIVE:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+      // DBG("### Got Data:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+IPCLOSE:"))) {
+      int8_t mux = streamGetIntBefore(',');
+      streamSkipUntil('\n');  // Skip the reason code
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### Closed: ", mux);
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
   }
 
- public:
-  Stream& stream;
-
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSim5360* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*       gsmNL = GSM_NL;
 };
 
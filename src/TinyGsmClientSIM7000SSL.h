@@ -19,14 +19,20 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmSSL.tpp"
 
-class TinyGsmSim7000SSL
-    : public TinyGsmSim70xx<TinyGsmSim7000SSL>,
-      public TinyGsmTCP<TinyGsmSim7000SSL, TINY_GSM_MUX_COUNT>,
-      public TinyGsmSSL<TinyGsmSim7000SSL> {
+class TinyGsmSim7000SSL :
+#if TINY_GSM_USES(TCP)
+                          public TinyGsmTCP<TinyGsmSim7000SSL, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
+                          public TinyGsmSSL<TinyGsmSim7000SSL>,
+#endif
+                          public TinyGsmSim70xx<TinyGsmSim7000SSL> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmSim70xx<TinyGsmSim7000SSL>;
   friend class TinyGsmTCP<TinyGsmSim7000SSL, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSSL<TinyGsmSim7000SSL>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -60,6 +66,7 @@ class TinyGsmSim7000SSL
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -69,6 +76,7 @@ class TinyGsmSim7000SSL
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+CACLOSE="), mux);
       sock_connected = false;
@@ -84,7 +92,9 @@ class TinyGsmSim7000SSL
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -104,6 +114,7 @@ class TinyGsmSim7000SSL
 
     virtual int connect(const char* host, uint16_t port,
                         int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -112,15 +123,17 @@ class TinyGsmSim7000SSL
     }
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
+#endif
 
   /*
    * Constructor
    */
  public:
   explicit TinyGsmSim7000SSL(Stream& stream)
-      : TinyGsmSim70xx<TinyGsmSim7000SSL>(stream),
-        certificates() {
+      : TinyGsmSim70xx<TinyGsmSim7000SSL>(stream) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -165,23 +178,6 @@ class TinyGsmSim7000SSL
     }
   }
 
-  void maintainImpl() {
-    // Keep listening for modem URC's and proactively iterate through
-    // sockets asking if any data is avaiable
-    bool check_socks = false;
-    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
-      GsmClientSim7000SSL* sock = sockets[mux];
-      if (sock && sock->got_data) {
-        sock->got_data = false;
-        check_socks    = true;
-      }
-    }
-    // modemGetAvailable checks all socks, so we only want to do it once
-    // modemGetAvailable calls modemGetConnected(), which also checks allf
-    if (check_socks) { modemGetAvailable(0); }
-    while (stream.available()) { waitResponse(15, NULL, NULL); }
-  }
-
   /*
    * Power functions
    */
@@ -192,15 +188,16 @@ class TinyGsmSim7000SSL
    * Generic network functions
    */
  protected:
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+CNACT?"));
-    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) { return ""; }
+    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) { return 0; }
     streamSkipUntil('\"');
-    String res = stream.readStringUntil('\"');
+    size_t len = streamGetStringBefore('\"', out, cap);
     waitResponse();
-    return res;
+    return len;
   }
 
+#if TINY_GSM_USES(SSL)
   /*
    * Secure socket layer functions
    */
@@ -210,6 +207,7 @@ class TinyGsmSim7000SSL
     certificates[mux] = certificateName;
     return true;
   }
+#endif
 
   /*
    * GPRS functions
@@ -320,6 +318,7 @@ class TinyGsmSim7000SSL
  protected:
   // Follows all battery functions per template
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -466,15 +465,7 @@ class TinyGsmSim7000SSL
       return 0;
     }
 
-    for (int i = 0; i < len_confirmed; i++) {
-      uint32_t startMillis = millis();
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-      sockets[mux]->rx.put(c);
-    }
+    moveStreamToFifo(mux, len_confirmed);
     waitResponse();
     // DBG("### READ:", len_confirmed, "from", mux);
     // make sure the sock available number is accurate again
@@ -484,6 +475,20 @@ class TinyGsmSim7000SSL
     return len_confirmed;
   }
 
+  void modemPollSockets() {
+    bool check_socks = false;
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      GsmClientSim7000SSL* sock = sockets[mux];
+      if (sock && sock->got_data) {
+        sock->got_data = false;
+        check_socks    = true;
+      }
+    }
+    // modemGetAvailable checks all socks, so we only want to do it once
+    // modemGetAvailable calls modemGetConnected(), which also checks all
+    if (check_socks) { modemGetAvailable(0); }
+  }
+
   size_t modemGetAvailable(uint8_t mux) {
     // If the socket doesn't exist, just return
     if (!sockets[mux]) { return 0; }
@@ -583,148 +588,70 @@ class TinyGsmSim7000SSL
     }
     return sockets[mux]->sock_connected;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+CARECV:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("+CADATAIND:"))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-          }
-          data = "";
-          DBG("### Got Data:", mux);
-        } else if (data.endsWith(GF("+CASTATE:"))) {
-          int8_t mux   = streamGetIntBefore(',');
-          int8_t state = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            if (state != 1) {
-              sockets[mux]->sock_connected = false;
-              DBG("### Closed: ", mux);
-            }
-          }
-          data = "";
-        } else if (data.endsWith(GF("*PSNWID:"))) {
-          streamSkipUntil('\n');  // Refresh network name by network
-          data = "";
-          DBG("### Network name updated.");
-        } else if (data.endsWith(GF("*PSUTTZ:"))) {
-          streamSkipUntil('\n');  // Refresh time and time zone by network
-          data = "";
-          DBG("### Network time and time zone updated.");
-        } else if (data.endsWith(GF("+CTZV:"))) {
-          streamSkipUntil('\n');  // Refresh network time zone by network
-          data = "";
-          DBG("### Network time zone updated.");
-        } else if (data.endsWith(GF("DST: "))) {
-          streamSkipUntil(
-              '\n');  // Refresh Network Daylight Saving Time by network
-          data = "";
-          DBG("### Daylight savings time state updated.");
-        } else if (data.endsWith(GF(GSM_NL "SMS Ready" GSM_NL))) {
-          data = "";
-          DBG("### Unexpected module reset!");
-          init();
-          data = "";
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("*PSNWID:"))) {
+      streamSkipUntil('\n');  // Refresh network name by network
+      data = "";
+      DBG("### Network name updated.");
+    } else if (TinyGsmEndsWith(data, GF("*PSUTTZ:"))) {
+      streamSkipUntil('\n');  // Refresh time and time zone by network
+      data = "";
+      DBG("### Network time and time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("+CTZV:"))) {
+      streamSkipUntil('\n');  // Refresh network time zone by network
+      data = "";
+      DBG("### Network time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("DST: "))) {
+      streamSkipUntil('\n');  // Refresh Network Daylight Saving Time by network
+      data = "";
+      DBG("### Daylight savings time state updated.");
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "SMS Ready" GSM_NL))) {
+      data = "";
+      DBG("### Unexpected module reset!");
+      init();
+      data = "";
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF("+CARECV:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+      data = "";
+      DBG("### Got Data:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+CADATAIND:"))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+      }
+      data = "";
+      DBG("### Got Data:", mux);
+    } else if (TinyGsmEndsWith(data, GF("+CASTATE:"))) {
+      int8_t mux   = streamGetIntBefore(',');
+      int8_t state = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        if (state != 1) {
+          sockets[mux]->sock_connected = false;
+          DBG("### Closed: ", mux);
         }
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
   }
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSim7000SSL* sockets[TINY_GSM_MUX_COUNT];
   String               certificates[TINY_GSM_MUX_COUNT];
+#endif
 };
 
 #endif  // SRC_TINYGSMCLIENTSIM7000SSL_H_
@@ -14,18 +14,35 @@
 
 #define TINY_GSM_MUX_COUNT 12
 #define TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+#define TINY_GSM_UDP_NO_BOUNDARIES
 
 #include "TinyGsmClientSIM70xx.h"
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmSSL.tpp"
+#include "TinyGsmUDP.tpp"
 
-class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_KEEPALIVE
+#endif
+
+class TinyGsmSim7080 :
+#if TINY_GSM_USES(TCP)
                        public TinyGsmTCP<TinyGsmSim7080, TINY_GSM_MUX_COUNT>,
-                       public TinyGsmSSL<TinyGsmSim7080> {
+#endif
+#if TINY_GSM_USES(SSL)
+                       public TinyGsmSSL<TinyGsmSim7080>,
+#endif
+#if TINY_GSM_USES(UDP)
+                       public TinyGsmUDP<TinyGsmSim7080, TINY_GSM_MUX_COUNT>,
+#endif
+                       public TinyGsmSim70xx<TinyGsmSim7080> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmSim70xx<TinyGsmSim7080>;
   friend class TinyGsmTCP<TinyGsmSim7080, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSSL<TinyGsmSim7080>;
+  friend class TinyGsmUDP<TinyGsmSim7080, TINY_GSM_MUX_COUNT>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -59,6 +76,7 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -68,6 +86,7 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+CACLOSE="), mux);
       sock_connected = false;
@@ -83,7 +102,9 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -102,6 +123,7 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
 
     virtual int connect(const char* host, uint16_t port,
                         int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -110,15 +132,17 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     }
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
+#endif
 
   /*
    * Constructor
    */
  public:
   explicit TinyGsmSim7080(Stream& stream)
-      : TinyGsmSim70xx<TinyGsmSim7080>(stream),
-        certificates() {
+      : TinyGsmSim70xx<TinyGsmSim7080>(stream) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -163,23 +187,6 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     }
   }
 
-  void maintainImpl() {
-    // Keep listening for modem URC's and proactively iterate through
-    // sockets asking if any data is avaiable
-    bool check_socks = false;
-    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
-      GsmClientSim7080* sock = sockets[mux];
-      if (sock && sock->got_data) {
-        sock->got_data = false;
-        check_socks    = true;
-      }
-    }
-    // modemGetAvailable checks all socks, so we only want to do it once
-    // modemGetAvailable calls modemGetConnected(), which also checks allf
-    if (check_socks) { modemGetAvailable(0); }
-    while (stream.available()) { waitResponse(15, NULL, NULL); }
-  }
-
   /*
    * Power functions
    */
@@ -190,15 +197,16 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
    * Generic network functions
    */
  protected:
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+CNACT?"));
-    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) { return ""; }
+    if (waitResponse(GF(GSM_NL "+CNACT:")) != 1) { return 0; }
     streamSkipUntil('\"');
-    String res = stream.readStringUntil('\"');
+    size_t len = streamGetStringBefore('\"', out, cap);
     waitResponse();
-    return res;
+    return len;
   }
 
+#if TINY_GSM_USES(SSL)
   /*
    * Secure socket layer functions
    */
@@ -208,6 +216,7 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     certificates[mux] = certificateName;
     return true;
   }
+#endif
 
   /*
    * GPRS functions
@@ -325,6 +334,7 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
  protected:
   // Follows all battery functions per template
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -388,6 +398,13 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
       waitResponse();
     }
 
+    // enable keepalive, if the client asked for it
+    GsmClientSim7080* client = sockets[mux];
+    if (client && client->keep_alive_idle > 0) {
+      modemSetKeepAlive(mux, client->keep_alive_idle,
+                        client->keep_alive_interval, client->keep_alive_count);
+    }
+
     // actually open the connection
     // AT+CAOPEN=<cid>,<pdp_index>,<conn_type>,<server>,<port>[,<recv_mode>]
     // <cid> TCP/UDP identifier
@@ -428,13 +445,33 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     return 0 == res;
   }
 
+  bool modemSetKeepAlive(uint8_t mux, uint16_t idle_s, uint16_t interval_s,
+                         uint8_t count) {
+    // AT+CACFG="KEEPALIVE",<cid>,<enable>,<keepidle>,<keepinterval>,<keepcount>
+    // <keepidle> 1-7200 s, <keepinterval> 1-75 s, <keepcount> 1-9
+    // NOTE:  only applies to connections opened afterwards
+    if (idle_s == 0) {
+      sendAT(GF("+CACFG=\"KEEPALIVE\","), mux, GF(",0"));
+    } else {
+      sendAT(GF("+CACFG=\"KEEPALIVE\","), mux, GF(",1,"),
+             constrain(idle_s, 1, 7200), ',', constrain(interval_s, 1, 75),
+             ',', constrain(count, 1, 9));
+    }
+    return waitResponse() == 1;
+  }
+
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     // send data on prompt
     sendAT(GF("+CASEND="), mux, ',', (uint16_t)len);
     if (waitResponse(GF(">")) != 1) { return 0; }
 
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    streamWriteIoVec(iov, count);
 
     // OK after posting data
     if (waitResponse() != 1) { return 0; }
@@ -472,21 +509,27 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
       return 0;
     }
 
-    for (int i = 0; i < len_confirmed; i++) {
-      uint32_t startMillis = millis();
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-      sockets[mux]->rx.put(c);
-    }
+    moveStreamToFifo(mux, len_confirmed);
     waitResponse();
     // make sure the sock available number is accurate again
     sockets[mux]->sock_available = modemGetAvailable(mux);
     return len_confirmed;
   }
 
+  void modemPollSockets() {
+    bool check_socks = false;
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      GsmClientSim7080* sock = sockets[mux];
+      if (sock && sock->got_data) {
+        sock->got_data = false;
+        check_socks    = true;
+      }
+    }
+    // modemGetAvailable checks all socks, so we only want to do it once
+    // modemGetAvailable calls modemGetConnected(), which also checks all
+    if (check_socks) { modemGetAvailable(0); }
+  }
+
   size_t modemGetAvailable(uint8_t mux) {
     // If the socket doesn't exist, just return
     if (!sockets[mux]) { return 0; }
@@ -582,148 +625,129 @@ class TinyGsmSim7080 : public TinyGsmSim70xx<TinyGsmSim7080>,
     }
     return sockets[mux]->sock_connected;
   }
+#endif
 
+#if TINY_GSM_USES(UDP)
   /*
-   * Utilities
+   * UDP related functions
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+CARECV:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("+CADATAIND:"))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-          }
-          data = "";
-          DBG("### Got Data:", mux);
-        } else if (data.endsWith(GF("+CASTATE:"))) {
-          int8_t mux   = streamGetIntBefore(',');
-          int8_t state = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            if (state != 1) {
-              sockets[mux]->sock_connected = false;
-              DBG("### Closed: ", mux);
-            }
-          }
-          data = "";
-        } else if (data.endsWith(GF("*PSNWID:"))) {
-          streamSkipUntil('\n');  // Refresh network name by network
-          data = "";
-          DBG("### Network name updated.");
-        } else if (data.endsWith(GF("*PSUTTZ:"))) {
-          streamSkipUntil('\n');  // Refresh time and time zone by network
-          data = "";
-          DBG("### Network time and time zone updated.");
-        } else if (data.endsWith(GF("+CTZV:"))) {
-          streamSkipUntil('\n');  // Refresh network time zone by network
-          data = "";
-          DBG("### Network time zone updated.");
-        } else if (data.endsWith(GF("DST: "))) {
-          streamSkipUntil(
-              '\n');  // Refresh Network Daylight Saving Time by network
-          data = "";
-          DBG("### Daylight savings time state updated.");
-        } else if (data.endsWith(GF(GSM_NL "SMS Ready" GSM_NL))) {
-          data = "";
-          DBG("### Unexpected module reset!");
-          init();
-          data = "";
-        }
-      }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
+ protected:
+  // The module only sends UDP on a connected socket and cannot bind it to a
+  // local port, so the socket is opened with +CAOPEN for the first datagram
+  // and reopened when the peer changes
+  bool modemUdpBegin(uint8_t*, uint16_t) {
+    return true;
+  }
+
+  bool modemUdpSend(uint8_t mux, const char* host, uint16_t port,
+                    const uint8_t* buf, size_t len, bool newPeer) {
+    if (newPeer) {
+      sendAT(GF("+CACLOSE="), mux);
+      waitResponse();  // Gives an error if the socket wasn't open yet
+      sendAT(GF("+CACID="), mux);
+      if (waitResponse() != 1) { return false; }
+      sendAT(GF("+CASSLCFG="), mux, ',', GF("SSL,0"));
+      waitResponse();
+      sendAT(GF("+CAOPEN="), mux, GF(",0,\"UDP\",\""), host, GF("\","),
+             port);
+      if (waitResponse(75000L, GF(GSM_NL "+CAOPEN:")) != 1) { return false; }
+      streamSkipUntil(',');  // Skip mux
+      int8_t res = streamGetIntBefore('\n');
+      waitResponse();
+      if (res != 0) { return false; }
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
+    return modemSend(buf, len, mux) == static_cast<int16_t>(len);
   }
 
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+  // The module keeps received UDP as a stream and announces it without its
+  // length, so each +CARECV read is taken for one datagram, and the
+  // datagrams that arrive between two reads come back together; see
+  // TINY_GSM_UDP_NO_BOUNDARIES
+  int modemUdpReceive(uint8_t mux, uint8_t* buf, size_t size, String&,
+                      uint16_t&) {
+    sendAT(GF("+CARECV="), mux, ',', (uint16_t)size);
+    if (waitResponse(GF("+CARECV:")) != 1) { return 0; }
+    // +CARECV: <len>,<data>  or  +CARECV: 0
+    int16_t len = stream.parseInt();
+    if (len > 0) {
+      streamSkipUntil(',');  // skip the comma
+      len = stream.readBytes(buf, len);
+    }
+    waitResponse();
+    return len;
   }
 
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+  void modemUdpStop(uint8_t mux) {
+    sendAT(GF("+CACLOSE="), mux);
+    waitResponse();
+  }
+#endif
+
+  /*
+   * Utilities
+   */
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("*PSNWID:"))) {
+      streamSkipUntil('\n');  // Refresh network name by network
+      data = "";
+      DBG("### Network name updated.");
+    } else if (TinyGsmEndsWith(data, GF("*PSUTTZ:"))) {
+      streamSkipUntil('\n');  // Refresh time and time zone by network
+      data = "";
+      DBG("### Network time and time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("+CTZV:"))) {
+      streamSkipUntil('\n');  // Refresh network time zone by network
+      data = "";
+      DBG("### Network time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("DST: "))) {
+      streamSkipUntil('\n');  // Refresh Network Daylight Saving Time by network
+      data = "";
+      DBG("### Daylight savings time state updated.");
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "SMS Ready" GSM_NL))) {
+      data = "";
+      DBG("### Unexpected module reset!");
+      init();
+      data = "";
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF("+CARECV:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+      data = "";
+      DBG("### Got Data:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+CADATAIND:"))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+      }
+#if TINY_GSM_USES(UDP)
+      udpReceived(mux);
+#endif
+      data = "";
+      DBG("### Got Data:", mux);
+    } else if (TinyGsmEndsWith(data, GF("+CASTATE:"))) {
+      int8_t mux   = streamGetIntBefore(',');
+      int8_t state = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        if (state != 1) {
+          sockets[mux]->sock_connected = false;
+          DBG("### Closed: ", mux);
+        }
+      }
+      data = "";
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
   }
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSim7080* sockets[TINY_GSM_MUX_COUNT];
   String            certificates[TINY_GSM_MUX_COUNT];
+#endif
 };
 
 #endif  // SRC_TINYGSMCLIENTSIM7080_H_
@@ -21,14 +21,6 @@
 #include "TinyGsmNTP.tpp"
 #include "TinyGsmGSMLocation.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -40,14 +32,27 @@ enum RegStatus {
 };
 
 template <class modemType>
-class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
-                       public TinyGsmGPRS<TinyGsmSim70xx<modemType>>,
+class TinyGsmSim70xx : public TinyGsmAtCore,
+#if TINY_GSM_USES(SMS)
                        public TinyGsmSMS<TinyGsmSim70xx<modemType>>,
+#endif
+#if TINY_GSM_USES(GPS)
                        public TinyGsmGPS<TinyGsmSim70xx<modemType>>,
+#endif
+#if TINY_GSM_USES(TIME)
                        public TinyGsmTime<TinyGsmSim70xx<modemType>>,
+#endif
+#if TINY_GSM_USES(NTP)
                        public TinyGsmNTP<TinyGsmSim70xx<modemType>>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                        public TinyGsmBattery<TinyGsmSim70xx<modemType>>,
-                       public TinyGsmGSMLocation<TinyGsmSim70xx<modemType>> {
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
+                       public TinyGsmGSMLocation<TinyGsmSim70xx<modemType>>,
+#endif
+                       public TinyGsmModem<TinyGsmSim70xx<modemType>>,
+                       public TinyGsmGPRS<TinyGsmSim70xx<modemType>> {
   friend class TinyGsmModem<TinyGsmSim70xx<modemType>>;
   friend class TinyGsmGPRS<TinyGsmSim70xx<modemType>>;
   friend class TinyGsmSMS<TinyGsmSim70xx<modemType>>;
@@ -72,7 +77,8 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
    * Constructor
    */
  public:
-  explicit TinyGsmSim70xx(Stream& stream) : stream(stream) {}
+  explicit TinyGsmSim70xx(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<modemType>) {}
 
   /*
    * Basic functions
@@ -82,18 +88,15 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
     return thisModem().initImpl(pin);
   }
 
-  String getModemNameImpl() {
-    String name = "SIMCom SIM7000";
-
+  size_t getModemNameImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+GMM"));
-    String res2;
-    if (thisModem().waitResponse(5000L, res2) != 1) { return name; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.replace("_", " ");
-    res2.trim();
-
-    name = res2;
-    return name;
+    if (!thisModem().streamGetLines(out, cap, " ", 5000L)) {
+      return TinyGsmCopy(out, cap, "SIMCom SIM7000");
+    }
+    for (char* c = out; *c; c++) {
+      if (*c == '_') { *c = ' '; }
+    }
+    return strlen(out);
   }
 
   bool factoryDefaultImpl() {           // these commands aren't supported
@@ -235,8 +238,8 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
     return thisModem().waitResponse() == 1;
   }
 
-  String getLocalIPImpl() {
-    return thisModem().getLocalIPImpl();
+  size_t getLocalIPImpl(char* out, size_t cap) {
+    return thisModem().getLocalIPImpl(out, cap);
   }
 
   /*
@@ -258,13 +261,12 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
    */
  protected:
   // Doesn't return the "+CCID" before the number
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CCID"));
-    if (thisModem().waitResponse(GF(GSM_NL)) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (thisModem().waitResponse(GF(GSM_NL)) != 1) { return 0; }
+    thisModem().streamGetStringBefore('\n', out, cap);
     thisModem().waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -273,6 +275,7 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
  protected:
   // Follows all messaging functions per template
 
+#if TINY_GSM_USES(GPS)
   /*
    * GPS/GNSS/GLONASS location functions
    */
@@ -291,15 +294,14 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
   }
 
   // get the RAW GPS output
-  String getGPSrawImpl() {
+  size_t getGPSrawImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CGNSINF"));
     if (thisModem().waitResponse(10000L, GF(GSM_NL "+CGNSINF:")) != 1) {
-      return "";
+      return 0;
     }
-    String res = stream.readStringUntil('\n');
+    thisModem().streamGetStringBefore('\n', out, cap);
     thisModem().waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // get GPS informations
@@ -384,6 +386,7 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
     thisModem().waitResponse();
     return false;
   }
+#endif
 
   /*
    * Time functions
@@ -406,51 +409,6 @@ class TinyGsmSim70xx : public TinyGsmModem<TinyGsmSim70xx<modemType>>,
    */
   // should implement in sub-classes
 
-  /*
-   * Utilities
-   */
- public:
-  // should implement in sub-classes
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return thisModem().waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return thisModem().waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return thisModem().waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
 
  protected:
   const char* gsmNL = GSM_NL;
@@ -27,15 +27,12 @@
 #include "TinyGsmTime.tpp"
 #include "TinyGsmNTP.tpp"
 
-
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_SERVER
+#define TINY_GSM_MODEM_HAS_DNS
 #endif
 
+
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -46,17 +43,37 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
-                       public TinyGsmGPRS<TinyGsmSim7600>,
+class TinyGsmSim7600 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                        public TinyGsmTCP<TinyGsmSim7600, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SMS)
                        public TinyGsmSMS<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
                        public TinyGsmGSMLocation<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(GPS)
                        public TinyGsmGPS<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(TIME)
                        public TinyGsmTime<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(NTP)
                        public TinyGsmNTP<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                        public TinyGsmBattery<TinyGsmSim7600>,
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
                        public TinyGsmTemperature<TinyGsmSim7600>,
-                       public TinyGsmCalling<TinyGsmSim7600> {
+#endif
+#if TINY_GSM_USES(CALLING)
+                       public TinyGsmCalling<TinyGsmSim7600>,
+#endif
+                       public TinyGsmModem<TinyGsmSim7600>,
+                       public TinyGsmGPRS<TinyGsmSim7600> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmSim7600>;
   friend class TinyGsmGPRS<TinyGsmSim7600>;
   friend class TinyGsmTCP<TinyGsmSim7600, TINY_GSM_MUX_COUNT>;
@@ -69,6 +86,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
   friend class TinyGsmTemperature<TinyGsmSim7600>;
   friend class TinyGsmCalling<TinyGsmSim7600>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -102,6 +120,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -111,6 +130,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+CIPCLOSE="), mux);
       sock_connected = false;
@@ -126,7 +146,9 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -143,6 +165,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
 
   public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -152,13 +175,17 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
   */
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmSim7600(Stream& stream) : stream(stream) {
+  explicit TinyGsmSim7600(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<TinyGsmSim7600>) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -203,19 +230,16 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     }
   }
 
-  String getModemNameImpl() {
-    String name = "SIMCom SIM7600";
-
+  size_t getModemNameImpl(char* out, size_t cap) {
     sendAT(GF("+CGMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return name; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.replace("_", " ");
-    res2.trim();
-
-    name = res2;
-    DBG("### Modem:", name);
-    return name;
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "SIMCom SIM7600");
+    }
+    for (char* c = out; *c; c++) {
+      if (*c == '_') { *c = ' '; }
+    }
+    DBG("### Modem:", out);
+    return strlen(out);
   }
 
   bool factoryDefaultImpl() {  // these commands aren't supported
@@ -230,7 +254,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     if (!testAT()) { return false; }
     sendAT(GF("+CRESET"));
     if (waitResponse(10000L) != 1) { return false; }
-    delay(5000L);  // TODO(?):  Test this delay!
+    TINY_GSM_DELAY(5000L);  // TODO(?):  Test this delay!
     return init(pin);
   }
 
@@ -241,7 +265,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
 
   bool radioOffImpl() {
     if (!setPhoneFunctionality(4)) { return false; }
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return true;
   }
 
@@ -291,15 +315,11 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     return waitResponse() == 1;
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+IPADDR"));  // Inquire Socket PDP address
     // sendAT(GF("+CGPADDR=1"));  // Show PDP address
-    String res;
-    if (waitResponse(10000L, res) != 1) { return ""; }
-    res.replace(GSM_NL "OK" GSM_NL, "");
-    res.replace(GSM_NL, "");
-    res.trim();
-    return res;
+    if (!streamGetLines(out, cap, "", 10000L)) { return 0; }
+    return strlen(out);
   }
 
   /*
@@ -397,15 +417,15 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
    */
  protected:
   // Gets the CCID of a sim card via AT+CCID
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+CICCID"));
-    if (waitResponse(GF(GSM_NL "+ICCID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+ICCID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
+#if TINY_GSM_USES(CALLING)
   /*
    * Phone Call functions
    */
@@ -414,6 +434,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     sendAT(GF("+CHUP"));
     return waitResponse() == 1;
   }
+#endif
 
   /*
    * Messaging functions
@@ -427,6 +448,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
  protected:
   // Can return a GSM-based location from CLBS as per the template
 
+#if TINY_GSM_USES(GPS)
   /*
    * GPS/GNSS/GLONASS location functions
    */
@@ -445,13 +467,12 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
   }
 
   // get the RAW GPS output
-  String getGPSrawImpl() {
+  size_t getGPSrawImpl(char* out, size_t cap) {
     sendAT(GF("+CGNSSINFO"));
-    if (waitResponse(GF(GSM_NL "+CGNSSINFO:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+CGNSSINFO:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // get GPS informations
@@ -561,6 +582,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     if (waitResponse(GF(GSM_NL "+CGNSSMODE:")) != 1) { return 0; }
     return stream.readStringUntil(',').toInt();
   }
+#endif
 
 
   /*
@@ -574,6 +596,7 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
    */
   // Can sync with server using CNTP as per template
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -583,12 +606,11 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     sendAT(GF("+CBC"));
     if (waitResponse(GF(GSM_NL "+CBC:")) != 1) { return 0; }
 
-    // get voltage in VOLTS
-    float voltage = streamGetFloatBefore('\n');
+    // get voltage in VOLTS, as millivolts
+    int32_t res = 0;
+    streamGetDecimalBefore('\n', 3, res);
     // Wait for final OK
     waitResponse();
-    // Return millivolts
-    uint16_t res = voltage * 1000;
     return res;
   }
 
@@ -603,7 +625,9 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     milliVolts  = getBattVoltage();
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -618,7 +642,9 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     waitResponse();
     return res;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -631,23 +657,52 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     if (waitResponse() != 1) { return false; }
 
     // Establish a connection in multi-socket mode
-    uint32_t timeout_ms = ((uint32_t)timeout_s) * 1000;
-    sendAT(GF("+CIPOPEN="), mux, ',', GF("\"TCP"), GF("\",\""), host, GF("\","),
-           port);
+    uint32_t    timeout_ms = ((uint32_t)timeout_s) * 1000;
+    String      address;
+    const char* remote = dnsConnectTarget(host, address, timeout_ms);
+    if (!remote) { return false; }
+    sendAT(GF("+CIPOPEN="), mux, ',', GF("\"TCP"), GF("\",\""), remote,
+           GF("\","), port);
     // The reply is OK followed by +CIPOPEN: <link_num>,<err> where <link_num>
     // is the mux number and <err> should be 0 if there's no error
-    if (waitResponse(timeout_ms, GF(GSM_NL "+CIPOPEN:")) != 1) { return false; }
-    uint8_t opened_mux    = streamGetIntBefore(',');
-    uint8_t opened_result = streamGetIntBefore('\n');
-    if (opened_mux != mux || opened_result != 0) return false;
-    return true;
+    bool opened = false;
+    if (waitResponse(timeout_ms, GF(GSM_NL "+CIPOPEN:")) == 1) {
+      uint8_t opened_mux    = streamGetIntBefore(',');
+      uint8_t opened_result = streamGetIntBefore('\n');
+      opened                = (opened_mux == mux && opened_result == 0);
+    }
+    if (!opened && remote != host) { dnsCacheRemove(host); }
+    return opened;
+  }
+
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t&) {
+    sendAT(GF("+CDNSGIP=\""), host, '"');
+    // +CDNSGIP: 1,"<domain name>","<IP address>"
+    // +CDNSGIP: 0,<dns error code>
+    if (waitResponse(timeout_ms, GF("+CDNSGIP:")) != 1) { return false; }
+    if (streamGetIntBefore(',') != 1) {
+      streamSkipUntil('\n');  // Skip the error code
+      waitResponse();
+      return false;
+    }
+    streamSkipUntil(',');  // Skip the domain name
+    streamSkipUntil('"');
+    String res = stream.readStringUntil('"');
+    waitResponse();
+    return ip.fromString(res);
   }
 
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     sendAT(GF("+CIPSEND="), mux, ',', (uint16_t)len);
     if (waitResponse(GF(">")) != 1) { return 0; }
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    streamWriteIoVec(iov, count);
     if (waitResponse(GF(GSM_NL "+CIPSEND:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
     streamSkipUntil(',');  // Skip requested bytes to send
@@ -670,11 +725,11 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     //  ^^ Requested number of data bytes (1-1460 bytes)to be read
     int16_t len_confirmed = streamGetIntBefore('\n');
     // ^^ The data length which not read in the buffer
-    for (int i = 0; i < len_requested; i++) {
-      uint32_t startMillis = millis();
 #ifdef TINY_GSM_USE_HEX
+    for (int i = 0; i < len_requested; i++) {
+      uint32_t startMillis = TINY_GSM_MILLIS();
       while (stream.available() < 2 &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
+             (TINY_GSM_MILLIS() - startMillis < sockets[mux]->_timeout)) {
         TINY_GSM_YIELD();
       }
       char buf[4] = {
@@ -683,15 +738,12 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
       buf[0] = stream.read();
       buf[1] = stream.read();
       char c = strtol(buf, NULL, 16);
-#else
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-#endif
       sockets[mux]->rx.put(c);
+      TINY_GSM_STAT(payload(1));
     }
+#else
+    moveStreamToFifo(mux, len_requested);
+#endif
     // DBG("### READ:", len_requested, "from", mux);
     // sockets[mux]->sock_available = modemGetAvailable(mux);
     sockets[mux]->sock_available = len_confirmed;
@@ -699,8 +751,30 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
     return len_requested;
   }
 
+  void modemPollSockets() {
+    // +CIPRXGET=4 only reports on one socket, but modemGetConnected() reads
+    // the state of all of them at once
+    bool check_state = false;
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      GsmClientSim7600* sock = sockets[mux];
+      if (sock && sock->got_data) {
+        sock->got_data       = false;
+        sock->sock_available = modemGetBuffered(mux);
+        if (!sock->sock_available) { check_state = true; }
+      }
+    }
+    if (check_state) { modemGetConnected(0); }
+  }
+
   size_t modemGetAvailable(uint8_t mux) {
     if (!sockets[mux]) return 0;
+    size_t result = modemGetBuffered(mux);
+    // DBG("### Available:", result, "on", mux);
+    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
+    return result;
+  }
+
+  size_t modemGetBuffered(uint8_t mux) {
     sendAT(GF("+CIPRXGET=4,"), mux);
     size_t result = 0;
     if (waitResponse(GF("+CIPRXGET:")) == 1) {
@@ -709,8 +783,6 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
       result = streamGetIntBefore('\n');
       waitResponse();
     }
-    // DBG("### Available:", result, "on", mux);
-    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
     return result;
   }
 
@@ -731,135 +803,86 @@ class TinyGsmSim7600 : public TinyGsmModem<TinyGsmSim7600>,
   }
 
   /*
-   * Utilities
+   * Server related functions
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+CIPRXGET:"))) {
-          int8_t mode = streamGetIntBefore(',');
-          if (mode == 1) {
-            int8_t mux = streamGetIntBefore('\n');
-            if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-              sockets[mux]->got_data = true;
-            }
-            data = "";
-            // DBG("### Got Data:", mux);
-          } else {
-            data += mode;
-          }
-        } else if (data.endsWith(GF(GSM_NL "+RECEIVE:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          // DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("+IPCLOSE:"))) {
-          int8_t mux = streamGetIntBefore(',');
-          streamSkipUntil('\n');  // Skip the reason code
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("+CIPEVENT:"))) {
-          // Need to close all open sockets and release the network library.
-          // User will then need to reconnect.
-          DBG("### Network error!");
-          if (!isGprsConnected()) { gprsDisconnect(); }
-          data = "";
-        }
-      }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
+ protected:
+  // Up to 4 servers, incoming connections get free link numbers from the
+  // module
+  bool modemListen(uint16_t port, uint8_t server) {
+    // Accepted connections are read manually too
+    sendAT(GF("+CIPRXGET=1"));
+    if (waitResponse() != 1) { return false; }
+    // AT+SERVERSTART=<port>,<server_index>, needs the network opened by
+    // gprsConnect
+    sendAT(GF("+SERVERSTART="), port, ',', server);
+    return waitResponse() == 1;
   }
 
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+  void modemStopListen(uint16_t, uint8_t server) {
+    sendAT(GF("+SERVERSTOP="), server);
+    // +SERVERSTOP: <server_index>,<err> and then OK
+    waitResponse(GF("+SERVERSTOP:"));
+    streamSkipUntil('\n');
+    waitResponse();
   }
+#endif
 
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+  /*
+   * Utilities
+   */
+ protected:
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+CIPEVENT:"))) {
+      // Need to close all open sockets and release the network library.
+      // User will then need to reconnect.
+      DBG("### Network error!");
+      if (!isGprsConnected()) { gprsDisconnect(); }
+      data = "";
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+CIPRXGET:"))) {
+      int8_t mode = streamGetIntBefore(',');
+      if (mode == 1) {
+        int8_t mux = streamGetIntBefore('\n');
+        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+          sockets[mux]->got_data = true;
+        }
+        data = "";
+        // DBG("### Got Data:", mux);
+      } else {
+        data += mode;
+      }
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+RECEIVE:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+      data = "";
+      // DBG("### Got Data:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+IPCLOSE:"))) {
+      int8_t mux = streamGetIntBefore(',');
+      streamSkipUntil('\n');  // Skip the reason code
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### Closed: ", mux);
+    } else if (TinyGsmEndsWith(data, GF("+CLIENT:"))) {
+      // +CLIENT: <link_num>,<server_index>,<client_IP>:<port>
+      int8_t mux = streamGetIntBefore(',');
+      streamSkipUntil('\n');
+      modemIncoming(mux);
+      data = "";
+      DBG("### Incoming: ", mux);
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+    }
   }
 
- public:
-  Stream& stream;
-
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSim7600* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*       gsmNL = GSM_NL;
 };
 
@@ -15,6 +15,7 @@
 
 #define TINY_GSM_MUX_COUNT 5
 #define TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+#define TINY_GSM_UDP_NO_BOUNDARIES
 
 #include "TinyGsmBattery.tpp"
 #include "TinyGsmCalling.tpp"
@@ -25,14 +26,13 @@
 #include "TinyGsmSSL.tpp"
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTime.tpp"
+#include "TinyGsmUDP.tpp"
 #include "TinyGsmNTP.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_SERVER
+#define TINY_GSM_MODEM_HAS_KEEPALIVE
+#define TINY_GSM_MODEM_HAS_DNS
 #endif
 
 enum RegStatus {
@@ -44,19 +44,41 @@ enum RegStatus {
   REG_OK_ROAMING   = 5,
   REG_UNKNOWN      = 4,
 };
-class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
-                      public TinyGsmGPRS<TinyGsmSim800>,
+class TinyGsmSim800 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                       public TinyGsmTCP<TinyGsmSim800, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(UDP)
+                      public TinyGsmUDP<TinyGsmSim800, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
                       public TinyGsmSSL<TinyGsmSim800>,
+#endif
+#if TINY_GSM_USES(CALLING)
                       public TinyGsmCalling<TinyGsmSim800>,
+#endif
+#if TINY_GSM_USES(SMS)
                       public TinyGsmSMS<TinyGsmSim800>,
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
                       public TinyGsmGSMLocation<TinyGsmSim800>,
+#endif
+#if TINY_GSM_USES(TIME)
                       public TinyGsmTime<TinyGsmSim800>,
+#endif
+#if TINY_GSM_USES(NTP)
                       public TinyGsmNTP<TinyGsmSim800>,
-                      public TinyGsmBattery<TinyGsmSim800> {
+#endif
+#if TINY_GSM_USES(BATTERY)
+                      public TinyGsmBattery<TinyGsmSim800>,
+#endif
+                      public TinyGsmModem<TinyGsmSim800>,
+                      public TinyGsmGPRS<TinyGsmSim800> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmSim800>;
   friend class TinyGsmGPRS<TinyGsmSim800>;
   friend class TinyGsmTCP<TinyGsmSim800, TINY_GSM_MUX_COUNT>;
+  friend class TinyGsmUDP<TinyGsmSim800, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSSL<TinyGsmSim800>;
   friend class TinyGsmCalling<TinyGsmSim800>;
   friend class TinyGsmSMS<TinyGsmSim800>;
@@ -65,6 +87,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
   friend class TinyGsmNTP<TinyGsmSim800>;
   friend class TinyGsmBattery<TinyGsmSim800>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -98,6 +121,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -107,6 +131,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+CIPCLOSE="), mux, GF(",1"));  // Quick close
       sock_connected = false;
@@ -122,7 +147,9 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -136,6 +163,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -144,13 +172,17 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     }
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmSim800(Stream& stream) : stream(stream) {
+  explicit TinyGsmSim800(Stream& stream)
+      : TinyGsmAtCore(stream, &urcsOf<TinyGsmSim800>) {
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -198,8 +230,8 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     }
   }
 
-  String getModemNameImpl() {
-    String name = "";
+  size_t getModemNameImpl(char* out, size_t cap) {
+    const char* name = "";
 #if defined(TINY_GSM_MODEM_SIM800)
     name = "SIMCom SIM800";
 #elif defined(TINY_GSM_MODEM_SIM808)
@@ -211,15 +243,14 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
 #endif
 
     sendAT(GF("+GMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return name; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.replace("_", " ");
-    res2.trim();
-
-    name = res2;
-    DBG("### Modem:", name);
-    return name;
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, name);
+    }
+    for (char* c = out; *c; c++) {
+      if (*c == '_') { *c = ' '; }
+    }
+    DBG("### Modem:", out);
+    return strlen(out);
   }
 
   bool factoryDefaultImpl() {
@@ -259,7 +290,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     waitResponse();
     if (!setPhoneFunctionality(0)) { return false; }
     if (!setPhoneFunctionality(1, true)) { return false; }
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return init(pin);
   }
 
@@ -300,14 +331,10 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     return (s == REG_OK_HOME || s == REG_OK_ROAMING);
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+CIFSR;E0"));
-    String res;
-    if (waitResponse(10000L, res) != 1) { return ""; }
-    res.replace(GSM_NL "OK" GSM_NL, "");
-    res.replace(GSM_NL, "");
-    res.trim();
-    return res;
+    if (!streamGetLines(out, cap, "", 10000L)) { return 0; }
+    return strlen(out);
   }
 
   /*
@@ -316,6 +343,9 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
  protected:
   bool gprsConnectImpl(const char* apn, const char* user = NULL,
                        const char* pwd = NULL) {
+    // Reuse the connection if the module still has it up on the same APN
+    if (gprsResume(apn, user, pwd)) { return true; }
+
     gprsDisconnect();
 
     // Bearer settings for applications based on IP
@@ -388,6 +418,87 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     return true;
   }
 
+  // Checks the state left behind by an earlier gprsConnect (e.g. before a
+  // socket drop or an MCU reset) and only redoes the missing steps.  Returns
+  // false if the TCP/IP stack has to be brought up from scratch.
+  bool gprsResume(const char* apn, const char* user, const char* pwd) {
+    // The whole state in one batch: the APN, user and password the TCP/IP
+    // task was started with, the PDP context, the bearer and, last, as its
+    // OK comes before its own lines, the TCP/IP stack
+    sendAT(GF("+CSTT?;+CGACT?;+SAPBR=2,1;+CIPSTATUS"));
+    bool    sameTask    = false;
+    int8_t  ctxState    = 0;
+    int8_t  bearerState = 0;
+    char    state[16];
+    uint8_t connections = 0;
+    for (;;) {
+      int8_t rsp = waitResponse(10000L, GF("+CSTT:"), GF("+CGACT: 1,"),
+                                GF("+SAPBR:"), GF("STATE: "), GFP(GSM_ERROR));
+      if (rsp == 1) {
+        // +CSTT: "<apn>","<user>","<pwd>"
+        sameTask = streamQuotedIs(apn) && streamQuotedIs(user) &&
+            streamQuotedIs(pwd);
+      } else if (rsp == 2) {
+        // +CGACT: <cid>,<state>
+        ctxState = streamGetIntBefore('\n');
+      } else if (rsp == 3) {
+        // +SAPBR: <cid>,<status>,<ip_addr>, <status> 1: connected
+        streamSkipUntil(',');  // Skip bearer id
+        bearerState = streamGetIntBefore(',');
+      } else if (rsp == 4) {
+        connections = streamGetIpStatus(state, sizeof(state));
+        break;
+      } else {
+        return false;
+      }
+    }
+
+    // The TCP/IP stack must be in multi-IP mode, which lists the
+    // connections, with a PDP context up...
+    // STATE: IP GPRSACT (no address asked for yet), IP STATUS, IP PROCESSING
+    bool needAddress = !strcmp(state, "IP GPRSACT");
+    if (!connections || !sameTask ||
+        (!needAddress && strcmp(state, "IP STATUS") &&
+         strcmp(state, "IP PROCESSING"))) {
+      return false;
+    }
+
+    // Re-activate the PDP context if it was dropped
+    if (ctxState != 1) {
+      sendAT(GF("+CGDCONT=1,\"IP\",\""), apn, '"');
+      waitResponse();
+      sendAT(GF("+CGACT=1,1"));
+      if (waitResponse(60000L) != 1) { return false; }
+    }
+
+    // Re-open the bearer if it was closed
+    if (bearerState != 1) {
+      sendAT(GF("+SAPBR=3,1,\"Contype\",\"GPRS\""));
+      waitResponse();
+      sendAT(GF("+SAPBR=3,1,\"APN\",\""), apn, '"');
+      waitResponse();
+      if (user && strlen(user) > 0) {
+        sendAT(GF("+SAPBR=3,1,\"USER\",\""), user, '"');
+        waitResponse();
+      }
+      if (pwd && strlen(pwd) > 0) {
+        sendAT(GF("+SAPBR=3,1,\"PWD\",\""), pwd, '"');
+        waitResponse();
+      }
+      sendAT(GF("+SAPBR=1,1"));
+      if (waitResponse(85000L) != 1) { return false; }
+    }
+
+    // The local address has to be read once before sockets can be opened
+    if (needAddress) {
+      sendAT(GF("+CIFSR;E0"));
+      if (waitResponse(10000L) != 1) { return false; }
+    }
+
+    DBG(GF("### Reusing the existing GPRS connection"));
+    return true;
+  }
+
   bool gprsDisconnectImpl() {
     // Shut the TCP/IP connection
     // CIPSHUT will close *all* open connections
@@ -405,17 +516,18 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
    */
  protected:
   // May not return the "+CCID" before the number
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+CCID"));
-    if (waitResponse(GF(GSM_NL)) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL)) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
     // Trim out the CCID header in case it is there
-    res.replace("CCID:", "");
-    res.trim();
-    return res;
+    char* header = strstr(out, "CCID:");
+    if (header) { memmove(header, header + 5, strlen(header + 5) + 1); }
+    return TinyGsmTrim(out);
   }
 
+#if TINY_GSM_USES(CALLING)
   /*
    * Phone Call functions
    */
@@ -424,6 +536,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     sendAT(GF("+GSMBUSY="), busy ? 1 : 0);
     return waitResponse() == 1;
   }
+#endif
 
   /*
    * Messaging functions
@@ -479,7 +592,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
 
   bool playToolkitTone(uint8_t tone, uint32_t duration) {
     sendAT(GF("STTONE="), 1, tone);
-    delay(duration);
+    TINY_GSM_DELAY(duration);
     sendAT(GF("STTONE="), 0);
     return waitResponse();
   }
@@ -506,6 +619,7 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
    */
   // Can sync with server using CNTP as per template
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -531,20 +645,72 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     if (waitResponse() != 1) return false;
 #endif
 #endif
-    sendAT(GF("+CIPSTART="), mux, ',', GF("\"TCP"), GF("\",\""), host,
+    // SSL needs the real host name, plain TCP can use a cached address
+    String      address;
+    const char* remote = ssl ? host
+                             : dnsConnectTarget(host, address, timeout_ms);
+    if (!remote) { return false; }
+    // Keepalive is module-wide, so it is set for each socket that asks for it
+    // and turned back off for the sockets that do not
+    GsmClientSim800* client = sockets[mux];
+    if (client && (client->keep_alive_idle > 0 || keepAliveOn)) {
+      modemSetKeepAlive(mux, client->keep_alive_idle,
+                        client->keep_alive_interval, client->keep_alive_count);
+    }
+    sendAT(GF("+CIPSTART="), mux, ',', GF("\"TCP"), GF("\",\""), remote,
            GF("\","), port);
     rsp = waitResponse(
         timeout_ms, GF("CONNECT OK" GSM_NL), GF("CONNECT FAIL" GSM_NL),
         GF("ALREADY CONNECT" GSM_NL), GF("ERROR" GSM_NL),
         GF("CLOSE OK" GSM_NL));  // Happens when HTTPS handshake fails
+    if (rsp != 1 && remote != host) { dnsCacheRemove(host); }
     return (1 == rsp);
   }
 
+  bool modemSetKeepAlive(uint8_t, uint16_t idle_s, uint16_t interval_s,
+                         uint8_t count) {
+    // AT+CIPTKA=<mode>,<keepIdle>,<keepInterval>,<keepCount>
+    // <keepIdle> 30-7200 s, <keepInterval> 30-600 s, <keepCount> 1-9
+    if (idle_s == 0) {
+      sendAT(GF("+CIPTKA=0"));
+    } else {
+      sendAT(GF("+CIPTKA=1,"), constrain(idle_s, 30, 7200), ',',
+             constrain(interval_s, 30, 600), ',', constrain(count, 1, 9));
+    }
+    if (waitResponse() != 1) { return false; }
+    keepAliveOn = idle_s > 0;
+    return true;
+  }
+
+  // Requires the DNS servers set by CDNSCFG in gprsConnect
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t&) {
+    sendAT(GF("+CDNSGIP=\""), host, '"');
+    if (waitResponse() != 1) { return false; }
+    // +CDNSGIP: 1,"<domain name>","<IP1>"[,"<IP2>"]
+    // +CDNSGIP: 0,<dns error code>
+    if (waitResponse(timeout_ms, GF("+CDNSGIP:")) != 1) { return false; }
+    if (streamGetIntBefore(',') != 1) {
+      streamSkipUntil('\n');  // Skip the error code
+      return false;
+    }
+    streamSkipUntil(',');  // Skip the domain name
+    streamSkipUntil('"');
+    String res = stream.readStringUntil('"');
+    streamSkipUntil('\n');  // Skip any secondary address
+    return ip.fromString(res);
+  }
+
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     sendAT(GF("+CIPSEND="), mux, ',', (uint16_t)len);
     if (waitResponse(GF(">")) != 1) { return 0; }
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    streamWriteIoVec(iov, count);
     if (waitResponse(GF(GSM_NL "DATA ACCEPT:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
     return streamGetIntBefore('\n');
@@ -569,11 +735,11 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     // SRGD NOTE:  Contrary to above (which is copied from AT command manual)
     // this is actually be the number of bytes that will be remaining in the
     // buffer after the read.
-    for (int i = 0; i < len_requested; i++) {
-      uint32_t startMillis = millis();
 #ifdef TINY_GSM_USE_HEX
+    for (int i = 0; i < len_requested; i++) {
+      uint32_t startMillis = TINY_GSM_MILLIS();
       while (stream.available() < 2 &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
+             (TINY_GSM_MILLIS() - startMillis < sockets[mux]->_timeout)) {
         TINY_GSM_YIELD();
       }
       char buf[4] = {
@@ -582,15 +748,12 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
       buf[0] = stream.read();
       buf[1] = stream.read();
       char c = strtol(buf, NULL, 16);
-#else
-      while (!stream.available() &&
-             (millis() - startMillis < sockets[mux]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-#endif
       sockets[mux]->rx.put(c);
+      TINY_GSM_STAT(payload(1));
     }
+#else
+    moveStreamToFifo(mux, len_requested);
+#endif
     // DBG("### READ:", len_requested, "from", mux);
     // sockets[mux]->sock_available = modemGetAvailable(mux);
     sockets[mux]->sock_available = len_confirmed;
@@ -598,8 +761,30 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     return len_requested;
   }
 
+  void modemPollSockets() {
+    // +CIPRXGET=4 only reports on one socket, but a single +CIPSTATUS gives
+    // the state of all of them
+    bool check_state = false;
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      GsmClientSim800* sock = sockets[mux];
+      if (sock && sock->got_data) {
+        sock->got_data       = false;
+        sock->sock_available = modemGetBuffered(mux);
+        if (!sock->sock_available) { check_state = true; }
+      }
+    }
+    if (check_state) { modemGetAllConnected(); }
+  }
+
   size_t modemGetAvailable(uint8_t mux) {
     if (!sockets[mux]) return 0;
+    size_t result = modemGetBuffered(mux);
+    // DBG("### Available:", result, "on", mux);
+    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
+    return result;
+  }
+
+  size_t modemGetBuffered(uint8_t mux) {
     sendAT(GF("+CIPRXGET=4,"), mux);
     size_t result = 0;
     if (waitResponse(GF("+CIPRXGET:")) == 1) {
@@ -608,8 +793,6 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
       result = streamGetIntBefore('\n');
       waitResponse();
     }
-    // DBG("### Available:", result, "on", mux);
-    if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
     return result;
   }
 
@@ -623,149 +806,199 @@ class TinyGsmSim800 : public TinyGsmModem<TinyGsmSim800>,
     return 1 == res;
   }
 
+  // Updates sock_connected of every socket from a single +CIPSTATUS
+  void modemGetAllConnected() {
+    sendAT(GF("+CIPSTATUS"));
+    if (waitResponse(GF("STATE: ")) != 1) { return; }
+    char state[16];
+    streamGetIpStatus(state, sizeof(state));
+  }
+
   /*
-   * Utilities
+   * Server related functions
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
+ protected:
+  // The module runs a single server, incoming connections take the lowest
+  // free connection number
+  bool modemListen(uint16_t port, uint8_t) {
+    // Needs the bearer brought up by gprsConnect
+    sendAT(GF("+CIPSERVER=1,"), port);
+    if (waitResponse() != 1) { return false; }
+    return waitResponse(10000L, GF("SERVER OK"), GF("SERVER CLOSE"),
+                        GF("ERROR")) == 1;
+  }
+
+  void modemStopListen(uint16_t, uint8_t) {
+    sendAT(GF("+CIPSERVER=0"));
+    waitResponse(10000L, GF("SERVER CLOSE"), GF("ERROR"));
+  }
 #endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+CIPRXGET:"))) {
-          int8_t mode = streamGetIntBefore(',');
-          if (mode == 1) {
-            int8_t mux = streamGetIntBefore('\n');
-            if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-              sockets[mux]->got_data = true;
-            }
-            data = "";
-            // DBG("### Got Data:", mux);
-          } else {
-            data += mode;
-          }
-        } else if (data.endsWith(GF(GSM_NL "+RECEIVE:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          // DBG("### Got Data:", len, "on", mux);
-        } else if (data.endsWith(GF("CLOSED" GSM_NL))) {
-          int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
-          int8_t coma = data.indexOf(',', nl + 2);
-          int8_t mux  = data.substring(nl + 2, coma).toInt();
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### Closed: ", mux);
-        } else if (data.endsWith(GF("*PSNWID:"))) {
-          streamSkipUntil('\n');  // Refresh network name by network
-          data = "";
-          DBG("### Network name updated.");
-        } else if (data.endsWith(GF("*PSUTTZ:"))) {
-          streamSkipUntil('\n');  // Refresh time and time zone by network
-          data = "";
-          DBG("### Network time and time zone updated.");
-        } else if (data.endsWith(GF("+CTZV:"))) {
-          streamSkipUntil('\n');  // Refresh network time zone by network
-          data = "";
-          DBG("### Network time zone updated.");
-        } else if (data.endsWith(GF("DST:"))) {
-          streamSkipUntil(
-              '\n');  // Refresh Network Daylight Saving Time by network
-          data = "";
-          DBG("### Daylight savings time state updated.");
-        }
+
+#if TINY_GSM_USES(UDP)
+  /*
+   * UDP related functions
+   */
+ protected:
+  // The module only sends UDP on a connected socket, so the socket is opened
+  // with +CIPSTART for the first datagram and reopened when the peer changes
+  bool modemUdpBegin(uint8_t* mux, uint16_t local_port) {
+    if (local_port == 0) { return true; }
+    // The local port is used by the next +CIPSTART on this connection
+    sendAT(GF("+CLPORT="), *mux, ',', GF("\"UDP\","), local_port);
+    return waitResponse() == 1;
+  }
+
+  bool modemUdpSend(uint8_t mux, const char* host, uint16_t port,
+                    const uint8_t* buf, size_t len, bool newPeer) {
+    if (newPeer) {
+      sendAT(GF("+CIPCLOSE="), mux, GF(",1"));  // Quick close
+      waitResponse(GF("CLOSE OK"), GF(GSM_ERROR));
+      sendAT(GF("+CIPSTART="), mux, ',', GF("\"UDP"), GF("\",\""), host,
+             GF("\","), port);
+      if (waitResponse(75000L, GF("CONNECT OK" GSM_NL),
+                       GF("CONNECT FAIL" GSM_NL), GF("ALREADY CONNECT" GSM_NL),
+                       GF("ERROR" GSM_NL)) != 1) {
+        return false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
+    return modemSend(buf, len, mux) == static_cast<int16_t>(len);
   }
 
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+  // The module keeps received UDP as a stream and announces it without its
+  // length, so each +CIPRXGET read is taken for one datagram, and the
+  // datagrams that arrive between two reads come back together; see
+  // TINY_GSM_UDP_NO_BOUNDARIES
+  int modemUdpReceive(uint8_t mux, uint8_t* buf, size_t size, String&,
+                      uint16_t&) {
+    sendAT(GF("+CIPRXGET=2,"), mux, ',', (uint16_t)size);
+    if (waitResponse(GF("+CIPRXGET:")) != 1) { return 0; }
+    streamSkipUntil(',');  // Skip Rx mode 2/normal
+    streamSkipUntil(',');  // Skip mux
+    int16_t len = streamGetIntBefore(',');
+    streamSkipUntil('\n');  // Skip the length remaining in the buffer
+    if (len > 0) { len = stream.readBytes(buf, len); }
+    waitResponse();
+    return len;
   }
 
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+  void modemUdpStop(uint8_t mux) {
+    sendAT(GF("+CIPCLOSE="), mux, GF(",1"));  // Quick close
+    waitResponse(GF("CLOSE OK"), GF(GSM_ERROR));
+  }
+#endif
+
+  /*
+   * Utilities
+   */
+ protected:
+  // Reads the rest of a +CIPSTATUS after its "STATE: ", the state of the
+  // TCP/IP stack into state, and in multi-IP mode the line for each of the
+  // connections 0-5 that follows, used or not, updating the sockets with
+  // them.  Returns the connection lines read, 0 in single-IP mode.
+  uint8_t streamGetIpStatus(char* state, size_t cap) {
+    streamGetStringBefore('\n', state, cap);
+    TinyGsmTrim(state);
+    // C: <n>,<bearer>,<TCP/UDP>,<IP address>,<port>,<client state>
+    // The OK came before the state, so nothing ends the list; the lines come
+    // right after the state or not at all, so they're only waited for a
+    // moment, and in single-IP mode that is all the time it takes
+    uint8_t lines = 0;
+    while (lines < 6 && waitResponse(100L, GF("C: "), NULL) == 1) {
+      int8_t mux = streamGetIntBefore(',');
+      for (uint8_t i = 0; i < 4; i++) { streamSkipUntil(','); }
+      char client[20];
+      streamGetStringBefore('\n', client, sizeof(client));
+#if TINY_GSM_USES(TCP)
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = strstr(client, "\"CONNECTED\"") !=
+            NULL;
+      }
 #else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
+      (void)mux;
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+      lines++;
+    }
+    return lines;
   }
 
- public:
-  Stream& stream;
+  // Reads a quoted field and tells if it is expected, NULL being empty
+  bool streamQuotedIs(const char* expected) {
+    char field[64];
+    streamSkipUntil('"');
+    streamGetStringBefore('"', field, sizeof(field));
+    return !strcmp(field, expected ? expected : "");
+  }
+
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("*PSNWID:"))) {
+      streamSkipUntil('\n');  // Refresh network name by network
+      data = "";
+      DBG("### Network name updated.");
+    } else if (TinyGsmEndsWith(data, GF("*PSUTTZ:"))) {
+      streamSkipUntil('\n');  // Refresh time and time zone by network
+      data = "";
+      DBG("### Network time and time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("+CTZV:"))) {
+      streamSkipUntil('\n');  // Refresh network time zone by network
+      data = "";
+      DBG("### Network time zone updated.");
+    } else if (TinyGsmEndsWith(data, GF("DST:"))) {
+      streamSkipUntil('\n');  // Refresh Network Daylight Saving Time by network
+      data = "";
+      DBG("### Daylight savings time state updated.");
+#if TINY_GSM_USES(TCP)
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+CIPRXGET:"))) {
+      int8_t mode = streamGetIntBefore(',');
+      if (mode == 1) {
+        int8_t mux = streamGetIntBefore('\n');
+        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+          sockets[mux]->got_data = true;
+        }
+#if TINY_GSM_USES(UDP)
+        udpReceived(mux);
+#endif
+        data = "";
+        // DBG("### Got Data:", mux);
+      } else {
+        data += mode;
+      }
+    } else if (TinyGsmEndsWith(data, GF(GSM_NL "+RECEIVE:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+      data = "";
+      // DBG("### Got Data:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("CLOSED" GSM_NL))) {
+      int8_t nl   = data.lastIndexOf(GSM_NL, data.length() - 8);
+      int8_t coma = data.indexOf(',', nl + 2);
+      int8_t mux  = data.substring(nl + 2, coma).toInt();
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### Closed: ", mux);
+    } else if (TinyGsmEndsWith(data, GF(", REMOTE IP:"))) {
+      // <n>, REMOTE IP: <ip address> for a connection to the server
+      int8_t nl   = data.lastIndexOf('\n', data.length() - 12);
+      int8_t coma = data.indexOf(',', nl + 1);
+      int8_t mux  = data.substring(nl + 1, coma).toInt();
+      streamSkipUntil('\n');  // Skip the remote address
+      modemIncoming(mux);
+      data = "";
+      DBG("### Incoming: ", mux);
+#endif
+    }
+  }
 
  protected:
-  GsmClientSim800* sockets[TINY_GSM_MUX_COUNT];
   const char*      gsmNL = GSM_NL;
+#if TINY_GSM_USES(TCP)
+  GsmClientSim800* sockets[TINY_GSM_MUX_COUNT];
+  bool             keepAliveOn = false;
+#endif
 };
 
 #endif  // SRC_TINYGSMCLIENTSIM800_H_
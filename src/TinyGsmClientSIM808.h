@@ -14,7 +14,14 @@
 #include "TinyGsmGPS.tpp"
 #include "TinyGsmBluetooth.tpp"
 
-class TinyGsmSim808 : public TinyGsmSim800, public TinyGsmGPS<TinyGsmSim808>, public TinyGsmBluetooth<TinyGsmSim808> {
+class TinyGsmSim808 :
+#if TINY_GSM_USES(GPS)
+                      public TinyGsmGPS<TinyGsmSim808>,
+#endif
+#if TINY_GSM_USES(BLUETOOTH)
+                      public TinyGsmBluetooth<TinyGsmSim808>,
+#endif
+                      public TinyGsmSim800 {
   friend class TinyGsmGPS<TinyGsmSim808>;
   friend class TinyGsmBluetooth<TinyGsmSim808>;
 
@@ -22,6 +29,7 @@ class TinyGsmSim808 : public TinyGsmSim800, public TinyGsmGPS<TinyGsmSim808>, pu
   explicit TinyGsmSim808(Stream& stream) : TinyGsmSim800(stream) {}
 
 
+#if TINY_GSM_USES(GPS)
   /*
    * GPS/GNSS/GLONASS location functions
    */
@@ -41,13 +49,12 @@ class TinyGsmSim808 : public TinyGsmSim800, public TinyGsmGPS<TinyGsmSim808>, pu
 
   // get the RAW GPS output
   // works only with ans SIM808 V2
-  String getGPSrawImpl() {
+  size_t getGPSrawImpl(char* out, size_t cap) {
     sendAT(GF("+CGNSINF"));
-    if (waitResponse(10000L, GF(GSM_NL "+CGNSINF:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(10000L, GF(GSM_NL "+CGNSINF:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // get GPS informations
@@ -163,6 +170,8 @@ class TinyGsmSim808 : public TinyGsmSim800, public TinyGsmGPS<TinyGsmSim808>, pu
     
     return true;
   }
+#endif
+
 };
 
 #endif  // SRC_TINYGSMCLIENTSIM808_H_
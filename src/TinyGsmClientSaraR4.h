@@ -25,13 +25,11 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTemperature.tpp"
 #include "TinyGsmTime.tpp"
+#include "TinyGsmUDP.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_KEEPALIVE
+#define TINY_GSM_MODEM_HAS_DNS
 #endif
 
 enum RegStatus {
@@ -44,19 +42,41 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
-                      public TinyGsmGPRS<TinyGsmSaraR4>,
+class TinyGsmSaraR4 : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                       public TinyGsmTCP<TinyGsmSaraR4, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(UDP)
+                      public TinyGsmUDP<TinyGsmSaraR4, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
                       public TinyGsmSSL<TinyGsmSaraR4>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                       public TinyGsmBattery<TinyGsmSaraR4>,
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
                       public TinyGsmGSMLocation<TinyGsmSaraR4>,
+#endif
+#if TINY_GSM_USES(GPS)
                       public TinyGsmGPS<TinyGsmSaraR4>,
+#endif
+#if TINY_GSM_USES(SMS)
                       public TinyGsmSMS<TinyGsmSaraR4>,
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
                       public TinyGsmTemperature<TinyGsmSaraR4>,
-                      public TinyGsmTime<TinyGsmSaraR4> {
+#endif
+#if TINY_GSM_USES(TIME)
+                      public TinyGsmTime<TinyGsmSaraR4>,
+#endif
+                      public TinyGsmModem<TinyGsmSaraR4>,
+                      public TinyGsmGPRS<TinyGsmSaraR4> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmSaraR4>;
   friend class TinyGsmGPRS<TinyGsmSaraR4>;
   friend class TinyGsmTCP<TinyGsmSaraR4, TINY_GSM_MUX_COUNT>;
+  friend class TinyGsmUDP<TinyGsmSaraR4, TINY_GSM_MUX_COUNT>;
   friend class TinyGsmSSL<TinyGsmSaraR4>;
   friend class TinyGsmBattery<TinyGsmSaraR4>;
   friend class TinyGsmGSMLocation<TinyGsmSaraR4>;
@@ -65,6 +85,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
   friend class TinyGsmTemperature<TinyGsmSaraR4>;
   friend class TinyGsmTime<TinyGsmSaraR4>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -98,6 +119,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       // stop();  // DON'T stop!
       TINY_GSM_YIELD();
       rx.clear();
@@ -117,6 +139,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
       return connect(TinyGsmStringFromIp(ip).c_str(), port, timeout_s);
     }
     int connect(const char* host, uint16_t port) override {
+      TINY_GSM_STACK_CALL("connect");
       return connect(host, port, 120);
     }
     int connect(IPAddress ip, uint16_t port) override {
@@ -124,7 +147,15 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     }
 
     void stop(uint32_t maxWaitMs) {
-      uint32_t startMillis = millis();
+      TINY_GSM_STACK_CALL("stop");
+#if TINY_GSM_USES(UDP)
+      // Its number is a UDP socket's now, see modemUdpBegin()
+      if (at->udpOwns(mux)) {
+        sock_connected = false;
+        return;
+      }
+#endif
+      uint32_t startMillis = TINY_GSM_MILLIS();
       dumpModemBuffer(maxWaitMs);
       // We want to use an async socket close because the syncrhonous close of
       // an open socket is INCREDIBLY SLOW and the modem can freeze up.  But we
@@ -142,7 +173,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
         // NOT supported on SARA-R404M / SARA-R410M-01B
         at->sendAT(GF("+USOCL="), mux, GF(",1"));
         // NOTE:  can take up to 120s to get a response
-        at->waitResponse((maxWaitMs - (millis() - startMillis)));
+        at->waitResponse((maxWaitMs - (TINY_GSM_MILLIS() - startMillis)));
         // We set the sock as disconnected right away because it can no longer
         // be used
         sock_connected = false;
@@ -150,7 +181,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
         // synchronous close
         at->sendAT(GF("+USOCL="), mux);
         // NOTE:  can take up to 120s to get a response
-        at->waitResponse((maxWaitMs - (millis() - startMillis)));
+        at->waitResponse((maxWaitMs - (TINY_GSM_MILLIS() - startMillis)));
         sock_connected = false;
       }
     }
@@ -164,7 +195,9 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -178,6 +211,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       // stop();  // DON'T stop!
       TINY_GSM_YIELD();
       rx.clear();
@@ -195,22 +229,27 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
       return connect(TinyGsmStringFromIp(ip).c_str(), port, timeout_s);
     }
     int connect(const char* host, uint16_t port) override {
+      TINY_GSM_STACK_CALL("connect");
       return connect(host, port, 120);
     }
     int connect(IPAddress ip, uint16_t port) override {
       return connect(ip, port, 120);
     }
   };
+#endif
 
   /*
    * Constructor
    */
  public:
   explicit TinyGsmSaraR4(Stream& stream)
-      : stream(stream),
+      : TinyGsmAtCore(stream),
         has2GFallback(false),
         supportsAsyncSockets(false) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmSaraR4>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -264,27 +303,27 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
   }
 
   // only difference in implementation is the warning on the wrong type
-  String getModemNameImpl() {
+  size_t getModemNameImpl(char* out, size_t cap) {
     sendAT(GF("+CGMI"));
-    String res1;
-    if (waitResponse(1000L, res1) != 1) { return "u-blox Cellular Modem"; }
-    res1.replace(GSM_NL "OK" GSM_NL, "");
-    res1.trim();
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "u-blox Cellular Modem");
+    }
+    size_t len = strlen(out);
 
     sendAT(GF("+GMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return "u-blox Cellular Modem"; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.trim();
-
-    String name = res1 + String(' ') + res2;
-    DBG("### Modem:", name);
-    if (!name.startsWith("u-blox SARA-R4") &&
-        !name.startsWith("u-blox SARA-N4")) {
+    if (len + 2 >= cap ||
+        !streamGetLines(out + len + 1, cap - len - 1, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "u-blox Cellular Modem");
+    }
+    out[len] = ' ';
+    len      = strlen(out);
+    DBG("### Modem:", out);
+    if (strncmp(out, "u-blox SARA-R4", 14) &&
+        strncmp(out, "u-blox SARA-N4", 14)) {
       DBG("### WARNING:  You are using the wrong TinyGSM modem!");
     }
 
-    return name;
+    return len;
   }
 
   bool factoryDefaultImpl() {
@@ -300,7 +339,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
   bool restartImpl(const char* pin = NULL) {
     if (!testAT()) { return false; }
     if (!setPhoneFunctionality(15)) { return false; }
-    delay(3000);  // TODO(?):  Verify delay timing here
+    TINY_GSM_DELAY(3000);  // TODO(?):  Verify delay timing here
     return init(pin);
   }
 
@@ -384,12 +423,14 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
   }
 
   bool gprsDisconnectImpl() {
+#if TINY_GSM_USES(TCP)
     // Mark all the sockets as closed
     // This ensures that asynchronously closed sockets are marked closed
     for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
       GsmClientSaraR4* sock = sockets[mux];
       if (sock && sock->sock_connected) { sock->sock_connected = false; }
     }
+#endif
 
     // sendAT(GF("+CGACT=0,1"));  // Deactivate PDP context 1
     sendAT(GF("+CGACT=0"));  // Deactivate all contexts
@@ -408,20 +449,21 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
    */
  protected:
   // This uses "CGSN" instead of "GSN"
-  String getIMEIImpl() {
+  size_t getIMEIImpl(char* out, size_t cap) {
     sendAT(GF("+CGSN"));
-    if (waitResponse(GF(GSM_NL)) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL)) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
  protected:
-  String sendUSSDImpl(const String& code) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  size_t sendUSSDImpl(const char* code, char* out,
+                      size_t cap) TINY_GSM_ATTR_NOT_IMPLEMENTED;
   bool   sendSMS_UTF16Impl(const String& number, const void* text,
                            size_t len) TINY_GSM_ATTR_NOT_IMPLEMENTED;
 
@@ -448,7 +490,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     if (waitResponse(10000L, GF(GSM_NL "+UGPS:")) != 1) { return false; }
     return waitResponse(10000L) == 1;
   }
-  String inline getUbloxLocationRaw(int8_t sensor) {
+  size_t inline getUbloxLocationRaw(int8_t sensor, char* out, size_t cap) {
     // AT+ULOC=<mode>,<sensor>,<response_type>,<timeout>,<accuracy>
     // <mode> - 2: single shot position
     // <sensor> - 0: use the last fix in the internal database and stop the GNSS
@@ -463,19 +505,22 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     // <accuracy> - Target accuracy in meters (1 - 999999)
     sendAT(GF("+ULOC=2,"), sensor, GF(",0,120,1"));
     // wait for first "OK"
-    if (waitResponse(10000L) != 1) { return ""; }
+    if (waitResponse(10000L) != 1) { return 0; }
     // wait for the final result - wait full timeout time
-    if (waitResponse(120000L, GF(GSM_NL "+UULOC:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(120000L, GF(GSM_NL "+UULOC:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
   String getGsmLocationRawImpl() {
-    return getUbloxLocationRaw(2);
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_LONG_STRING);
+    size_t len = buf ? getUbloxLocationRaw(2, buf, TINY_GSM_LONG_STRING) : 0;
+    TinyGsmStringEnd(res, len);
+    return res;
   }
-  String getGPSrawImpl() {
-    return getUbloxLocationRaw(1);
+  size_t getGPSrawImpl(char* out, size_t cap) {
+    return getUbloxLocationRaw(1, out, cap);
   }
 
   inline bool getUbloxLocation(int8_t sensor, float* lat, float* lon,
@@ -581,6 +626,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     return getUbloxLocation(1, lat, lon, speed, alt, vsat, usat, accuracy, year,
                             month, day, hour, minute, second);
   }
+#endif
 
   /*
    * Time functions
@@ -588,6 +634,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
  protected:
   // Can follow the standard CCLK function in the template
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -614,7 +661,9 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     milliVolts  = 0;
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -632,15 +681,26 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     if (res != -1) { temp = (static_cast<float>(res)) / 10; }
     return temp;
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
  protected:
   bool modemConnect(const char* host, uint16_t port, uint8_t* mux,
                     bool ssl = false, int timeout_s = 120) {
-    uint32_t timeout_ms  = ((uint32_t)timeout_s) * 1000;
-    uint32_t startMillis = millis();
+    uint32_t timeout_ms = ((uint32_t)timeout_s) * 1000;
+
+    // SSL needs the real host name, plain TCP can use a cached address
+    String      address;
+    const char* remote = ssl ? host
+                             : dnsConnectTarget(host, address, timeout_ms);
+    if (!remote) { return false; }
+    uint32_t startMillis = TINY_GSM_MILLIS();
+
+    // the mux passed in is still the one the client was registered under
+    GsmClientSaraR4* client = sockets[*mux];
 
     // create a socket
     sendAT(GF("+USOCR=6"));
@@ -662,9 +722,11 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     // sendAT(GF("+USOSO="), *mux, GF(",6,1,1"));
     // waitResponse();
 
-    // Enable KEEPALIVE, 30 sec
-    // sendAT(GF("+USOSO="), *mux, GF(",6,2,30000"));
-    // waitResponse();
+    // Enable KEEPALIVE, if the client asked for it
+    if (client && client->keep_alive_idle > 0) {
+      modemSetKeepAlive(*mux, client->keep_alive_idle,
+                        client->keep_alive_interval, client->keep_alive_count);
+    }
 
     // connect on the allocated socket
 
@@ -674,36 +736,68 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     // has a nasty habit of locking up when opening a socket, especially if
     // the cellular service is poor.
     // NOT supported on SARA-R404M / SARA-R410M-01B
+    bool opened = false;
     if (supportsAsyncSockets) {
       DBG("### Opening socket asynchronously!  Socket cannot be used until "
           "the URC '+UUSOCO' appears.");
-      sendAT(GF("+USOCO="), *mux, ",\"", host, "\",", port, ",1");
-      if (waitResponse(timeout_ms - (millis() - startMillis),
+      sendAT(GF("+USOCO="), *mux, ",\"", remote, "\",", port, ",1");
+      if (waitResponse(timeout_ms - (TINY_GSM_MILLIS() - startMillis),
                        GF(GSM_NL "+UUSOCO:")) == 1) {
         streamGetIntBefore(',');  // skip repeated mux
         int8_t connection_status = streamGetIntBefore('\n');
-        DBG("### Waited", millis() - startMillis, "ms for socket to open");
-        return (0 == connection_status);
+        DBG("### Waited", TINY_GSM_MILLIS() - startMillis,
+            "ms for socket to open");
+        opened = (0 == connection_status);
       } else {
-        DBG("### Waited", millis() - startMillis,
+        DBG("### Waited", TINY_GSM_MILLIS() - startMillis,
             "but never got socket open notice");
-        return false;
       }
     } else {
       // use synchronous open
-      sendAT(GF("+USOCO="), *mux, ",\"", host, "\",", port);
-      int8_t rsp = waitResponse(timeout_ms - (millis() - startMillis));
-      return (1 == rsp);
+      sendAT(GF("+USOCO="), *mux, ",\"", remote, "\",", port);
+      int8_t rsp = waitResponse(timeout_ms - (TINY_GSM_MILLIS() - startMillis));
+      opened     = (1 == rsp);
     }
+    if (!opened && remote != host) { dnsCacheRemove(host); }
+    return opened;
+  }
+
+  // Only the idle time can be set, probe interval and count are fixed
+  bool modemSetKeepAlive(uint8_t mux, uint16_t idle_s, uint16_t, uint8_t) {
+    // <level> 65535 = socket, <opt_name> 8 = SO_KEEPALIVE
+    sendAT(GF("+USOSO="), mux, GF(",65535,8,"), idle_s > 0);
+    if (waitResponse() != 1) { return false; }
+    if (idle_s == 0) { return true; }
+    // <level> 6 = TCP, <opt_name> 2 = TCP_KEEPIDLE in ms
+    sendAT(GF("+USOSO="), mux, GF(",6,2,"),
+           static_cast<uint32_t>(idle_s) * 1000);
+    return waitResponse() == 1;
+  }
+
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t&) {
+    // AT+UDNSRN=<resolution_type>,<domain_ip_string>
+    // <resolution_type> 0: domain name to IP address
+    sendAT(GF("+UDNSRN=0,\""), host, '"');
+    if (waitResponse(timeout_ms, GF(GSM_NL "+UDNSRN:")) != 1) { return false; }
+    streamSkipUntil('"');
+    String res = stream.readStringUntil('"');
+    waitResponse();
+    return ip.fromString(res);
   }
 
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     sendAT(GF("+USOWR="), mux, ',', (uint16_t)len);
     if (waitResponse(GF("@")) != 1) { return 0; }
     // 50ms delay, see AT manual section 25.10.4
-    delay(50);
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    TINY_GSM_DELAY(50);
+    streamWriteIoVec(iov, count);
     if (waitResponse(GF(GSM_NL "+USOWR:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
     int16_t sent = streamGetIntBefore('\n');
@@ -719,7 +813,7 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     int16_t len = streamGetIntBefore(',');
     streamSkipUntil('\"');
 
-    for (int i = 0; i < len; i++) { moveCharFromStreamToFifo(mux); }
+    moveStreamToFifo(mux, len);
     streamSkipUntil('\"');
     waitResponse();
     // DBG("### READ:", len, "from", mux);
@@ -770,128 +864,139 @@ class TinyGsmSaraR4 : public TinyGsmModem<TinyGsmSaraR4>,
     waitResponse();
     return (result != 0);
   }
+#endif
 
+#if TINY_GSM_USES(UDP)
   /*
-   * Utilities
+   * UDP related functions
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+UUSORD:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            // max size is 1024
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          DBG("### URC Data Received:", len, "on", mux);
-        } else if (data.endsWith(GF("+UUSOCL:"))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### URC Sock Closed: ", mux);
-        } else if (data.endsWith(GF("+UUSOCO:"))) {
-          int8_t mux          = streamGetIntBefore('\n');
-          int8_t socket_error = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux] &&
-              socket_error == 0) {
-            sockets[mux]->sock_connected = true;
-          }
-          data = "";
-          DBG("### URC Sock Opened: ", mux);
-        }
-      }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
-      data = "";
+ protected:
+  bool modemUdpBegin(uint8_t* mux, uint16_t local_port) {
+    // AT+USOCR=<protocol>[,<local_port>], <protocol> 17 = UDP
+    if (local_port) {
+      sendAT(GF("+USOCR=17,"), local_port);
+    } else {
+      sendAT(GF("+USOCR=17"));
+    }
+    // reply is +USOCR: ## of socket created
+    if (waitResponse(GF(GSM_NL "+USOCR:")) != 1) { return false; }
+    int8_t id = streamGetIntBefore('\n');
+    if (waitResponse() != 1 || id < 0 || id >= TINY_GSM_MUX_COUNT) {
+      return false;
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
+    // The module only hands out the number of a closed socket, but a TCP
+    // client may still be registered under it; it would take this socket's
+    // data URC's, and its stop() would close it, so it is let go of.  Its
+    // next connect() registers it under the number it gets then.
+    if (sockets[id]) {
+      DBG("### UDP socket", id, "was a TCP client's, releasing it");
+      sockets[id]->sock_connected = false;
+      sockets[id]->sock_available = 0;
+      sockets[id]->got_data       = false;
+      sockets[id]                 = NULL;
+    }
+    *mux = id;
+    return true;
   }
 
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+  bool modemUdpSend(uint8_t mux, const char* host, uint16_t port,
+                    const uint8_t* buf, size_t len, bool) {
+    // AT+USOST=<socket>,<remote_addr>,<remote_port>,<length>
+    IPAddress ip;
+    if (!getHostByName(host, ip)) { return false; }
+    sendAT(GF("+USOST="), mux, GF(",\""),
+           GsmClientSaraR4::TinyGsmStringFromIp(ip), GF("\","), port, ',',
+           (uint16_t)len);
+    if (waitResponse(GF("@")) != 1) { return false; }
+    // 50ms delay, see AT manual section 25.10.4
+    TINY_GSM_DELAY(50);
+    stream.write(buf, len);
+    stream.flush();
+    if (waitResponse(GF(GSM_NL "+USOST:")) != 1) { return false; }
+    streamSkipUntil(',');  // Skip mux
+    int16_t sent = streamGetIntBefore('\n');
+    waitResponse();  // sends back OK after the confirmation of number sent
+    return sent == static_cast<int16_t>(len);
   }
 
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
+  int modemUdpReceive(uint8_t mux, uint8_t* buf, size_t size, String& ip,
+                      uint16_t& port) {
+    // A zero length read gives the size of the next datagram without
+    // reading it
+    sendAT(GF("+USORF="), mux, GF(",0"));
+    if (waitResponse(GF(GSM_NL "+USORF:")) != 1) { return 0; }
+    streamSkipUntil(',');  // Skip mux
+    int16_t pending = streamGetIntBefore('\n');
+    waitResponse();
+    if (pending <= 0) { return 0; }
+
+    // +USORF: <socket>,<remote_ip_addr>,<remote_port>,<length>,<data>
+    sendAT(GF("+USORF="), mux, ',', (uint16_t)size);
+    if (waitResponse(GF(GSM_NL "+USORF:")) != 1) { return 0; }
+    streamSkipUntil(',');  // Skip mux
+    streamSkipUntil('\"');
+    ip = stream.readStringUntil('\"');
+    streamSkipUntil(',');
+    port = streamGetIntBefore(',');
+    int16_t len = streamGetIntBefore(',');
+    streamSkipUntil('\"');
+    if (len > 0) { len = stream.readBytes(buf, len); }
+    streamSkipUntil('\"');
+    waitResponse();
+    return len;
   }
 
- public:
-  Stream& stream;
+  void modemUdpStop(uint8_t mux) {
+    sendAT(GF("+USOCL="), mux);
+    waitResponse();
+  }
+#endif
 
+  /*
+   * Utilities
+   */
  protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    // +UUSORF is what newer firmware sends for UDP sockets read with +USORF
+    if (TinyGsmEndsWith(data, GF("+UUSORD:")) ||
+        TinyGsmEndsWith(data, GF("+UUSORF:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        // max size is 1024
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+#if TINY_GSM_USES(UDP)
+      udpReceived(mux);
+#endif
+      data = "";
+      DBG("### URC Data Received:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+UUSOCL:"))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
+      }
+      data = "";
+      DBG("### URC Sock Closed: ", mux);
+    } else if (TinyGsmEndsWith(data, GF("+UUSOCO:"))) {
+      int8_t mux          = streamGetIntBefore('\n');
+      int8_t socket_error = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux] &&
+          socket_error == 0) {
+        sockets[mux]->sock_connected = true;
+      }
+      data = "";
+      DBG("### URC Sock Opened: ", mux);
+    }
+  }
+#endif
+
+ protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSaraR4* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*      gsmNL = GSM_NL;
   bool             has2GFallback;
   bool             supportsAsyncSockets;
@@ -23,14 +23,6 @@
 #include "TinyGsmTemperature.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
-#endif
-
 enum RegStatus {
   REG_NO_RESULT    = -1,
   REG_UNREGISTERED = 0,
@@ -51,15 +43,28 @@ enum SocketStatus {
   SOCK_OPENING                = 6,
 };
 
-class TinyGsmSequansMonarch
-    : public TinyGsmModem<TinyGsmSequansMonarch>,
-      public TinyGsmGPRS<TinyGsmSequansMonarch>,
-      public TinyGsmTCP<TinyGsmSequansMonarch, TINY_GSM_MUX_COUNT>,
-      public TinyGsmSSL<TinyGsmSequansMonarch>,
-      public TinyGsmCalling<TinyGsmSequansMonarch>,
-      public TinyGsmSMS<TinyGsmSequansMonarch>,
-      public TinyGsmTime<TinyGsmSequansMonarch>,
-      public TinyGsmTemperature<TinyGsmSequansMonarch> {
+class TinyGsmSequansMonarch : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
+                              public TinyGsmTCP<TinyGsmSequansMonarch, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
+                              public TinyGsmSSL<TinyGsmSequansMonarch>,
+#endif
+#if TINY_GSM_USES(CALLING)
+                              public TinyGsmCalling<TinyGsmSequansMonarch>,
+#endif
+#if TINY_GSM_USES(SMS)
+                              public TinyGsmSMS<TinyGsmSequansMonarch>,
+#endif
+#if TINY_GSM_USES(TIME)
+                              public TinyGsmTime<TinyGsmSequansMonarch>,
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
+                              public TinyGsmTemperature<TinyGsmSequansMonarch>,
+#endif
+                              public TinyGsmModem<TinyGsmSequansMonarch>,
+                              public TinyGsmGPRS<TinyGsmSequansMonarch> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmSequansMonarch>;
   friend class TinyGsmGPRS<TinyGsmSequansMonarch>;
   friend class TinyGsmTCP<TinyGsmSequansMonarch, TINY_GSM_MUX_COUNT>;
@@ -69,6 +74,7 @@ class TinyGsmSequansMonarch
   friend class TinyGsmTime<TinyGsmSequansMonarch>;
   friend class TinyGsmTemperature<TinyGsmSequansMonarch>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -105,6 +111,7 @@ class TinyGsmSequansMonarch
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       if (sock_connected) stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -114,6 +121,7 @@ class TinyGsmSequansMonarch
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+SQNSH="), mux);
       sock_connected = false;
@@ -129,7 +137,9 @@ class TinyGsmSequansMonarch
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -147,6 +157,7 @@ class TinyGsmSequansMonarch
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       stop();
       TINY_GSM_YIELD();
       rx.clear();
@@ -178,13 +189,17 @@ class TinyGsmSequansMonarch
       strictSSL = strict;
     }
   };
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmSequansMonarch(Stream& stream) : stream(stream) {
+  explicit TinyGsmSequansMonarch(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmSequansMonarch>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -237,24 +252,22 @@ class TinyGsmSequansMonarch
     }
   }
 
-  String getModemNameImpl() {
+  size_t getModemNameImpl(char* out, size_t cap) {
     sendAT(GF("+CGMI"));
-    String res1;
-    if (waitResponse(1000L, res1) != 1) { return "unknown"; }
-    res1.replace("\r\nOK\r\n", "");
-    res1.replace("\rOK\r", "");
-    res1.trim();
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "unknown");
+    }
+    size_t len = strlen(out);
 
     sendAT(GF("+CGMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return "unknown"; }
-    res2.replace("\r\nOK\r\n", "");
-    res2.replace("\rOK\r", "");
-    res2.trim();
-
-    String name = res1 + String(' ') + res2;
-    DBG("### Modem:", name);
-    return name;
+    if (len + 2 >= cap ||
+        !streamGetLines(out + len + 1, cap - len - 1, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "unknown");
+    }
+    out[len] = ' ';
+    len      = strlen(out);
+    DBG("### Modem:", out);
+    return len;
   }
 
   bool factoryDefaultImpl() {
@@ -267,6 +280,7 @@ class TinyGsmSequansMonarch
   }
 
   void maintainImpl() {
+#if TINY_GSM_USES(TCP)
     for (int mux = 1; mux <= TINY_GSM_MUX_COUNT; mux++) {
       GsmClientSequansMonarch* sock = sockets[mux % TINY_GSM_MUX_COUNT];
       if (sock && sock->got_data) {
@@ -276,6 +290,7 @@ class TinyGsmSequansMonarch
         modemGetConnected();
       }
     }
+#endif
     while (stream.available()) { waitResponse(15, NULL, NULL); }
   }
 
@@ -294,7 +309,7 @@ class TinyGsmSequansMonarch
     sendAT(GF("+CFUN=1,1"));
     res = waitResponse(20000L, GF("+SYSSTART"), GFP(GSM_ERROR));
     if (res != 1 && res != 3) { return false; }
-    delay(1000);
+    TINY_GSM_DELAY(1000);
     return init(pin);
   }
 
@@ -332,12 +347,12 @@ class TinyGsmSequansMonarch
     RegStatus s = getRegistrationStatus();
     return (s == REG_OK_HOME || s == REG_OK_ROAMING);
   }
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+CGPADDR=3"));
-    if (waitResponse(10000L, GF("+CGPADDR: 3,\"")) != 1) { return ""; }
-    String res = stream.readStringUntil('\"');
+    if (waitResponse(10000L, GF("+CGPADDR: 3,\"")) != 1) { return 0; }
+    size_t len = streamGetStringBefore('\"', out, cap);
     waitResponse();
-    return res;
+    return len;
   }
 
   /*
@@ -384,15 +399,15 @@ class TinyGsmSequansMonarch
    * SIM card functions
    */
  protected:
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     sendAT(GF("+SQNCCID"));
-    if (waitResponse(GF(GSM_NL "+SQNCCID:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL "+SQNCCID:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
+#if TINY_GSM_USES(CALLING)
   /*
    * Phone Call functions
    */
@@ -400,6 +415,7 @@ class TinyGsmSequansMonarch
   bool callAnswerImpl() TINY_GSM_ATTR_NOT_AVAILABLE;
   bool dtmfSendImpl(char cmd,
                     int  duration_ms = 100) TINY_GSM_ATTR_NOT_AVAILABLE;
+#endif
 
   /*
    * Messaging functions
@@ -413,6 +429,7 @@ class TinyGsmSequansMonarch
  protected:
   // Can follow the standard CCLK function in the template
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -427,12 +444,17 @@ class TinyGsmSequansMonarch
     if (res.indexOf("ERROR") >= 0) { return static_cast<float>(-9999); }
     return res.toFloat();
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
+  /*
+   * Client related functions
+   */
  protected:
   bool modemConnect(const char* host, uint16_t port, uint8_t mux,
                     bool ssl = false, int timeout_s = 75) {
     int8_t   rsp;
-    uint32_t startMillis = millis();
+    uint32_t startMillis = TINY_GSM_MILLIS();
     uint32_t timeout_ms  = ((uint32_t)timeout_s) * 1000;
 
     if (ssl) {
@@ -485,17 +507,17 @@ class TinyGsmSequansMonarch
     // <acceptAnyRemote> = Applies to UDP only
     sendAT(GF("+SQNSD="), mux, ",0,", port, ',', GF("\""), host, GF("\""),
            ",0,0,1");
-    rsp = waitResponse((timeout_ms - (millis() - startMillis)), GFP(GSM_OK),
-                       GFP(GSM_ERROR), GF("NO CARRIER" GSM_NL));
+    rsp = waitResponse((timeout_ms - (TINY_GSM_MILLIS() - startMillis)),
+                       GFP(GSM_OK), GFP(GSM_ERROR), GF("NO CARRIER" GSM_NL));
 
     // creation of socket failed immediately.
     if (rsp != 1) { return false; }
 
     // wait until we get a good status
     bool connected = false;
-    while (!connected && ((millis() - startMillis) < timeout_ms)) {
+    while (!connected && ((TINY_GSM_MILLIS() - startMillis) < timeout_ms)) {
       connected = modemGetConnected(mux);
-      delay(100);  // socket may be in opening state
+      TINY_GSM_DELAY(100);  // socket may be in opening state
     }
     return connected;
   }
@@ -509,11 +531,11 @@ class TinyGsmSequansMonarch
     sendAT(GF("+SQNSSENDEXT="), mux, ',', (uint16_t)len);
     waitResponse(10000L, GF(GSM_NL "> "));
     // Translate bytes into char to be able to send them as an hex string
-    char char_command[2];
+    char char_command[3];
     for (size_t i=0; i<len; i++) {
       memset(&char_command, 0, sizeof(char_command));
       sprintf(&char_command[0], "%02X", reinterpret_cast<const uint8_t*>(buff)[i]);
-      stream.write(char_command, sizeof(char_command));
+      stream.write(char_command, 2);
     }
     stream.flush();
     if (waitResponse() != 1) {
@@ -530,7 +552,7 @@ class TinyGsmSequansMonarch
     //     gotPrompt = true;
     //   }
     //   nAttempts--;
-    //   delay(50);
+    //   TINY_GSM_DELAY(50);
     // }
     // if (gotPrompt) {
     //   stream.write(reinterpret_cast<const uint8_t*>(buff), len);
@@ -550,16 +572,7 @@ class TinyGsmSequansMonarch
     if (waitResponse(GF("+SQNSRECV: ")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
     int16_t len = streamGetIntBefore('\n');
-    for (int i = 0; i < len; i++) {
-      uint32_t startMillis = millis();
-      while (!stream.available() &&
-             ((millis() - startMillis) <
-              sockets[mux % TINY_GSM_MUX_COUNT]->_timeout)) {
-        TINY_GSM_YIELD();
-      }
-      char c = stream.read();
-      sockets[mux % TINY_GSM_MUX_COUNT]->rx.put(c);
-    }
+    moveStreamToFifo(mux % TINY_GSM_MUX_COUNT, len);
     // DBG("### READ:", len, "from", mux);
     waitResponse();
     sockets[mux % TINY_GSM_MUX_COUNT]->sock_available = modemGetAvailable(mux);
@@ -612,120 +625,40 @@ class TinyGsmSequansMonarch
     waitResponse();  // Should be an OK at the end
     return sockets[mux % TINY_GSM_MUX_COUNT]->sock_connected;
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF(GSM_NL "+SQNSRING:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT &&
-              sockets[mux % TINY_GSM_MUX_COUNT]) {
-            sockets[mux % TINY_GSM_MUX_COUNT]->got_data       = true;
-            sockets[mux % TINY_GSM_MUX_COUNT]->sock_available = len;
-          }
-          data = "";
-          DBG("### URC Data Received:", len, "on", mux);
-        } else if (data.endsWith(GF("SQNSH: "))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT &&
-              sockets[mux % TINY_GSM_MUX_COUNT]) {
-            sockets[mux % TINY_GSM_MUX_COUNT]->sock_connected = false;
-          }
-          data = "";
-          DBG("### URC Sock Closed: ", mux);
-        }
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF(GSM_NL "+SQNSRING:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT &&
+          sockets[mux % TINY_GSM_MUX_COUNT]) {
+        sockets[mux % TINY_GSM_MUX_COUNT]->got_data       = true;
+        sockets[mux % TINY_GSM_MUX_COUNT]->sock_available = len;
+      }
+      data = "";
+      DBG("### URC Data Received:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("SQNSH: "))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT &&
+          sockets[mux % TINY_GSM_MUX_COUNT]) {
+        sockets[mux % TINY_GSM_MUX_COUNT]->sock_connected = false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
+      DBG("### URC Sock Closed: ", mux);
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
   }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientSequansMonarch* sockets[TINY_GSM_MUX_COUNT];
+#endif
   // GSM_NL (\r\n) is not accepted with SQNSSENDEXT in data mode so use \n
   const char*              gsmNL = "\n";
 };
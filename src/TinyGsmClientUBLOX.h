@@ -26,12 +26,9 @@
 #include "TinyGsmTCP.tpp"
 #include "TinyGsmTime.tpp"
 
-#define GSM_NL "\r\n"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-#if defined       TINY_GSM_DEBUG
-static const char GSM_CME_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CME ERROR:";
-static const char GSM_CMS_ERROR[] TINY_GSM_PROGMEM = GSM_NL "+CMS ERROR:";
+#if TINY_GSM_USES(TCP)
+#define TINY_GSM_MODEM_HAS_KEEPALIVE
+#define TINY_GSM_MODEM_HAS_DNS
 #endif
 
 enum RegStatus {
@@ -44,16 +41,34 @@ enum RegStatus {
   REG_UNKNOWN      = 4,
 };
 
-class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
-                     public TinyGsmGPRS<TinyGsmUBLOX>,
+class TinyGsmUBLOX : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                      public TinyGsmTCP<TinyGsmUBLOX, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
                      public TinyGsmSSL<TinyGsmUBLOX>,
+#endif
+#if TINY_GSM_USES(CALLING)
                      public TinyGsmCalling<TinyGsmUBLOX>,
+#endif
+#if TINY_GSM_USES(SMS)
                      public TinyGsmSMS<TinyGsmUBLOX>,
+#endif
+#if TINY_GSM_USES(GSM_LOCATION)
                      public TinyGsmGSMLocation<TinyGsmUBLOX>,
+#endif
+#if TINY_GSM_USES(GPS)
                      public TinyGsmGPS<TinyGsmUBLOX>,
+#endif
+#if TINY_GSM_USES(TIME)
                      public TinyGsmTime<TinyGsmUBLOX>,
-                     public TinyGsmBattery<TinyGsmUBLOX> {
+#endif
+#if TINY_GSM_USES(BATTERY)
+                     public TinyGsmBattery<TinyGsmUBLOX>,
+#endif
+                     public TinyGsmModem<TinyGsmUBLOX>,
+                     public TinyGsmGPRS<TinyGsmUBLOX> {
+  friend class TinyGsmAtCore;
   friend class TinyGsmModem<TinyGsmUBLOX>;
   friend class TinyGsmGPRS<TinyGsmUBLOX>;
   friend class TinyGsmTCP<TinyGsmUBLOX, TINY_GSM_MUX_COUNT>;
@@ -65,6 +80,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
   friend class TinyGsmTime<TinyGsmUBLOX>;
   friend class TinyGsmBattery<TinyGsmUBLOX>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -98,6 +114,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
 
    public:
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       // stop();  // DON'T stop!
       TINY_GSM_YIELD();
       rx.clear();
@@ -116,6 +133,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       dumpModemBuffer(maxWaitMs);
       at->sendAT(GF("+USOCL="), mux);
       at->waitResponse();  // should return within 1s
@@ -131,7 +149,9 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -145,6 +165,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       // stop();  // DON'T stop!
       TINY_GSM_YIELD();
       rx.clear();
@@ -160,13 +181,17 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     }
     TINY_GSM_CLIENT_CONNECT_OVERRIDES
   };
+#endif
 
   /*
    * Constructor
    */
  public:
-  explicit TinyGsmUBLOX(Stream& stream) : stream(stream) {
+  explicit TinyGsmUBLOX(Stream& stream) : TinyGsmAtCore(stream) {
+#if TINY_GSM_USES(TCP)
+    urcs = &urcsOf<TinyGsmUBLOX>;
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   /*
@@ -210,28 +235,28 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
   }
 
   // only difference in implementation is the warning on the wrong type
-  String getModemNameImpl() {
+  size_t getModemNameImpl(char* out, size_t cap) {
     sendAT(GF("+CGMI"));
-    String res1;
-    if (waitResponse(1000L, res1) != 1) { return "u-blox Cellular Modem"; }
-    res1.replace(GSM_NL "OK" GSM_NL, "");
-    res1.trim();
+    if (!streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "u-blox Cellular Modem");
+    }
+    size_t len = strlen(out);
 
     sendAT(GF("+GMM"));
-    String res2;
-    if (waitResponse(1000L, res2) != 1) { return "u-blox Cellular Modem"; }
-    res2.replace(GSM_NL "OK" GSM_NL, "");
-    res2.trim();
-
-    String name = res1 + String(' ') + res2;
-    if (name.startsWith("u-blox SARA-R4") ||
-        name.startsWith("u-blox SARA-N4")) {
+    if (len + 2 >= cap ||
+        !streamGetLines(out + len + 1, cap - len - 1, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "u-blox Cellular Modem");
+    }
+    out[len] = ' ';
+    len      = strlen(out);
+    if (!strncmp(out, "u-blox SARA-R4", 14) ||
+        !strncmp(out, "u-blox SARA-N4", 14)) {
       DBG("### WARNING:  You are using the wrong TinyGSM modem!");
-    } else if (name.startsWith("u-blox SARA-N2")) {
+    } else if (!strncmp(out, "u-blox SARA-N2", 14)) {
       DBG("### SARA N2 NB-IoT modems not supported!");
     }
 
-    return name;
+    return len;
   }
 
   bool factoryDefaultImpl() {
@@ -247,7 +272,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
   bool restartImpl(const char* pin = NULL) {
     if (!testAT()) { return false; }
     if (!setPhoneFunctionality(16)) { return false; }
-    delay(3000);  // TODO(?):  Verify delay timing here
+    TINY_GSM_DELAY(3000);  // TODO(?):  Verify delay timing here
     return init(pin);
   }
 
@@ -305,14 +330,17 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
       return false;
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     sendAT(GF("+UPSND=0,0"));
-    if (waitResponse(GF(GSM_NL "+UPSND:")) != 1) { return ""; }
+    if (waitResponse(GF(GSM_NL "+UPSND:")) != 1) { return 0; }
     streamSkipUntil(',');   // Skip PSD profile
     streamSkipUntil('\"');  // Skip request type
-    String res = stream.readStringUntil('\"');
-    if (waitResponse() != 1) { return ""; }
-    return res;
+    size_t len = streamGetStringBefore('\"', out, cap);
+    if (waitResponse() != 1) {
+      out[0] = '\0';
+      return 0;
+    }
+    return len;
   }
 
   /*
@@ -404,13 +432,12 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
    */
  protected:
   // This uses "CGSN" instead of "GSN"
-  String getIMEIImpl() {
+  size_t getIMEIImpl(char* out, size_t cap) {
     sendAT(GF("+CGSN"));
-    if (waitResponse(GF(GSM_NL)) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(GF(GSM_NL)) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   /*
@@ -419,6 +446,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
  protected:
   // Can follow all of the phone call functions from the template
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
@@ -448,7 +476,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     if (waitResponse(10000L, GF(GSM_NL "+UGPS:")) != 1) { return false; }
     return waitResponse(10000L) == 1;
   }
-  String inline getUbloxLocationRaw(int8_t sensor) {
+  size_t inline getUbloxLocationRaw(int8_t sensor, char* out, size_t cap) {
     // AT+ULOC=<mode>,<sensor>,<response_type>,<timeout>,<accuracy>
     // <mode> - 2: single shot position
     // <sensor> - 0: use the last fix in the internal database and stop the GNSS
@@ -463,19 +491,22 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     // <accuracy> - Target accuracy in meters (1 - 999999)
     sendAT(GF("+ULOC=2,"), sensor, GF(",0,120,1"));
     // wait for first "OK"
-    if (waitResponse(10000L) != 1) { return ""; }
+    if (waitResponse(10000L) != 1) { return 0; }
     // wait for the final result - wait full timeout time
-    if (waitResponse(120000L, GF(GSM_NL "+UULOC:")) != 1) { return ""; }
-    String res = stream.readStringUntil('\n');
+    if (waitResponse(120000L, GF(GSM_NL "+UULOC:")) != 1) { return 0; }
+    streamGetStringBefore('\n', out, cap);
     waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
   String getGsmLocationRawImpl() {
-    return getUbloxLocationRaw(2);
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_LONG_STRING);
+    size_t len = buf ? getUbloxLocationRaw(2, buf, TINY_GSM_LONG_STRING) : 0;
+    TinyGsmStringEnd(res, len);
+    return res;
   }
-  String getGPSrawImpl() {
-    return getUbloxLocationRaw(1);
+  size_t getGPSrawImpl(char* out, size_t cap) {
+    return getUbloxLocationRaw(1, out, cap);
   }
 
   inline bool getUbloxLocation(int8_t sensor, float* lat, float* lon,
@@ -581,6 +612,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     return getUbloxLocation(1, lat, lon, speed, alt, vsat, usat, accuracy, year,
                             month, day, hour, minute, second);
   }
+#endif
 
   /*
    * Time functions
@@ -588,6 +620,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
  protected:
   // Can follow the standard CCLK function in the template
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -614,7 +647,9 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     milliVolts  = 0;
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -622,15 +657,26 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
   // This would only available for a small number of modules in this group
   // (TOBY-L)
   float getTemperatureImpl() TINY_GSM_ATTR_NOT_IMPLEMENTED;
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
  protected:
   bool modemConnect(const char* host, uint16_t port, uint8_t* mux,
                     bool ssl = false, int timeout_s = 120) {
-    uint32_t timeout_ms  = ((uint32_t)timeout_s) * 1000;
-    uint32_t startMillis = millis();
+    uint32_t timeout_ms = ((uint32_t)timeout_s) * 1000;
+
+    // SSL needs the real host name, plain TCP can use a cached address
+    String      address;
+    const char* remote = ssl ? host
+                             : dnsConnectTarget(host, address, timeout_ms);
+    if (!remote) { return false; }
+    uint32_t startMillis = TINY_GSM_MILLIS();
+
+    // the mux passed in is still the one the client was registered under
+    GsmClientUBLOX* client = sockets[*mux];
 
     // create a socket
     sendAT(GF("+USOCR=6"));
@@ -652,23 +698,55 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     // sendAT(GF("+USOSO="), *mux, GF(",6,1,1"));
     // waitResponse();
 
-    // Enable KEEPALIVE, 30 sec
-    // sendAT(GF("+USOSO="), *mux, GF(",6,2,30000"));
-    // waitResponse();
+    // Enable KEEPALIVE, if the client asked for it
+    if (client && client->keep_alive_idle > 0) {
+      modemSetKeepAlive(*mux, client->keep_alive_idle,
+                        client->keep_alive_interval, client->keep_alive_count);
+    }
 
     // connect on the allocated socket
-    sendAT(GF("+USOCO="), *mux, ",\"", host, "\",", port);
-    int8_t rsp = waitResponse(timeout_ms - (millis() - startMillis));
+    sendAT(GF("+USOCO="), *mux, ",\"", remote, "\",", port);
+    int8_t rsp = waitResponse(timeout_ms - (TINY_GSM_MILLIS() - startMillis));
+    if (rsp != 1 && remote != host) { dnsCacheRemove(host); }
     return (1 == rsp);
   }
 
+  // Only the idle time can be set, probe interval and count are fixed
+  bool modemSetKeepAlive(uint8_t mux, uint16_t idle_s, uint16_t, uint8_t) {
+    // <level> 65535 = socket, <opt_name> 8 = SO_KEEPALIVE
+    sendAT(GF("+USOSO="), mux, GF(",65535,8,"), idle_s > 0);
+    if (waitResponse() != 1) { return false; }
+    if (idle_s == 0) { return true; }
+    // <level> 6 = TCP, <opt_name> 2 = TCP_KEEPIDLE in ms
+    sendAT(GF("+USOSO="), mux, GF(",6,2,"),
+           static_cast<uint32_t>(idle_s) * 1000);
+    return waitResponse() == 1;
+  }
+
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t&) {
+    // AT+UDNSRN=<resolution_type>,<domain_ip_string>
+    // <resolution_type> 0: domain name to IP address
+    sendAT(GF("+UDNSRN=0,\""), host, '"');
+    if (waitResponse(timeout_ms, GF(GSM_NL "+UDNSRN:")) != 1) { return false; }
+    streamSkipUntil('"');
+    String res = stream.readStringUntil('"');
+    waitResponse();
+    return ip.fromString(res);
+  }
+
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
+    TinyGsmIoVec iov = {buff, len};
+    return modemSendv(&iov, 1, mux);
+  }
+
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    size_t len = ioVecLength(iov, count);
     sendAT(GF("+USOWR="), mux, ',', (uint16_t)len);
     if (waitResponse(GF("@")) != 1) { return 0; }
     // 50ms delay, see AT manual section 25.10.4
-    delay(50);
-    stream.write(reinterpret_cast<const uint8_t*>(buff), len);
-    stream.flush();
+    TINY_GSM_DELAY(50);
+    streamWriteIoVec(iov, count);
     if (waitResponse(GF(GSM_NL "+USOWR:")) != 1) { return 0; }
     streamSkipUntil(',');  // Skip mux
     int16_t sent = streamGetIntBefore('\n');
@@ -684,7 +762,7 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     int16_t len = streamGetIntBefore(',');
     streamSkipUntil('\"');
 
-    for (int i = 0; i < len; i++) { moveCharFromStreamToFifo(mux); }
+    moveStreamToFifo(mux, len);
     streamSkipUntil('\"');
     waitResponse();
     // DBG("### READ:", len, "from", mux);
@@ -735,119 +813,39 @@ class TinyGsmUBLOX : public TinyGsmModem<TinyGsmUBLOX>,
     waitResponse();
     return (result != 0);
   }
+#endif
 
   /*
    * Utilities
    */
- public:
-  // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(64);
-    uint8_t  index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-#if defined TINY_GSM_DEBUG
-          if (r3 == GFP(GSM_CME_ERROR)) {
-            streamSkipUntil('\n');  // Read out the error
-          }
-#endif
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (data.endsWith(GF("+UUSORD:"))) {
-          int8_t  mux = streamGetIntBefore(',');
-          int16_t len = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->got_data = true;
-            // max size is 1024
-            if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
-          }
-          data = "";
-          // DBG("### URC Data Received:", len, "on", mux);
-        } else if (data.endsWith(GF("+UUSOCL:"))) {
-          int8_t mux = streamGetIntBefore('\n');
-          if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-            sockets[mux]->sock_connected = false;
-          }
-          data = "";
-          DBG("### URC Sock Closed: ", mux);
-        }
+ protected:
+#if TINY_GSM_USES(TCP)
+  void handleURCs(String& data) {
+    if (TinyGsmEndsWith(data, GF("+UUSORD:"))) {
+      int8_t  mux = streamGetIntBefore(',');
+      int16_t len = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+        // max size is 1024
+        if (len >= 0 && len <= 1024) { sockets[mux]->sock_available = len; }
+      }
+      data = "";
+      // DBG("### URC Data Received:", len, "on", mux);
+    } else if (TinyGsmEndsWith(data, GF("+UUSOCL:"))) {
+      int8_t mux = streamGetIntBefore('\n');
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
       }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      if (data.length()) { DBG("### Unhandled:", data); }
       data = "";
+      DBG("### URC Sock Closed: ", mux);
     }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
   }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
 #endif
-                      GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR),
-#if defined TINY_GSM_DEBUG
-                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
-                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
-#else
-                      GsmConstStr r3 = NULL, GsmConstStr r4 = NULL,
-#endif
-                      GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
- public:
-  Stream& stream;
 
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientUBLOX* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*     gsmNL = GSM_NL;
 };
 
@@ -21,6 +21,9 @@
 // here)
 #define TINY_GSM_XBEE_GUARD_TIME 1010
 
+// The XBee ends its lines with a carriage return only
+#define GSM_NL "\r"
+
 #include "TinyGsmBattery.tpp"
 #include "TinyGsmGPRS.tpp"
 #include "TinyGsmModem.tpp"
@@ -30,10 +33,6 @@
 #include "TinyGsmTemperature.tpp"
 #include "TinyGsmWifi.tpp"
 
-#define GSM_NL "\r"
-static const char GSM_OK[] TINY_GSM_PROGMEM    = "OK" GSM_NL;
-static const char GSM_ERROR[] TINY_GSM_PROGMEM = "ERROR" GSM_NL;
-
 // Use this to avoid too many entrances and exits from command mode.
 // The cellular Bee's often freeze up and won't respond when attempting
 // to enter command mode too many times.
@@ -66,14 +65,25 @@ enum XBeeType {
   XBEE3_LTEM_ATT = 0xB08,  // Digi XBee3 Cellular LTE-M
 };
 
-class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
-                    public TinyGsmGPRS<TinyGsmXBee>,
-                    public TinyGsmWifi<TinyGsmXBee>,
+class TinyGsmXBee : public TinyGsmAtCore,
+#if TINY_GSM_USES(TCP)
                     public TinyGsmTCP<TinyGsmXBee, TINY_GSM_MUX_COUNT>,
+#endif
+#if TINY_GSM_USES(SSL)
                     public TinyGsmSSL<TinyGsmXBee>,
+#endif
+#if TINY_GSM_USES(SMS)
                     public TinyGsmSMS<TinyGsmXBee>,
+#endif
+#if TINY_GSM_USES(BATTERY)
                     public TinyGsmBattery<TinyGsmXBee>,
-                    public TinyGsmTemperature<TinyGsmXBee> {
+#endif
+#if TINY_GSM_USES(TEMPERATURE)
+                    public TinyGsmTemperature<TinyGsmXBee>,
+#endif
+                    public TinyGsmModem<TinyGsmXBee>,
+                    public TinyGsmGPRS<TinyGsmXBee>,
+                    public TinyGsmWifi<TinyGsmXBee> {
   friend class TinyGsmModem<TinyGsmXBee>;
   friend class TinyGsmGPRS<TinyGsmXBee>;
   friend class TinyGsmWifi<TinyGsmXBee>;
@@ -83,6 +93,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
   friend class TinyGsmBattery<TinyGsmXBee>;
   friend class TinyGsmTemperature<TinyGsmXBee>;
 
+#if TINY_GSM_USES(TCP)
   /*
    * Inner Client
    */
@@ -115,12 +126,14 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     // Because all settings are saved to flash, it is possible (or likely) that
     // you could send data even if you haven't "made" any connection.
     virtual int connect(const char* host, uint16_t port, int timeout_s) {
+      TINY_GSM_STACK_CALL("connect");
       // NOTE:  Not caling stop() or yeild() here
       at->streamClear();  // Empty anything in the buffer before starting
       sock_connected = at->modemConnect(host, port, mux, false, timeout_s);
       return sock_connected;
     }
     int connect(const char* host, uint16_t port) override {
+      TINY_GSM_STACK_CALL("connect");
       return connect(host, port, 75);
     }
 
@@ -138,6 +151,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     }
 
     void stop(uint32_t maxWaitMs) {
+      TINY_GSM_STACK_CALL("stop");
       at->streamClear();  // Empty anything in the buffer
       // empty the saved currently-in-use destination address
       at->modemStop(maxWaitMs);
@@ -184,8 +198,8 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       return at->stream.readBytes(reinterpret_cast<char*>(buf), size);
       /*
       size_t cnt = 0;
-      uint32_t _startMillis = millis();
-      while (cnt < size && millis() - _startMillis < _timeout) {
+      uint32_t _startMillis = TINY_GSM_MILLIS();
+      while (cnt < size && TINY_GSM_MILLIS() - _startMillis < _timeout) {
         size_t chunk = TinyGsmMin(size-cnt, rx.size());
         if (chunk > 0) {
           rx.get(buf, chunk);
@@ -247,7 +261,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       return TinyGsmStringFromIp(savedIP);
     }
   };
+#endif
 
+#if TINY_GSM_USES(SSL)
   /*
    * Inner Secure Client
    */
@@ -261,12 +277,14 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
 
    public:
     int connect(const char* host, uint16_t port, int timeout_s) override {
+      TINY_GSM_STACK_CALL("connect");
       // NOTE:  Not caling stop() or yeild() here
       at->streamClear();  // Empty anything in the buffer before starting
       sock_connected = at->modemConnect(host, port, mux, true, timeout_s);
       return sock_connected;
     }
     int connect(const char* host, uint16_t port) override {
+      TINY_GSM_STACK_CALL("connect");
       return connect(host, port, 75);
     }
 
@@ -283,13 +301,14 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       return connect(ip, port, 0);
     }
   };
+#endif
 
   /*
    * Constructor
    */
  public:
   explicit TinyGsmXBee(Stream& stream)
-      : stream(stream),
+      : TinyGsmAtCore(stream),
         guardTime(TINY_GSM_XBEE_GUARD_TIME),
         beeType(XBEE_UNKNOWN),
         resetPin(-1),
@@ -301,11 +320,13 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
         lastCommandModeMillis(0) {
     // Start not knowing what kind of bee it is
     // Start with the default guard time of 1 second
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
 
   TinyGsmXBee(Stream& stream, int8_t resetPin)
-      : stream(stream),
+      : TinyGsmAtCore(stream),
         guardTime(TINY_GSM_XBEE_GUARD_TIME),
         beeType(XBEE_UNKNOWN),
         resetPin(resetPin),
@@ -317,7 +338,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
         lastCommandModeMillis(0) {
     // Start not knowing what kind of bee it is
     // Start with the default guard time of 1 second
+#if TINY_GSM_USES(TCP)
     memset(sockets, 0, sizeof(sockets));
+#endif
   }
   /*
    * Basic functions
@@ -377,8 +400,8 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return ret_val;
   }
 
-  String getModemNameImpl() {
-    return getBeeName();
+  size_t getModemNameImpl(char* out, size_t cap) {
+    return TinyGsmCopy(out, cap, getBeeName());
   }
 
   void setBaudImpl(uint32_t baud) {
@@ -407,9 +430,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
   }
 
   bool testATImpl(uint32_t timeout_ms = 10000L) {
-    uint32_t start   = millis();
+    uint32_t start   = TINY_GSM_MILLIS();
     bool     success = false;
-    while (!success && millis() - start < timeout_ms) {
+    while (!success && TINY_GSM_MILLIS() - start < timeout_ms) {
       if (!inCommandMode) {
         success = commandMode();
         if (success) exitCommand();
@@ -422,7 +445,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
           inCommandMode = false;
         }
       }
-      delay(250);
+      TINY_GSM_DELAY(250);
     }
     return success;
   }
@@ -451,8 +474,8 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return ret_val;
   }
 
-  String getModemInfoImpl() {
-    return sendATGetString(GF("HS"));
+  size_t getModemInfoImpl(char* out, size_t cap) {
+    return sendATGetString(GF("HS"), out, cap);
   }
 
   /*
@@ -483,7 +506,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return beeType;
   }
 
-  String getBeeName() {
+  const char* getBeeName() {
     switch (beeType) {
       case XBEE_S6B_WIFI: return "Digi XBee Wi-Fi";
       case XBEE_LTE1_VZN: return "Digi XBee Cellular LTE Cat 1";
@@ -504,7 +527,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     if (resetPin >= 0) {
       DBG("### Forcing a modem reset!\r\n");
       digitalWrite(resetPin, LOW);
-      delay(1);
+      TINY_GSM_DELAY(1);
       digitalWrite(resetPin, HIGH);
     } else {
       DBG("### Attempting a modem software restart");
@@ -535,14 +558,15 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       inCommandMode = false;  // Reset effectively exits command mode
 
     if (beeType == XBEE_S6B_WIFI)
-      delay(2000);  // Wifi module actually resets about 2 seconds later
+      TINY_GSM_DELAY(2000);  // Wifi module actually resets about 2 s later
     else
-      delay(100);  // cellular modules wait 100ms before reset happens
+      TINY_GSM_DELAY(100);  // cellular modules wait 100ms before reset happens
 
     // Wait until reboot completes and XBee responds to command mode call again
-    for (uint32_t start = millis(); millis() - start < 60000L;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < 60000L;) {
       if (commandMode(1)) break;
-      delay(250);  // wait a litle before trying again
+      TINY_GSM_DELAY(250);  // wait a litle before trying again
     }
 
     if (beeType != XBEE_S6B_WIFI) {
@@ -754,28 +778,26 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
                           bool     check_signal = false) {
     bool retVal = false;
     XBEE_COMMAND_START_DECORATOR(5, false)
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       if (check_signal) { getSignalQuality(); }
       if (isNetworkConnected()) {
         retVal = true;
         break;
       }
-      delay(250);  // per Neil H. - more stable with delay
+      TINY_GSM_DELAY(250);  // per Neil H. - more stable with delay
     }
     XBEE_COMMAND_END_DECORATOR
     return retVal;
   }
 
-  String getLocalIPImpl() {
-    XBEE_COMMAND_START_DECORATOR(5, "")
+  size_t getLocalIPImpl(char* out, size_t cap) {
+    XBEE_COMMAND_START_DECORATOR(5, 0)
     sendAT(GF("MY"));
-    String IPaddr;
-    IPaddr.reserve(16);
     // wait for the response - this response can be very slow
-    IPaddr = readResponseString(30000);
+    size_t len = readResponseString(out, cap, 30000);
     XBEE_COMMAND_END_DECORATOR
-    IPaddr.trim();
-    return IPaddr;
+    return len;
   }
 
   String getDNS() {
@@ -906,8 +928,8 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return isNetworkConnected();
   }
 
-  String getOperatorImpl() {
-    return sendATGetString(GF("MN"));
+  size_t getOperatorImpl(char* out, size_t cap) {
+    return sendATGetString(GF("MN"), out, cap);
   }
 
   /*
@@ -922,27 +944,29 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return false;
   }
 
-  String getSimCCIDImpl() {
-    return sendATGetString(GF("S#"));
+  size_t getSimCCIDImpl(char* out, size_t cap) {
+    return sendATGetString(GF("S#"), out, cap);
   }
 
-  String getIMEIImpl() {
-    return sendATGetString(GF("IM"));
+  size_t getIMEIImpl(char* out, size_t cap) {
+    return sendATGetString(GF("IM"), out, cap);
   }
 
-  String getIMSIImpl() {
-    return sendATGetString(GF("II"));
+  size_t getIMSIImpl(char* out, size_t cap) {
+    return sendATGetString(GF("II"), out, cap);
   }
 
   SimStatus getSimStatusImpl(uint32_t) {
     return SIM_READY;  // unsupported
   }
 
+#if TINY_GSM_USES(SMS)
   /*
    * Messaging functions
    */
  protected:
-  String sendUSSDImpl(const String& code) TINY_GSM_ATTR_NOT_AVAILABLE;
+  size_t sendUSSDImpl(const char* code, char* out,
+                      size_t cap) TINY_GSM_ATTR_NOT_AVAILABLE;
 
   bool sendSMSImpl(const String& number, const String& text) {
     bool changesMade = false;
@@ -991,7 +1015,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
 
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(BATTERY)
   /*
    * Battery functions
    */
@@ -1019,7 +1045,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     milliVolts  = getBattVoltage();
     return true;
   }
+#endif
 
+#if TINY_GSM_USES(TEMPERATURE)
   /*
    * Temperature functions
    */
@@ -1038,7 +1066,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     XBEE_COMMAND_END_DECORATOR
     return static_cast<float>(intRes);
   }
+#endif
 
+#if TINY_GSM_USES(TCP)
   /*
    * Client related functions
    */
@@ -1071,7 +1101,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
   IPAddress lookupHostIP(const char* host, int timeout_s = 45) {
     String strIP;
     strIP.reserve(16);
-    uint32_t startMillis = millis();
+    uint32_t startMillis = TINY_GSM_MILLIS();
     uint32_t timeout_ms  = ((uint32_t)timeout_s) * 1000;
     bool     gotIP       = false;
     XBEE_COMMAND_START_DECORATOR(5, IPAddress(0, 0, 0, 0))
@@ -1079,9 +1109,10 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     // functionality to look up the IP address from a fully qualified domain
     // name
     // NOTE: the lookup can take a while
-    while ((millis() - startMillis) < timeout_ms) {
+    while ((TINY_GSM_MILLIS() - startMillis) < timeout_ms) {
       sendAT(GF("LA"), host);
-      while (stream.available() < 4 && (millis() - startMillis < timeout_ms)) {
+      while (stream.available() < 4 &&
+             (TINY_GSM_MILLIS() - startMillis < timeout_ms)) {
         TINY_GSM_YIELD()
       }
       strIP = stream.readStringUntil('\r');  // read result
@@ -1090,7 +1121,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
         gotIP = true;
         break;
       }
-      delay(2500);  // wait a bit before trying again
+      TINY_GSM_DELAY(2500);  // wait a bit before trying again
     }
 
     XBEE_COMMAND_END_DECORATOR
@@ -1370,6 +1401,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       }
     }
   }
+#endif
 
   /*
    * Utilities
@@ -1382,84 +1414,9 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     }
   }
 
-  // TODO(vshymanskyy): Optimize this!
-  // NOTE:  This function is used while INSIDE command mode, so we're only
-  // waiting for requested responses.  The XBee has no unsoliliced responses
-  // (URC's) when in command mode.
-  int8_t waitResponse(uint32_t timeout_ms, String& data,
-                      GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    /*String r1s(r1); r1s.trim();
-    String r2s(r2); r2s.trim();
-    String r3s(r3); r3s.trim();
-    String r4s(r4); r4s.trim();
-    String r5s(r5); r5s.trim();
-    DBG("### ..:", r1s, ",", r2s, ",", r3s, ",", r4s, ",", r5s);*/
-    data.reserve(16);  // Should never be getting much here for the XBee
-    int8_t   index       = 0;
-    uint32_t startMillis = millis();
-    do {
-      TINY_GSM_YIELD();
-      while (stream.available() > 0) {
-        TINY_GSM_YIELD();
-        int8_t a = stream.read();
-        if (a <= 0) continue;  // Skip 0x00 bytes, just in case
-        data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        }
-      }
-    } while (millis() - startMillis < timeout_ms);
-  finish:
-    if (!index) {
-      data.trim();
-      data.replace(GSM_NL GSM_NL, GSM_NL);
-      data.replace(GSM_NL, "\r\n    ");
-      if (data.length()) {
-        DBG("### Unhandled:", data, "\r\n");
-      } else {
-        DBG("### NO RESPONSE FROM MODEM!\r\n");
-      }
-    } else {
-      data.trim();
-      data.replace(GSM_NL GSM_NL, GSM_NL);
-      data.replace(GSM_NL, "\r\n    ");
-    }
-    // data.replace(GSM_NL, "/");
-    // DBG('<', index, '>', data);
-    return index;
-  }
-
-  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    String data;
-    return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
-  }
-
-  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
-                      GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = NULL,
-                      GsmConstStr r4 = NULL, GsmConstStr r5 = NULL) {
-    return waitResponse(1000, r1, r2, r3, r4, r5);
-  }
-
   bool commandMode(uint8_t retries = 5) {
     // If we're already in command mode, move on
-    if (inCommandMode && (millis() - lastCommandModeMillis) < 10000L)
+    if (inCommandMode && (TINY_GSM_MILLIS() - lastCommandModeMillis) < 10000L)
       return true;
 
     uint8_t triesMade = 0;
@@ -1472,7 +1429,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     while (!success && triesMade < retries) {
       // Cannot send anything for 1 "guard time" before entering command mode
       // Default guard time is 1s, but the init fxn decreases it to 100 ms
-      delay(guardTime + 10);
+      TINY_GSM_DELAY(guardTime + 10);
       streamWrite(GF("+++"));  // enter command mode
 
       if (beeType != XBEE_S6B_WIFI) {
@@ -1487,12 +1444,12 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
         triesUntilReset--;
         if (triesUntilReset == 0) {
           triesUntilReset = 4;
-          pinReset();  // if it's unresponsive, reset
-          delay(250);  // a short delay to allow it to come back up
+          pinReset();           // if it's unresponsive, reset
+          TINY_GSM_DELAY(250);  // a short delay to allow it to come back up
           // TODO(SRGDamia1) optimize this
         }
         if (beeType == XBEE_S6B_WIFI) {
-          delay(5000);  // WiFi module frozen, wait longer
+          TINY_GSM_DELAY(5000);  // WiFi module frozen, wait longer
         }
       }
       triesMade++;
@@ -1500,7 +1457,7 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
 
     if (success) {
       inCommandMode         = true;
-      lastCommandModeMillis = millis();
+      lastCommandModeMillis = TINY_GSM_MILLIS();
     }
     return success;
   }
@@ -1544,14 +1501,27 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
 
   String readResponseString(uint32_t timeout_ms = 1000) {
     TINY_GSM_YIELD();
-    uint32_t startMillis = millis();
-    while (!stream.available() && millis() - startMillis < timeout_ms) {}
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (!stream.available() &&
+           TINY_GSM_MILLIS() - startMillis < timeout_ms) {}
     String res =
         stream.readStringUntil('\r');  // lines end with carriage returns
     res.trim();
     return res;
   }
 
+  // Reads the response into the buffer, trimmed; returns its length
+  size_t readResponseString(char* out, size_t cap,
+                            uint32_t timeout_ms = 1000) {
+    TINY_GSM_YIELD();
+    uint32_t startMillis = TINY_GSM_MILLIS();
+    while (!stream.available() &&
+           TINY_GSM_MILLIS() - startMillis < timeout_ms) {}
+    // lines end with carriage returns
+    streamGetStringBefore('\r', out, cap);
+    return TinyGsmTrim(out);
+  }
+
   int16_t readResponseInt(uint32_t timeout_ms = 1000) {
     String res = readResponseString(
         timeout_ms);  // it just works better reading a string first
@@ -1572,6 +1542,14 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
     return res;
   }
 
+  size_t sendATGetString(GsmConstStr cmd, char* out, size_t cap) {
+    XBEE_COMMAND_START_DECORATOR(5, 0)
+    sendAT(cmd);
+    size_t len = readResponseString(out, cap);
+    XBEE_COMMAND_END_DECORATOR
+    return len;
+  }
+
   bool changeSettingIfNeeded(GsmConstStr cmd, int16_t newValue,
                              uint32_t timeout_ms = 1000L) {
     sendAT(cmd);
@@ -1618,11 +1596,10 @@ class TinyGsmXBee : public TinyGsmModem<TinyGsmXBee>,
       return false;
   }
 
- public:
-  Stream& stream;
-
  protected:
+#if TINY_GSM_USES(TCP)
   GsmClientXBee* sockets[TINY_GSM_MUX_COUNT];
+#endif
   const char*    gsmNL = GSM_NL;
   int16_t        guardTime;
   XBeeType       beeType;
@@ -28,13 +28,37 @@
 #include <Client.h>
 #endif
 
+// The clock the library keeps time with.  Every timeout and wait goes
+// through these, so a port can point them at its own functions, ie an RTOS
+// tick count and a sleeping task delay, or a virtual clock in host tests.
+#ifndef TINY_GSM_MILLIS
+#define TINY_GSM_MILLIS() millis()
+#endif
+
+#ifndef TINY_GSM_MICROS
+#define TINY_GSM_MICROS() micros()
+#endif
+
+#ifndef TINY_GSM_DELAY
+#define TINY_GSM_DELAY(ms) delay(ms)
+#endif
+
 #ifndef TINY_GSM_YIELD_MS
 #define TINY_GSM_YIELD_MS 0
 #endif
 
 #ifndef TINY_GSM_YIELD
+#if defined(TINY_GSM_STATS)
+#define TINY_GSM_YIELD()                                          \
+  {                                                               \
+    uint32_t yield_start = TINY_GSM_MICROS();                     \
+    TINY_GSM_DELAY(TINY_GSM_YIELD_MS);                            \
+    TinyGsmStats::yielded(TINY_GSM_MICROS() - yield_start);       \
+  }
+#else
 #define TINY_GSM_YIELD() \
-  { delay(TINY_GSM_YIELD_MS); }
+  { TINY_GSM_DELAY(TINY_GSM_YIELD_MS); }
+#endif
 #endif
 
 #define TINY_GSM_ATTR_NOT_AVAILABLE \
@@ -53,7 +77,12 @@ typedef const char* GsmConstStr;
 #define GF(x) x
 #endif
 
-#ifdef TINY_GSM_DEBUG
+#if defined(TINY_GSM_TRACE)
+// Keeps the messages in RAM instead, see TinyGsmTrace.h
+#include "TinyGsmTrace.h"
+#define DBG_PLAIN(...) TinyGsmTraceLog().add(__VA_ARGS__)
+#define DBG(...) TinyGsmTraceLog().add(__VA_ARGS__)
+#elif defined(TINY_GSM_DEBUG)
 namespace {
 template <typename T>
 static void DBG_PLAIN(T last) {
@@ -70,7 +99,7 @@ static void DBG_PLAIN(T head, Args... tail) {
 template <typename... Args>
 static void DBG(Args... args) {
   TINY_GSM_DEBUG.print(GF("["));
-  TINY_GSM_DEBUG.print(millis());
+  TINY_GSM_DEBUG.print(TINY_GSM_MILLIS());
   TINY_GSM_DEBUG.print(GF("] "));
   DBG_PLAIN(args...);
 }
@@ -80,6 +109,67 @@ static void DBG(Args... args) {
 #define DBG(...)
 #endif
 
+// Feeds the instrumentation of TinyGsmStats.h, from within a modem class
+#if defined(TINY_GSM_STATS)
+#define TINY_GSM_STAT(call) this->stats().call
+#else
+#define TINY_GSM_STAT(call)
+#endif
+
+// Measures the stack a public function takes, see TinyGsmStack.h
+#if defined(TINY_GSM_STACK)
+#define TINY_GSM_STACK_CALL(name) \
+  TinyGsmStackProbe tiny_gsm_stack_probe(GF(name), __builtin_frame_address(0))
+#else
+#define TINY_GSM_STACK_CALL(name)
+#endif
+
+// The room the String forms of the getters make in the String they return,
+// for the text they read straight into it: short values, ie the IMEI or an
+// IP address; long ones, ie the modem info or a GPS fix; and the hex of a
+// USSD reply, before it is decoded.  It is taken from the heap, not the
+// stack.
+#if !defined(TINY_GSM_SHORT_STRING)
+#define TINY_GSM_SHORT_STRING 48
+#endif
+
+#if !defined(TINY_GSM_LONG_STRING)
+#define TINY_GSM_LONG_STRING 256
+#endif
+
+#if !defined(TINY_GSM_USSD_STRING)
+#define TINY_GSM_USSD_STRING 384
+#endif
+
+// The features a modem class is built with.  Define TINY_GSM_FEATURES as
+// the ones wanted, or'ed together, before including TinyGSM to leave out the
+// rest, their functions, URC handling and buffers, ie
+//   #define TINY_GSM_FEATURES (TINY_GSM_FEATURE_TCP | TINY_GSM_FEATURE_TIME)
+// SSL and UDP bring in the TCP sockets they are built on.  The basic modem,
+// SIM card and network (GPRS or WiFi) functions are always there.
+#define TINY_GSM_FEATURE_TCP 0x0001
+#define TINY_GSM_FEATURE_SSL (0x0002 | TINY_GSM_FEATURE_TCP)
+#define TINY_GSM_FEATURE_UDP (0x0004 | TINY_GSM_FEATURE_TCP)
+#define TINY_GSM_FEATURE_CALLING 0x0008
+#define TINY_GSM_FEATURE_SMS 0x0010
+#define TINY_GSM_FEATURE_GSM_LOCATION 0x0020
+#define TINY_GSM_FEATURE_GPS 0x0040
+#define TINY_GSM_FEATURE_TIME 0x0080
+#define TINY_GSM_FEATURE_NTP 0x0100
+#define TINY_GSM_FEATURE_BATTERY 0x0200
+#define TINY_GSM_FEATURE_TEMPERATURE 0x0400
+#define TINY_GSM_FEATURE_BLUETOOTH 0x0800
+#define TINY_GSM_FEATURE_ALL 0xFFFF
+
+#if !defined(TINY_GSM_FEATURES)
+#define TINY_GSM_FEATURES TINY_GSM_FEATURE_ALL
+#endif
+
+// Whether the modem class is built with a feature, for #if
+#define TINY_GSM_USES(feature)                            \
+  (((TINY_GSM_FEATURES) & TINY_GSM_FEATURE_##feature) == \
+   TINY_GSM_FEATURE_##feature)
+
 template <class T>
 const T& TinyGsmMin(const T& a, const T& b) {
   return (b < a) ? b : a;
@@ -90,6 +180,60 @@ const T& TinyGsmMax(const T& a, const T& b) {
   return (b < a) ? a : b;
 }
 
+// Copies a string into a buffer of cap bytes, cut short if need be, and
+// returns the length copied
+inline size_t TinyGsmCopy(char* out, size_t cap, const char* str) {
+  if (!cap) { return 0; }
+  size_t len = 0;
+  while (str[len] && len + 1 < cap) {
+    out[len] = str[len];
+    len++;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Trims the whitespace off both ends of a string, in place, and returns its
+// new length
+inline size_t TinyGsmTrim(char* str) {
+  size_t start = 0;
+  while (isspace(static_cast<unsigned char>(str[start]))) { start++; }
+  size_t end = start + strlen(str + start);
+  while (end > start && isspace(static_cast<unsigned char>(str[end - 1]))) {
+    end--;
+  }
+  memmove(str, str + start, end - start);
+  str[end - start] = '\0';
+  return end - start;
+}
+
+// Whether str ends with suffix, which may be in flash; unlike
+// String::endsWith() it makes no String of the suffix to compare with
+inline bool TinyGsmEndsWith(const String& str, GsmConstStr suffix) {
+#if defined(__AVR__) && !defined(__AVR_ATmega4809__)
+  const char* s   = reinterpret_cast<const char*>(suffix);
+  size_t      len = strlen_P(s);
+  return str.length() >= len && !strcmp_P(str.c_str() + str.length() - len, s);
+#else
+  size_t len = strlen(suffix);
+  return str.length() >= len &&
+      !strcmp(str.c_str() + str.length() - len, suffix);
+#endif
+}
+
+// Makes str cap - 1 characters long and returns its buffer, for a getter to
+// read its text into, or NULL if there is no memory for it; the String forms
+// of the getters then cut it to the length read with TinyGsmStringEnd()
+inline char* TinyGsmStringBuffer(String& str, size_t cap) {
+  if (!cap || !str.reserve(cap - 1)) { return NULL; }
+  while (str.length() + 1 < cap) { str += ' '; }
+  return &str[0];
+}
+
+inline void TinyGsmStringEnd(String& str, size_t len) {
+  if (len < str.length()) { str.remove(len); }
+}
+
 template <class T>
 uint32_t TinyGsmAutoBaud(T& SerialAT, uint32_t minimum = 9600,
                          uint32_t maximum = 115200) {
@@ -102,7 +246,7 @@ uint32_t TinyGsmAutoBaud(T& SerialAT, uint32_t minimum = 9600,
 
     DBG("Trying baud rate", rate, "...");
     SerialAT.begin(rate);
-    delay(10);
+    TINY_GSM_DELAY(10);
     for (int j = 0; j < 10; j++) {
       SerialAT.print("AT\r\n");
       String input = SerialAT.readString();
@@ -116,4 +260,12 @@ uint32_t TinyGsmAutoBaud(T& SerialAT, uint32_t minimum = 9600,
   return 0;
 }
 
+#if defined(TINY_GSM_STATS)
+#include "TinyGsmStats.h"
+#endif
+
+#if defined(TINY_GSM_STACK)
+#include "TinyGsmStack.h"
+#endif
+
 #endif  // SRC_TINYGSMCOMMON_H_
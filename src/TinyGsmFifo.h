@@ -69,6 +69,22 @@ public:
         return n - c;
     }
 
+    // Points at the free space from the write position up to the wrap, n is
+    // set to its size; fill it in place and commit() what was written
+    T* reserve(int& n)
+    {
+        int w = _w;
+        int m = N - w;
+        n = free();
+        if (n > m) n = m;
+        return &_b[w];
+    }
+
+    void commit(int n)
+    {
+        _w = _inc(_w, n);
+    }
+
     // reading thread/context API
     // --------------------------------------------------------
 
@@ -127,6 +143,31 @@ public:
 		return _b[_r];
 	}
 
+    // Returns how far the first element equal to c is from the read position,
+    // or -1 if there is none.  Byte FIFOs only, it scans with memchr.
+    int indexOf(const T& c)
+    {
+        int r = _r;
+        int w = _w;
+        // the data is in at most two contiguous pieces
+        int m = (w >= r) ? w - r : N - r;
+        const T* f = (const T*)memchr(&_b[r], c, m);
+        if (f) return f - &_b[r];
+        if (w >= r) return -1;
+        f = (const T*)memchr(&_b[0], c, w);
+        if (f) return m + (f - &_b[0]);
+        return -1;
+    }
+
+    // Drops up to n elements, returns how many were dropped
+    int skip(int n)
+    {
+        int s = size();
+        if (n > s) n = s;
+        _r = _inc(_r, n);
+        return n;
+    }
+
 private:
     int _inc(int i, int n = 1)
     {
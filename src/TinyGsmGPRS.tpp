@@ -28,21 +28,53 @@ class TinyGsmGPRS {
    */
   // Unlocks the SIM
   bool simUnlock(const char* pin) {
+    TINY_GSM_STACK_CALL("simUnlock");
     return thisModem().simUnlockImpl(pin);
   }
   // Gets the CCID of a sim card via AT+CCID
   String getSimCCID() {
-    return thisModem().getSimCCIDImpl();
+    TINY_GSM_STACK_CALL("getSimCCID");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getSimCCID(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getSimCCID(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getSimCCID");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getSimCCIDImpl(out, cap);
   }
   // Asks for TA Serial Number Identification (IMEI)
   String getIMEI() {
-    return thisModem().getIMEIImpl();
+    TINY_GSM_STACK_CALL("getIMEI");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getIMEI(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getIMEI(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getIMEI");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getIMEIImpl(out, cap);
   }
   // Asks for International Mobile Subscriber Identity IMSI
   String getIMSI() {
-    return thisModem().getIMSIImpl();
+    TINY_GSM_STACK_CALL("getIMSI");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getIMSI(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getIMSI(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getIMSI");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getIMSIImpl(out, cap);
   }
   SimStatus getSimStatus(uint32_t timeout_ms = 10000L) {
+    TINY_GSM_STACK_CALL("getSimStatus");
     return thisModem().getSimStatusImpl(timeout_ms);
   }
 
@@ -51,18 +83,31 @@ class TinyGsmGPRS {
    */
   bool gprsConnect(const char* apn, const char* user = NULL,
                    const char* pwd = NULL) {
+    TINY_GSM_STACK_CALL("gprsConnect");
     return thisModem().gprsConnectImpl(apn, user, pwd);
   }
   bool gprsDisconnect() {
+    TINY_GSM_STACK_CALL("gprsDisconnect");
     return thisModem().gprsDisconnectImpl();
   }
   // Checks if current attached to GPRS/EPS service
   bool isGprsConnected() {
+    TINY_GSM_STACK_CALL("isGprsConnected");
     return thisModem().isGprsConnectedImpl();
   }
   // Gets the current network operator
   String getOperator() {
-    return thisModem().getOperatorImpl();
+    TINY_GSM_STACK_CALL("getOperator");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getOperator(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getOperator(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getOperator");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getOperatorImpl(out, cap);
   }
 
   /*
@@ -90,42 +135,40 @@ class TinyGsmGPRS {
   }
 
   // Gets the CCID of a sim card via AT+CCID
-  String getSimCCIDImpl() {
+  size_t getSimCCIDImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CCID"));
-    if (thisModem().waitResponse(GF("+CCID:")) != 1) { return ""; }
-    String res = thisModem().stream.readStringUntil('\n');
+    if (thisModem().waitResponse(GF("+CCID:")) != 1) { return 0; }
+    thisModem().streamGetStringBefore('\n', out, cap);
     thisModem().waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // Asks for TA Serial Number Identification (IMEI) via the V.25TER standard
   // AT+GSN command
-  String getIMEIImpl() {
+  size_t getIMEIImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+GSN"));
     thisModem().streamSkipUntil('\n');  // skip first newline
-    String res = thisModem().stream.readStringUntil('\n');
+    thisModem().streamGetStringBefore('\n', out, cap);
     thisModem().waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   // Asks for International Mobile Subscriber Identity IMSI via the AT+CIMI
   // command
-  String getIMSIImpl() {
+  size_t getIMSIImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CIMI"));
     thisModem().streamSkipUntil('\n');  // skip first newline
-    String res = thisModem().stream.readStringUntil('\n');
+    thisModem().streamGetStringBefore('\n', out, cap);
     thisModem().waitResponse();
-    res.trim();
-    return res;
+    return TinyGsmTrim(out);
   }
 
   SimStatus getSimStatusImpl(uint32_t timeout_ms = 10000L) {
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       thisModem().sendAT(GF("+CPIN?"));
       if (thisModem().waitResponse(GF("+CPIN:")) != 1) {
-        delay(1000);
+        TINY_GSM_DELAY(1000);
         continue;
       }
       int8_t status =
@@ -158,13 +201,13 @@ class TinyGsmGPRS {
   }
 
   // Gets the current network operator via the 3GPP TS command AT+COPS
-  String getOperatorImpl() {
+  size_t getOperatorImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+COPS?"));
-    if (thisModem().waitResponse(GF("+COPS:")) != 1) { return ""; }
+    if (thisModem().waitResponse(GF("+COPS:")) != 1) { return 0; }
     thisModem().streamSkipUntil('"'); /* Skip mode and format */
-    String res = thisModem().stream.readStringUntil('"');
+    size_t len = thisModem().streamGetStringBefore('"', out, cap);
     thisModem().waitResponse();
-    return res;
+    return len;
   }
 };
 
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(GPS)
 #define TINY_GSM_MODEM_HAS_GPS
+#endif
 
 template <class modemType>
 class TinyGsmGPS {
@@ -20,23 +22,37 @@ class TinyGsmGPS {
    * GPS/GNSS/GLONASS location functions
    */
   bool enableGPS() {
+    TINY_GSM_STACK_CALL("enableGPS");
     return thisModem().enableGPSImpl();
   }
   bool disableGPS() {
+    TINY_GSM_STACK_CALL("disableGPS");
     return thisModem().disableGPSImpl();
   }
   String getGPSraw() {
-    return thisModem().getGPSrawImpl();
+    TINY_GSM_STACK_CALL("getGPSraw");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_LONG_STRING);
+    TinyGsmStringEnd(res, buf ? getGPSraw(buf, TINY_GSM_LONG_STRING) : 0);
+    return res;
+  }
+  size_t getGPSraw(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getGPSraw");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getGPSrawImpl(out, cap);
   }
   bool getGPS(float* lat, float* lon, float* speed = 0, float* alt = 0,
               int* vsat = 0, int* usat = 0, float* accuracy = 0, int* year = 0,
               int* month = 0, int* day = 0, int* hour = 0, int* minute = 0,
               int* second = 0) {
+    TINY_GSM_STACK_CALL("getGPS");
     return thisModem().getGPSImpl(lat, lon, speed, alt, vsat, usat, accuracy,
                                   year, month, day, hour, minute, second);
   }
   bool getGPSTime(int* year, int* month, int* day, int* hour, int* minute,
                   int* second) {
+    TINY_GSM_STACK_CALL("getGPSTime");
     float lat = 0;
     float lon = 0;
     return thisModem().getGPSImpl(&lat, &lon, 0, 0, 0, 0, 0, year, month, day,
@@ -44,10 +60,12 @@ class TinyGsmGPS {
   }
 
   String setGNSSMode(uint8_t mode, bool dpo) {
+    TINY_GSM_STACK_CALL("setGNSSMode");
     return thisModem().setGNSSModeImpl(mode, dpo);
   }
 
   uint8_t getGNSSMode() {
+    TINY_GSM_STACK_CALL("getGNSSMode");
     return thisModem().getGNSSModeImpl();
   }
 
@@ -68,7 +86,7 @@ class TinyGsmGPS {
 
   bool    enableGPSImpl() TINY_GSM_ATTR_NOT_IMPLEMENTED;
   bool    disableGPSImpl() TINY_GSM_ATTR_NOT_IMPLEMENTED;
-  String  getGPSrawImpl() TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  size_t  getGPSrawImpl(char* out, size_t cap) TINY_GSM_ATTR_NOT_IMPLEMENTED;
   bool    getGPSImpl(float* lat, float* lon, float* speed = 0, float* alt = 0,
                      int* vsat = 0, int* usat = 0, float* accuracy = 0,
                      int* year = 0, int* month = 0, int* day = 0, int* hour = 0,
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(GSM_LOCATION)
 #define TINY_GSM_MODEM_HAS_GSM_LOCATION
+#endif
 
 template <class modemType>
 class TinyGsmGSMLocation {
@@ -20,22 +22,26 @@ class TinyGsmGSMLocation {
    * GSM Location functions
    */
   String getGsmLocationRaw() {
+    TINY_GSM_STACK_CALL("getGsmLocationRaw");
     return thisModem().getGsmLocationRawImpl();
   }
 
   String getGsmLocation() {
+    TINY_GSM_STACK_CALL("getGsmLocation");
     return thisModem().getGsmLocationRawImpl();
   }
 
   bool getGsmLocation(float* lat, float* lon, float* accuracy = 0,
                       int* year = 0, int* month = 0, int* day = 0,
                       int* hour = 0, int* minute = 0, int* second = 0) {
+    TINY_GSM_STACK_CALL("getGsmLocation");
     return thisModem().getGsmLocationImpl(lat, lon, accuracy, year, month, day,
                                           hour, minute, second);
   };
 
   bool getGsmLocationTime(int* year, int* month, int* day, int* hour,
                           int* minute, int* second) {
+    TINY_GSM_STACK_CALL("getGsmLocationTime");
     float lat      = 0;
     float lon      = 0;
     float accuracy = 0;
@@ -9,7 +9,7 @@
 #ifndef SRC_TINYGSMMODEM_H_
 #define SRC_TINYGSMMODEM_H_
 
-#include "TinyGsmCommon.h"
+#include "TinyGsmAtCore.h"
 
 template <class modemType>
 class TinyGsmModem {
@@ -18,35 +18,66 @@ class TinyGsmModem {
    * Basic functions
    */
   bool begin(const char* pin = NULL) {
+    TINY_GSM_STACK_CALL("begin");
     return thisModem().initImpl(pin);
   }
   bool init(const char* pin = NULL) {
+    TINY_GSM_STACK_CALL("init");
     return thisModem().initImpl(pin);
   }
   template <typename... Args>
   inline void sendAT(Args... cmd) {
+#if defined(TINY_GSM_STATS)
+    thisModem().stats().beginCommand(cmd...);
+#endif
     thisModem().streamWrite("AT", cmd..., thisModem().gsmNL);
     thisModem().stream.flush();
     TINY_GSM_YIELD(); /* DBG("### AT:", cmd...); */
   }
   void setBaud(uint32_t baud) {
+    TINY_GSM_STACK_CALL("setBaud");
     thisModem().setBaudImpl(baud);
   }
   // Test response to AT commands
   bool testAT(uint32_t timeout_ms = 10000L) {
+    TINY_GSM_STACK_CALL("testAT");
     return thisModem().testATImpl(timeout_ms);
   }
 
   // Asks for modem information via the V.25TER standard ATI command
   // NOTE:  The actual value and style of the response is quite varied
   String getModemInfo() {
-    return thisModem().getModemInfoImpl();
+    TINY_GSM_STACK_CALL("getModemInfo");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_LONG_STRING);
+    TinyGsmStringEnd(res, buf ? getModemInfo(buf, TINY_GSM_LONG_STRING) : 0);
+    return res;
+  }
+  // Reads the modem information into out, cut to cap - 1 characters, and
+  // returns its length; 0 if there is none.  So do the other char buffer
+  // forms of the getters.
+  size_t getModemInfo(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getModemInfo");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getModemInfoImpl(out, cap);
   }
   // Gets the modem name (as it calls itself)
   String getModemName() {
-    return thisModem().getModemNameImpl();
+    TINY_GSM_STACK_CALL("getModemName");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getModemName(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getModemName(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getModemName");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getModemNameImpl(out, cap);
   }
   bool factoryDefault() {
+    TINY_GSM_STACK_CALL("factoryDefault");
     return thisModem().factoryDefaultImpl();
   }
 
@@ -54,18 +85,23 @@ class TinyGsmModem {
    * Power functions
    */
   bool restart(const char* pin = NULL) {
+    TINY_GSM_STACK_CALL("restart");
     return thisModem().restartImpl(pin);
   }
   bool poweroff() {
+    TINY_GSM_STACK_CALL("poweroff");
     return thisModem().powerOffImpl();
   }
   bool radioOff() {
+    TINY_GSM_STACK_CALL("radioOff");
     return thisModem().radioOffImpl();
   }
   bool sleepEnable(bool enable = true) {
+    TINY_GSM_STACK_CALL("sleepEnable");
     return thisModem().sleepEnableImpl(enable);
   }
   bool setPhoneFunctionality(uint8_t fun, bool reset = false) {
+    TINY_GSM_STACK_CALL("setPhoneFunctionality");
     return thisModem().setPhoneFunctionalityImpl(fun, reset);
   }
 
@@ -74,21 +110,37 @@ class TinyGsmModem {
    */
   // RegStatus getRegistrationStatus() {}
   bool isNetworkConnected() {
+    TINY_GSM_STACK_CALL("isNetworkConnected");
     return thisModem().isNetworkConnectedImpl();
   }
   // Waits for network attachment
   bool waitForNetwork(uint32_t timeout_ms = 60000L, bool check_signal = false) {
+    TINY_GSM_STACK_CALL("waitForNetwork");
     return thisModem().waitForNetworkImpl(timeout_ms, check_signal);
   }
   // Gets signal quality report
   int16_t getSignalQuality() {
+    TINY_GSM_STACK_CALL("getSignalQuality");
     return thisModem().getSignalQualityImpl();
   }
   String getLocalIP() {
-    return thisModem().getLocalIPImpl();
+    TINY_GSM_STACK_CALL("getLocalIP");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    TinyGsmStringEnd(res, buf ? getLocalIP(buf, TINY_GSM_SHORT_STRING) : 0);
+    return res;
+  }
+  size_t getLocalIP(char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getLocalIP");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getLocalIPImpl(out, cap);
   }
   IPAddress localIP() {
-    return thisModem().TinyGsmIpFromString(thisModem().getLocalIP());
+    TINY_GSM_STACK_CALL("localIP");
+    char buf[TINY_GSM_SHORT_STRING];
+    getLocalIP(buf, sizeof(buf));
+    return thisModem().TinyGsmIpFromString(buf);
   }
 
   /*
@@ -112,45 +164,38 @@ class TinyGsmModem {
   }
 
   bool testATImpl(uint32_t timeout_ms = 10000L) {
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       thisModem().sendAT(GF(""));
       if (thisModem().waitResponse(200) == 1) { return true; }
-      delay(100);
+      TINY_GSM_DELAY(100);
     }
     return false;
   }
 
-  String getModemInfoImpl() {
+  size_t getModemInfoImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("I"));
-    String res;
-    if (thisModem().waitResponse(1000L, res) != 1) { return ""; }
-    // Do the replaces twice so we cover both \r and \r\n type endings
-    res.replace("\r\nOK\r\n", "");
-    res.replace("\rOK\r", "");
-    res.replace("\r\n", " ");
-    res.replace("\r", " ");
-    res.trim();
-    return res;
+    if (!thisModem().streamGetLines(out, cap, " ", 1000L)) { return 0; }
+    return strlen(out);
   }
 
-  String getModemNameImpl() {
+  size_t getModemNameImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CGMI"));
-    String res1;
-    if (thisModem().waitResponse(1000L, res1) != 1) { return "unknown"; }
-    res1.replace("\r\nOK\r\n", "");
-    res1.replace("\rOK\r", "");
-    res1.trim();
+    if (!thisModem().streamGetLines(out, cap, " ", 1000L)) {
+      return TinyGsmCopy(out, cap, "unknown");
+    }
+    size_t len = strlen(out);
 
     thisModem().sendAT(GF("+GMM"));
-    String res2;
-    if (thisModem().waitResponse(1000L, res2) != 1) { return "unknown"; }
-    res2.replace("\r\nOK\r\n", "");
-    res2.replace("\rOK\r", "");
-    res2.trim();
-
-    String name = res1 + String(' ') + res2;
-    DBG("### Modem:", name);
-    return name;
+    if (len + 2 >= cap ||
+        !thisModem().streamGetLines(out + len + 1, cap - len - 1, " ",
+                                    1000L)) {
+      return TinyGsmCopy(out, cap, "unknown");
+    }
+    out[len] = ' ';
+    len      = strlen(out);
+    DBG("### Modem:", out);
+    return len;
   }
 
   bool factoryDefaultImpl() {
@@ -168,7 +213,7 @@ class TinyGsmModem {
  protected:
   bool radioOffImpl() {
     if (!thisModem().setPhoneFunctionality(0)) { return false; }
-    delay(3000);
+    TINY_GSM_DELAY(3000);
     return true;
   }
 
@@ -199,10 +244,11 @@ class TinyGsmModem {
 
   bool waitForNetworkImpl(uint32_t timeout_ms   = 60000L,
                           bool     check_signal = false) {
-    for (uint32_t start = millis(); millis() - start < timeout_ms;) {
+    for (uint32_t start = TINY_GSM_MILLIS();
+         TINY_GSM_MILLIS() - start < timeout_ms;) {
       if (check_signal) { thisModem().getSignalQuality(); }
       if (thisModem().isNetworkConnected()) { return true; }
-      delay(250);
+      TINY_GSM_DELAY(250);
     }
     return false;
   }
@@ -216,21 +262,28 @@ class TinyGsmModem {
     return res;
   }
 
-  String getLocalIPImpl() {
+  size_t getLocalIPImpl(char* out, size_t cap) {
     thisModem().sendAT(GF("+CGPADDR=1"));
-    if (thisModem().waitResponse(GF("+CGPADDR:")) != 1) { return ""; }
+    if (thisModem().waitResponse(GF("+CGPADDR:")) != 1) { return 0; }
     thisModem().streamSkipUntil(',');  // Skip context id
-    String res = thisModem().stream.readStringUntil('\r');
-    if (thisModem().waitResponse() != 1) { return ""; }
-    return res;
+    size_t len = thisModem().streamGetStringBefore('\r', out, cap);
+    if (thisModem().waitResponse() != 1) {
+      out[0] = '\0';
+      return 0;
+    }
+    return len;
   }
 
   static inline IPAddress TinyGsmIpFromString(const String& strIP) {
+    return TinyGsmIpFromString(strIP.c_str());
+  }
+
+  static inline IPAddress TinyGsmIpFromString(const char* strIP) {
     int Parts[4] = {
         0,
     };
     int Part = 0;
-    for (uint8_t i = 0; i < strIP.length(); i++) {
+    for (uint8_t i = 0; strIP[i]; i++) {
       char c = strIP[i];
       if (c == '.') {
         Part++;
@@ -267,88 +320,6 @@ class TinyGsmModem {
       thisModem().waitResponse(50, NULL, NULL);
     }
   }
-
- protected:
-  inline bool streamGetLength(char* buf, int8_t numChars,
-                              const uint32_t timeout_ms = 1000L) {
-    if (!buf) { return false; }
-
-    int8_t   numCharsReady = -1;
-    uint32_t startMillis   = millis();
-    while (millis() - startMillis < timeout_ms &&
-           (numCharsReady = thisModem().stream.available()) < numChars) {
-      TINY_GSM_YIELD();
-    }
-
-    if (numCharsReady >= numChars) {
-      thisModem().stream.readBytes(buf, numChars);
-      return true;
-    }
-
-    return false;
-  }
-
-  inline int16_t streamGetIntLength(int8_t         numChars,
-                                    const uint32_t timeout_ms = 1000L) {
-    char buf[numChars + 1];
-    if (streamGetLength(buf, numChars, timeout_ms)) {
-      buf[numChars] = '\0';
-      return atoi(buf);
-    }
-
-    return -9999;
-  }
-
-  inline int16_t streamGetIntBefore(char lastChar) {
-    char   buf[7];
-    size_t bytesRead = thisModem().stream.readBytesUntil(
-        lastChar, buf, static_cast<size_t>(7));
-    // if we read 7 or more bytes, it's an overflow
-    if (bytesRead && bytesRead < 7) {
-      buf[bytesRead] = '\0';
-      int16_t res    = atoi(buf);
-      return res;
-    }
-
-    return -9999;
-  }
-
-  inline float streamGetFloatLength(int8_t         numChars,
-                                    const uint32_t timeout_ms = 1000L) {
-    char buf[numChars + 1];
-    if (streamGetLength(buf, numChars, timeout_ms)) {
-      buf[numChars] = '\0';
-      return atof(buf);
-    }
-
-    return -9999.0F;
-  }
-
-  inline float streamGetFloatBefore(char lastChar) {
-    char   buf[16];
-    size_t bytesRead = thisModem().stream.readBytesUntil(
-        lastChar, buf, static_cast<size_t>(16));
-    // if we read 16 or more bytes, it's an overflow
-    if (bytesRead && bytesRead < 16) {
-      buf[bytesRead] = '\0';
-      float res      = atof(buf);
-      return res;
-    }
-
-    return -9999.0F;
-  }
-
-  inline bool streamSkipUntil(const char c, const uint32_t timeout_ms = 1000L) {
-    uint32_t startMillis = millis();
-    while (millis() - startMillis < timeout_ms) {
-      while (millis() - startMillis < timeout_ms &&
-             !thisModem().stream.available()) {
-        TINY_GSM_YIELD();
-      }
-      if (thisModem().stream.read() == c) { return true; }
-    }
-    return false;
-  }
 };
 
 #endif  // SRC_TINYGSMMODEM_H_
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(NTP)
 #define TINY_GSM_MODEM_HAS_NTP
+#endif
 
 template <class modemType>
 class TinyGsmNTP {
@@ -33,9 +35,11 @@ class TinyGsmNTP {
   }
 
   byte NTPServerSync(String server = "pool.ntp.org", byte TimeZone = 3) {
+    TINY_GSM_STACK_CALL("NTPServerSync");
     return thisModem().NTPServerSyncImpl(server, TimeZone);
   }
   String ShowNTPError(byte error) {
+    TINY_GSM_STACK_CALL("ShowNTPError");
     return thisModem().ShowNTPErrorImpl(error);
   }
 
@@ -0,0 +1,148 @@
+/**
+ * @file       TinyGsmRecorder.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Records the AT traffic between the library and the modem in a compact
+ * binary log, so a capture of a problem in the field can be replayed into
+ * the host build (see tools/host/TrafficReplay.h).  The log starts with the
+ * 8 byte magic "TGSMREC1", followed by records of
+ *
+ *   <direction> <ms since the last record> <length> <bytes>
+ *
+ * where the direction is one byte, 0 for bytes from the modem and 1 for
+ * bytes to it, and the time and length are unsigned LEB128 varints.  Bytes
+ * going the same way in the same millisecond share a record.
+ */
+
+#ifndef SRC_TINYGSMRECORDER_H_
+#define SRC_TINYGSMRECORDER_H_
+
+#include "TinyGsmCommon.h"
+
+// Bytes gathered into one record before it is written out
+#if !defined(TINY_GSM_RECORDER_BUFFER)
+#define TINY_GSM_RECORDER_BUFFER 32
+#endif
+
+#define TINY_GSM_RECORDER_MAGIC "TGSMREC1"
+
+// Writes the records of a traffic log to any Print, ie a file on an SD card
+// or a spare serial port
+class TinyGsmTrafficLog {
+ public:
+  enum Direction { FROM_MODEM = 0, TO_MODEM = 1 };
+
+  explicit TinyGsmTrafficLog(Print& out)
+      : out(out),
+        started(false),
+        last_ms(0),
+        dir(FROM_MODEM),
+        buf_ms(0),
+        len(0) {}
+
+  void add(Direction direction, uint8_t c) {
+    uint32_t now = TINY_GSM_MILLIS();
+    if (len &&
+        (direction != dir || now != buf_ms || len >= sizeof(buf))) {
+      flush();
+    }
+    if (!len) {
+      dir    = direction;
+      buf_ms = now;
+    }
+    buf[len++] = c;
+  }
+
+  void add(Direction direction, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) { add(direction, data[i]); }
+  }
+
+  // Writes out the record being gathered, ie when the line goes idle
+  void flush() {
+    if (!started) {
+      out.write(reinterpret_cast<const uint8_t*>(TINY_GSM_RECORDER_MAGIC),
+                8);
+      started = true;
+      last_ms = len ? buf_ms : TINY_GSM_MILLIS();
+    }
+    if (!len) { return; }
+    out.write(static_cast<uint8_t>(dir));
+    writeVarint(buf_ms - last_ms);
+    writeVarint(len);
+    out.write(buf, len);
+    last_ms = buf_ms;
+    len     = 0;
+  }
+
+ protected:
+  void writeVarint(uint32_t value) {
+    while (value >= 0x80) {
+      out.write(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    out.write(static_cast<uint8_t>(value));
+  }
+
+  Print&    out;
+  bool      started;
+  uint32_t  last_ms;  // Time of the last record written
+  Direction dir;      // Direction of the record being gathered
+  uint32_t  buf_ms;   // Time of the record being gathered
+  uint8_t   buf[TINY_GSM_RECORDER_BUFFER];
+  size_t    len;
+};
+
+// A Stream to hand the modem in place of its serial port, which passes
+// everything through and logs it.  Bytes from the modem are logged when the
+// library reads them, so the log holds what the library saw, when it saw it.
+class TinyGsmRecorder : public Stream {
+ public:
+  TinyGsmRecorder(Stream& modem, Print& out) : modem(modem), log(out) {}
+
+  TinyGsmTrafficLog& traffic() {
+    return log;
+  }
+
+  int available() override {
+    return modem.available();
+  }
+
+  int read() override {
+    int c = modem.read();
+    if (c >= 0) {
+      log.add(TinyGsmTrafficLog::FROM_MODEM, static_cast<uint8_t>(c));
+    }
+    return c;
+  }
+
+  int peek() override {
+    return modem.peek();
+  }
+
+  size_t write(uint8_t c) override {
+    size_t n = modem.write(c);
+    if (n) { log.add(TinyGsmTrafficLog::TO_MODEM, c); }
+    return n;
+  }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    size_t n = modem.write(buffer, size);
+    log.add(TinyGsmTrafficLog::TO_MODEM, buffer, n);
+    return n;
+  }
+  using Print::write;
+
+  void flush() override {
+    modem.flush();
+    log.flush();
+  }
+
+ protected:
+  Stream&           modem;
+  TinyGsmTrafficLog log;
+};
+
+#endif  // SRC_TINYGSMRECORDER_H_
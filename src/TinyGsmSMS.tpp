@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(SMS)
 #define TINY_GSM_MODEM_HAS_SMS
+#endif
 
 template <class modemType>
 class TinyGsmSMS {
@@ -20,12 +22,27 @@ class TinyGsmSMS {
    * Messaging functions
    */
   String sendUSSD(const String& code) {
-    return thisModem().sendUSSDImpl(code);
+    TINY_GSM_STACK_CALL("sendUSSD");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_USSD_STRING);
+    size_t len = buf ? sendUSSD(code.c_str(), buf, TINY_GSM_USSD_STRING) : 0;
+    TinyGsmStringEnd(res, len);
+    return res;
+  }
+  // The reply is read into out as hex and decoded there, so out needs room
+  // for the hex, 2 or 4 characters for each one of the reply
+  size_t sendUSSD(const char* code, char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("sendUSSD");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().sendUSSDImpl(code, out, cap);
   }
   bool sendSMS(const String& number, const String& text) {
+    TINY_GSM_STACK_CALL("sendSMS");
     return thisModem().sendSMSImpl(number, text);
   }
   bool sendSMS_UTF16(const char* const number, const void* text, size_t len) {
+    TINY_GSM_STACK_CALL("sendSMS_UTF16");
     return thisModem().sendSMS_UTF16Impl(number, text, len);
   }
 
@@ -44,74 +61,78 @@ class TinyGsmSMS {
    * Messaging functions
    */
  protected:
-  static inline String TinyGsmDecodeHex7bit(String& instr) {
-    String result;
-    byte   reminder = 0;
-    int8_t bitstate = 7;
-    for (uint8_t i = 0; i < instr.length(); i += 2) {
-      char buf[4] = {
-          0,
-      };
-      buf[0] = instr[i];
-      buf[1] = instr[i + 1];
-      byte b = strtol(buf, NULL, 16);
-
-      byte bb = b << (7 - bitstate);
-      char c  = (bb + reminder) & 0x7F;
-      result += c;
-      reminder = b >> bitstate;
+  static inline uint8_t TinyGsmHexByte(const char* hex) {
+    char buf[3] = {hex[0], hex[1], '\0'};
+    return strtol(buf, NULL, 16);
+  }
+
+  // The decoders turn the hex of len characters in buf into the text, in
+  // place, and return its length
+
+  static inline size_t TinyGsmDecodeHex7bit(char* buf, size_t len) {
+    size_t  out      = 0;
+    byte    reminder = 0;
+    int8_t  bitstate = 7;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+      byte b = TinyGsmHexByte(buf + i);
+
+      byte bb    = b << (7 - bitstate);
+      buf[out++] = (bb + reminder) & 0x7F;
+      reminder   = b >> bitstate;
       bitstate--;
       if (bitstate == 0) {
-        char cc = reminder;
-        result += cc;
-        reminder = 0;
-        bitstate = 7;
+        buf[out++] = reminder;
+        reminder   = 0;
+        bitstate   = 7;
       }
     }
-    return result;
-  }
-
-  static inline String TinyGsmDecodeHex8bit(String& instr) {
-    String result;
-    for (uint16_t i = 0; i < instr.length(); i += 2) {
-      char buf[4] = {
-          0,
-      };
-      buf[0] = instr[i];
-      buf[1] = instr[i + 1];
-      char b = strtol(buf, NULL, 16);
-      result += b;
+    buf[out] = '\0';
+    return out;
+  }
+
+  static inline size_t TinyGsmDecodeHex8bit(char* buf, size_t len) {
+    size_t out = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+      buf[out++] = TinyGsmHexByte(buf + i);
     }
-    return result;
-  }
-
-  static inline String TinyGsmDecodeHex16bit(String& instr) {
-    String result;
-    for (uint16_t i = 0; i < instr.length(); i += 4) {
-      char buf[4] = {
-          0,
-      };
-      buf[0] = instr[i];
-      buf[1] = instr[i + 1];
-      char b = strtol(buf, NULL, 16);
-      if (b) {  // If high byte is non-zero, we can't handle it ;(
+    buf[out] = '\0';
+    return out;
+  }
+
+  static inline size_t TinyGsmDecodeHex16bit(char* buf, size_t len,
+                                             size_t cap) {
+    size_t out = 0;
+    for (size_t i = 0; i + 3 < len; i += 4) {
+      char hex[4];
+      memcpy(hex, buf + i, 4);
+      if (TinyGsmHexByte(hex)) {
+        // If high byte is non-zero, we can't handle it ;(
 #if defined(TINY_GSM_UNICODE_TO_HEX)
-        result += "\\x";
-        result += instr.substring(i, i + 4);
-#else
-        result += "?";
+        // "\x" and the 4 digits outgrow them, so the rest of the hex moves
+        // up by 2 to make room, if there is any
+        if (out + 2 > i && len + 2 < cap) {
+          memmove(buf + i + 6, buf + i + 4, len - i - 4);
+          len += 2;
+          i += 2;
+        }
+        if (out + 6 <= i + 4) {
+          buf[out++] = '\\';
+          buf[out++] = 'x';
+          memcpy(buf + out, hex, 4);
+          out += 4;
+          continue;
+        }
 #endif
+        buf[out++] = '?';
       } else {
-        buf[0] = instr[i + 2];
-        buf[1] = instr[i + 3];
-        b      = strtol(buf, NULL, 16);
-        result += b;
+        buf[out++] = TinyGsmHexByte(hex + 2);
       }
     }
-    return result;
+    buf[out] = '\0';
+    return out;
   }
 
-  String sendUSSDImpl(const String& code) {
+  size_t sendUSSDImpl(const char* code, char* out, size_t cap) {
     // Set preferred message format to text mode
     thisModem().sendAT(GF("+CMGF=1"));
     thisModem().waitResponse();
@@ -120,19 +141,19 @@ class TinyGsmSMS {
     thisModem().waitResponse();
     // Send the message
     thisModem().sendAT(GF("+CUSD=1,\""), code, GF("\""));
-    if (thisModem().waitResponse() != 1) { return ""; }
-    if (thisModem().waitResponse(10000L, GF("+CUSD:")) != 1) { return ""; }
-    thisModem().stream.readStringUntil('"');
-    String hex = thisModem().stream.readStringUntil('"');
-    thisModem().stream.readStringUntil(',');
+    if (thisModem().waitResponse() != 1) { return 0; }
+    if (thisModem().waitResponse(10000L, GF("+CUSD:")) != 1) { return 0; }
+    thisModem().streamSkipUntil('"');
+    size_t len = thisModem().streamGetStringBefore('"', out, cap);
+    thisModem().streamSkipUntil(',');
     int8_t dcs = thisModem().streamGetIntBefore('\n');
 
     if (dcs == 15) {
-      return TinyGsmDecodeHex8bit(hex);
+      return TinyGsmDecodeHex8bit(out, len);
     } else if (dcs == 72) {
-      return TinyGsmDecodeHex16bit(hex);
+      return TinyGsmDecodeHex16bit(out, len, cap);
     } else {
-      return hex;
+      return len;
     }
   }
 
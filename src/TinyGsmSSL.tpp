@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(SSL)
 #define TINY_GSM_MODEM_HAS_SSL
+#endif
 
 
 template <class modemType>
@@ -21,9 +23,11 @@ class TinyGsmSSL {
    * SSL functions
    */
   bool addCertificate(const char* filename) {
+    TINY_GSM_STACK_CALL("addCertificate");
     return thisModem().addCertificateImpl(filename);
   }
   bool deleteCertificate() {
+    TINY_GSM_STACK_CALL("deleteCertificate");
     return thisModem().deleteCertificateImpl();
   }
 
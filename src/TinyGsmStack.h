@@ -0,0 +1,192 @@
+/**
+ * @file       TinyGsmStack.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Measures the stack the public functions take, compiled in when
+ * TINY_GSM_STACK is defined before including TinyGSM.  When a call to the
+ * library begins, the TINY_GSM_STACK_PAINT bytes below it are painted with a
+ * pattern, and when it returns the deepest painted byte that changed is how
+ * far down it went.  The calls are kept by name, with the most any of them
+ * took; calls made from within another one are part of it and not kept on
+ * their own.
+ *
+ *   SerialMon.print(TinyGsmStackLog());
+ *   uint16_t deepest = TinyGsmStackLog().peak();
+ *
+ * Painting takes time and the stack it paints must be free, so keep
+ * TINY_GSM_STACK_PAINT below what the board has left, and use this to find
+ * the budget, not in production.
+ */
+
+#ifndef SRC_TINYGSMSTACK_H_
+#define SRC_TINYGSMSTACK_H_
+
+#include "TinyGsmCommon.h"
+
+// Bytes painted below a call; a call that takes them all is shown as
+// taking at least that much
+#if !defined(TINY_GSM_STACK_PAINT)
+#if defined(__AVR__)
+#define TINY_GSM_STACK_PAINT 512
+#else
+#define TINY_GSM_STACK_PAINT 4096
+#endif
+#endif
+
+// The functions tracked; once they are all taken, the rest aren't
+#if !defined(TINY_GSM_STACK_CALLS)
+#define TINY_GSM_STACK_CALLS 32
+#endif
+
+#define TINY_GSM_STACK_PATTERN 0xA5
+
+// The stack one function took
+struct TinyGsmStackCall {
+  GsmConstStr name;   // Where it was measured, ie "available"
+  uint16_t    count;  // Calls measured
+  uint16_t    peak;   // The most one of them took, in bytes
+  bool        full;   // One took all of the paint, so peak is a minimum
+};
+
+class TinyGsmStack : public Printable {
+ public:
+  TinyGsmStack() : depth(0) {
+    reset();
+  }
+
+  void reset() {
+    used = 0;
+  }
+
+  /*
+   * Results
+   */
+  // The functions measured, in the order they were first called
+  uint8_t callCount() const {
+    return used;
+  }
+  const TinyGsmStackCall& call(uint8_t i) const {
+    return calls[i < used ? i : 0];
+  }
+  // The most any call took
+  uint16_t peak() const {
+    uint16_t res = 0;
+    for (uint8_t i = 0; i < used; i++) {
+      if (calls[i].peak > res) { res = calls[i].peak; }
+    }
+    return res;
+  }
+
+  size_t printTo(Print& p) const override {
+    size_t n = p.print(GF("function             calls  stack B\r\n"));
+    for (uint8_t i = 0; i < used; i++) {
+      const TinyGsmStackCall& c = calls[i];
+      char                    buf[8];
+      size_t                  start = n;
+      n += p.print(c.name);
+      while (n - start < 20) { n += p.print(' '); }
+      snprintf(buf, sizeof(buf), "%u", static_cast<unsigned>(c.count));
+      n += printRight(p, buf, 6);
+      snprintf(buf, sizeof(buf), "%s%u", c.full ? ">" : "",
+               static_cast<unsigned>(c.peak));
+      n += printRight(p, buf, 9);
+      n += p.print(GF("\r\n"));
+    }
+    return n;
+  }
+
+  /*
+   * Recording, called by TinyGsmStackProbe
+   */
+  // A call begins, with its frame at top
+  void enter(uintptr_t top) {
+    if (depth++) { return; }
+    this->top = top;
+    low       = paint();
+  }
+
+  void leave(GsmConstStr name) {
+    if (--depth) { return; }
+    uintptr_t deepest = low + untouched(low);
+    uint16_t  taken   = top > deepest ? top - deepest : 0;
+    record(name, taken, deepest == low);
+  }
+
+ protected:
+  // Paints the stack below the caller and returns its lowest address
+  __attribute__((noinline, no_sanitize_address)) static uintptr_t paint() {
+    volatile uint8_t area[TINY_GSM_STACK_PAINT];
+    for (uint16_t i = 0; i < TINY_GSM_STACK_PAINT; i++) {
+      area[i] = TINY_GSM_STACK_PATTERN;
+    }
+    return reinterpret_cast<uintptr_t>(area);
+  }
+
+  // The painted bytes from low up that are still as they were painted
+  __attribute__((noinline, no_sanitize_address)) static uint16_t untouched(
+      uintptr_t low) {
+    volatile uint8_t* area = reinterpret_cast<volatile uint8_t*>(low);
+    uint16_t          i    = 0;
+    while (i < TINY_GSM_STACK_PAINT && area[i] == TINY_GSM_STACK_PATTERN) {
+      i++;
+    }
+    return i;
+  }
+
+  void record(GsmConstStr name, uint16_t taken, bool full) {
+    // Each call site has its own name literal, so the pointer is the key
+    uint8_t i = 0;
+    while (i < used && calls[i].name != name) { i++; }
+    if (i == used) {
+      if (used == TINY_GSM_STACK_CALLS) { return; }
+      calls[i].name  = name;
+      calls[i].count = 0;
+      calls[i].peak  = 0;
+      calls[i].full  = false;
+      used++;
+    }
+    TinyGsmStackCall& c = calls[i];
+    if (c.count < 0xFFFF) { c.count++; }
+    if (taken > c.peak) { c.peak = taken; }
+    if (full) { c.full = true; }
+  }
+
+  static size_t printRight(Print& p, const char* text, size_t width) {
+    size_t n = 0;
+    for (size_t len = strlen(text); len + n < width; n++) { p.print(' '); }
+    return n + p.print(text);
+  }
+
+  TinyGsmStackCall calls[TINY_GSM_STACK_CALLS];
+  uint8_t          used;
+
+  uint8_t   depth;  // Calls in progress, one within the other
+  uintptr_t top;    // The frame of the outermost one
+  uintptr_t low;    // The bottom of the paint under it
+};
+
+// The measurements of the whole program
+inline TinyGsmStack& TinyGsmStackLog() {
+  static TinyGsmStack stack;
+  return stack;
+}
+
+// Measures the function it is declared in, from its frame to the end of it;
+// when the function is inlined, that is the frame of its caller
+class TinyGsmStackProbe {
+ public:
+  TinyGsmStackProbe(GsmConstStr name, void* frame) : name(name) {
+    TinyGsmStackLog().enter(reinterpret_cast<uintptr_t>(frame));
+  }
+  ~TinyGsmStackProbe() {
+    TinyGsmStackLog().leave(name);
+  }
+
+ protected:
+  GsmConstStr name;
+};
+
+#endif  // SRC_TINYGSMSTACK_H_
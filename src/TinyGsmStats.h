@@ -0,0 +1,314 @@
+/**
+ * @file       TinyGsmStats.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Instrumentation of the AT traffic, compiled in when TINY_GSM_STATS is
+ * defined before including TinyGSM.  Each command is timed from sendAT() to
+ * the end of the last wait for a reply to it, and the times are kept per
+ * command, by its text up to the first '=' or '?'.  Waits that expect
+ * nothing, the URC polls, don't count.  The time spent in TINY_GSM_YIELD(),
+ * the bytes read as responses and URC's, the socket payload and the bytes
+ * no one handled are counted too.
+ *
+ *   Serial.print(modem.stats());
+ *   uint32_t slowest = modem.stats().command(0).max_us;
+ */
+
+#ifndef SRC_TINYGSMSTATS_H_
+#define SRC_TINYGSMSTATS_H_
+
+#include "TinyGsmCommon.h"
+
+// The commands tracked; once they are all taken, the last one counts the
+// rest
+#if !defined(TINY_GSM_STATS_COMMANDS)
+#define TINY_GSM_STATS_COMMANDS 16
+#endif
+
+// Characters of a command kept as its name, with the terminating NUL
+#if !defined(TINY_GSM_STATS_KEY_LEN)
+#define TINY_GSM_STATS_KEY_LEN 12
+#endif
+
+// Latency histogram buckets; bucket i counts the commands that took less
+// than 2^(i + 8) us, the last one all the slower ones
+#define TINY_GSM_STATS_BUCKETS 16
+
+// The times and counts of one command
+struct TinyGsmCommandStats {
+  char     key[TINY_GSM_STATS_KEY_LEN];  // ie "+CSQ", without the AT
+  uint32_t count;
+  uint32_t timeouts;  // Commands a reply was waited for in vain
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint16_t buckets[TINY_GSM_STATS_BUCKETS];
+
+  void clear() {
+    memset(this, 0, sizeof(*this));
+    min_us = 0xFFFFFFFF;
+  }
+
+  void add(uint32_t us, bool timed_out) {
+    count++;
+    if (timed_out) { timeouts++; }
+    if (us < min_us) { min_us = us; }
+    if (us > max_us) { max_us = us; }
+    total_us += us;
+    uint8_t  i     = 0;
+    uint32_t limit = 256;
+    while (i < TINY_GSM_STATS_BUCKETS - 1 && us >= limit) {
+      i++;
+      limit <<= 1;
+    }
+    if (buckets[i] < 0xFFFF) { buckets[i]++; }
+  }
+
+  uint32_t avgMicros() const {
+    return count ? total_us / count : 0;
+  }
+
+  // The time 99% of the commands took less than, to the histogram bucket
+  uint32_t p99Micros() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < TINY_GSM_STATS_BUCKETS; i++) {
+      total += buckets[i];
+    }
+    uint32_t seen  = 0;
+    uint32_t limit = 256;
+    for (uint8_t i = 0; i < TINY_GSM_STATS_BUCKETS - 1; i++, limit <<= 1) {
+      seen += buckets[i];
+      if (seen * 100 >= total * 99) { break; }
+    }
+    return limit < max_us ? limit : max_us;
+  }
+};
+
+// Takes the name of a command as it is printed: everything up to the first
+// '=', '?' or ','
+class TinyGsmStatsKey : public Print {
+ public:
+  TinyGsmStatsKey() : len(0), done(false) {
+    key[0] = '\0';
+  }
+
+  size_t write(uint8_t c) override {
+    if (c == '=' || c == '?' || c == ',' || c == '\r' || c == '\n') {
+      done = true;
+    }
+    if (!done && len < TINY_GSM_STATS_KEY_LEN - 1) {
+      key[len++] = c;
+      key[len]   = '\0';
+    }
+    return 1;
+  }
+
+  char    key[TINY_GSM_STATS_KEY_LEN];
+  uint8_t len;
+  bool    done;
+};
+
+class TinyGsmStats : public Printable {
+ public:
+  TinyGsmStats() {
+    reset();
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < TINY_GSM_STATS_COMMANDS; i++) { cmds[i].clear(); }
+    used            = 0;
+    open            = false;
+    parsed_bytes    = 0;
+    payload_bytes   = 0;
+    unhandled_bytes = 0;
+    yieldCounters().calls = 0;
+    yieldCounters().us    = 0;
+  }
+
+  /*
+   * Results
+   */
+  // The commands seen, in the order they were first sent.  A command is
+  // counted once the next one is sent.
+  uint8_t commandCount() const {
+    return used;
+  }
+  const TinyGsmCommandStats& command(uint8_t i) const {
+    return cmds[i < used ? i : 0];
+  }
+  // Bytes read from the modem by waitResponse() and the parsing helpers
+  uint32_t parsedBytes() const {
+    return parsed_bytes;
+  }
+  // Socket data moved into the clients' buffers
+  uint32_t payloadBytes() const {
+    return payload_bytes;
+  }
+  // Bytes a wait gave up on, URC's and responses no one asked for
+  uint32_t unhandledBytes() const {
+    return unhandled_bytes;
+  }
+  // TINY_GSM_YIELD() keeps one count for the whole program, as it knows
+  // nothing of the modem it yields for
+  static uint32_t yieldCalls() {
+    return yieldCounters().calls;
+  }
+  static uint32_t yieldMicros() {
+    return yieldCounters().us;
+  }
+
+  size_t printTo(Print& p) const override {
+    size_t n = p.print(GF("command        count timeouts   min ms   avg ms"
+                          "   max ms   p99 ms\r\n"));
+    for (uint8_t i = 0; i < used; i++) {
+      const TinyGsmCommandStats& c = cmds[i];
+      size_t start = n;
+      n += p.print(GF("AT"));
+      n += p.print(c.key);
+      n += pad(p, n - start, 13);
+      n += printRight(p, c.count, 7);
+      n += printRight(p, c.timeouts, 9);
+      n += printMillis(p, c.min_us);
+      n += printMillis(p, c.avgMicros());
+      n += printMillis(p, c.max_us);
+      n += printMillis(p, c.p99Micros());
+      n += p.print(GF("\r\n"));
+    }
+    n += p.print(GF("yield: "));
+    n += p.print(yieldCalls());
+    n += p.print(GF(" calls, "));
+    n += p.print(yieldMicros() / 1000);
+    n += p.print(GF(" ms; parsed: "));
+    n += p.print(parsed_bytes);
+    n += p.print(GF(" B; payload: "));
+    n += p.print(payload_bytes);
+    n += p.print(GF(" B; unhandled: "));
+    n += p.print(unhandled_bytes);
+    n += p.print(GF(" B\r\n"));
+    return n;
+  }
+
+  /*
+   * Recording, called by the library
+   */
+  template <typename... Args>
+  void beginCommand(Args... cmd) {
+    TinyGsmStatsKey name;
+    printAll(name, cmd...);
+    endCommand();
+    current    = find(name.key);
+    start_us   = TINY_GSM_MICROS();
+    end_us     = start_us;
+    open       = true;
+    responded  = false;
+    timed_out  = false;
+  }
+
+  // The end of a wait for a reply, index 0 if it timed out
+  void response(int8_t index, bool expected) {
+    if (!open || !expected) { return; }
+    end_us    = TINY_GSM_MICROS();
+    responded = true;
+    if (!index) { timed_out = true; }
+  }
+
+  void parsed(uint32_t bytes) {
+    parsed_bytes += bytes;
+  }
+  void payload(uint32_t bytes) {
+    payload_bytes += bytes;
+  }
+  void unhandled(uint32_t bytes) {
+    unhandled_bytes += bytes;
+  }
+
+  static void yielded(uint32_t us) {
+    yieldCounters().calls++;
+    yieldCounters().us += us;
+  }
+
+ protected:
+  struct YieldCounters {
+    uint32_t calls;
+    uint32_t us;
+  };
+
+  static YieldCounters& yieldCounters() {
+    static YieldCounters counters;
+    return counters;
+  }
+
+  // Counts the command that was open, if it was waited for
+  void endCommand() {
+    if (open && responded) {
+      cmds[current].add(end_us - start_us, timed_out);
+    }
+    open = false;
+  }
+
+  uint8_t find(const char* key) {
+    for (uint8_t i = 0; i < used; i++) {
+      if (!strcmp(cmds[i].key, key)) { return i; }
+    }
+    if (used < TINY_GSM_STATS_COMMANDS - 1) {
+      strcpy(cmds[used].key, key);
+      return used++;
+    }
+    // Out of room, the rest share the last entry
+    if (used < TINY_GSM_STATS_COMMANDS) {
+      strcpy(cmds[used].key, "*");
+      used++;
+    }
+    return TINY_GSM_STATS_COMMANDS - 1;
+  }
+
+  static void printAll(Print&) {}
+
+  template <typename T, typename... Args>
+  static void printAll(Print& p, T head, Args... tail) {
+    p.print(head);
+    printAll(p, tail...);
+  }
+
+  static size_t pad(Print& p, size_t written, size_t width) {
+    size_t n = 0;
+    while (written + n < width) { n += p.print(' '); }
+    return n;
+  }
+
+  static size_t printRight(Print& p, uint32_t value, size_t width) {
+    char buf[11];
+    snprintf(buf, sizeof(buf), "%lu", static_cast<unsigned long>(value));
+    size_t n = pad(p, strlen(buf), width);
+    return n + p.print(buf);
+  }
+
+  // As ms with three decimals, right aligned in 9 columns
+  static size_t printMillis(Print& p, uint32_t us) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%lu.%03lu",
+             static_cast<unsigned long>(us / 1000),
+             static_cast<unsigned long>(us % 1000));
+    size_t n = pad(p, strlen(buf), 9);
+    return n + p.print(buf);
+  }
+
+  TinyGsmCommandStats cmds[TINY_GSM_STATS_COMMANDS];
+  uint8_t             used;
+
+  bool     open;       // A command was sent and not counted yet
+  bool     responded;  // It was waited for
+  bool     timed_out;  // One of the waits timed out
+  uint8_t  current;    // Its entry
+  uint32_t start_us;
+  uint32_t end_us;
+
+  uint32_t parsed_bytes;
+  uint32_t payload_bytes;
+  uint32_t unhandled_bytes;
+};
+
+#endif  // SRC_TINYGSMSTATS_H_
@@ -11,7 +11,12 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(TCP)
 #define TINY_GSM_MODEM_HAS_TCP
+#endif
+// The modules that implement them also define TINY_GSM_MODEM_HAS_SERVER
+// (GsmServer), TINY_GSM_MODEM_HAS_KEEPALIVE (setKeepAlive()) and
+// TINY_GSM_MODEM_HAS_DNS (getHostByName())
 
 #include "TinyGsmFifo.h"
 
@@ -19,6 +24,47 @@
 #define TINY_GSM_RX_BUFFER 64
 #endif
 
+// Number of resolved host names to remember; 0 disables the DNS cache
+#if !defined(TINY_GSM_DNS_CACHE_SIZE)
+#define TINY_GSM_DNS_CACHE_SIZE 0
+#endif
+
+// Seconds a resolved address is reused before asking the modem again, at
+// most; a module that reports the lookup's own TTL may shorten it
+#if !defined(TINY_GSM_DNS_TTL)
+#define TINY_GSM_DNS_TTL 300
+#endif
+
+// Room for a host name in the DNS cache, with its terminator; longer names
+// are looked up every time
+#if !defined(TINY_GSM_DNS_HOST_LEN)
+#define TINY_GSM_DNS_HOST_LEN 40
+#endif
+
+// Seconds a failed lookup is remembered before trying the host again
+#if !defined(TINY_GSM_DNS_NEGATIVE_TTL)
+#define TINY_GSM_DNS_NEGATIVE_TTL 30
+#endif
+
+// Milliseconds connected() trusts the socket state kept by the close URC's
+// before asking the module again, on modules without a readable buffer size
+#if !defined(TINY_GSM_CONNECTED_MAX_AGE)
+#define TINY_GSM_CONNECTED_MAX_AGE 1000
+#endif
+
+// Bytes maintain() moves from the module's buffer into each socket's FIFO per
+// call, serving sockets by priority and taking turns within a priority; 0
+// leaves all reads to the clients
+#if !defined(TINY_GSM_READ_BUDGET)
+#define TINY_GSM_READ_BUDGET 0
+#endif
+
+// One buffer of a scatter-gather write, laid out like the POSIX struct iovec
+struct TinyGsmIoVec {
+  const void* iov_base;
+  size_t      iov_len;
+};
+
 // Because of the ordering of resolution of overrides in templates, these need
 // to be written out every time.  This macro is to shorten that.
 #define TINY_GSM_CLIENT_CONNECT_OVERRIDES                             \
@@ -48,9 +94,25 @@ class TinyGsmTCP {
    * Basic functions
    */
   void maintain() {
+    TINY_GSM_STACK_CALL("maintain");
     return thisModem().maintainImpl();
   }
 
+  /*
+   * DNS functions
+   */
+  // Resolves a host name to an IPv4 address using the module's own resolver
+  bool getHostByName(const char* host, IPAddress& ip,
+                     uint32_t timeout_ms = 30000L) {
+    TINY_GSM_STACK_CALL("getHostByName");
+    return thisModem().getHostByNameImpl(host, ip, timeout_ms);
+  }
+  void clearDnsCache() {
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+    memset(dnsCache, 0, sizeof(dnsCache));
+#endif
+  }
+
   /*
    * CRTP Helper
    */
@@ -108,6 +170,7 @@ class TinyGsmTCP {
 
     // Writes data out on the client using the modem send functionality
     size_t write(const uint8_t* buf, size_t size) override {
+      TINY_GSM_STACK_CALL("write");
       TINY_GSM_YIELD();
       at->maintain();
       return at->modemSend(buf, size, mux);
@@ -122,7 +185,18 @@ class TinyGsmTCP {
       return write((const uint8_t*)str, strlen(str));
     }
 
+    // Writes several buffers in a single send on modules that support it, so
+    // a protocol header and its payload don't each need their own
+    // send transaction or a copy into one buffer
+    size_t writev(const TinyGsmIoVec* iov, uint8_t count) {
+      TINY_GSM_STACK_CALL("writev");
+      TINY_GSM_YIELD();
+      at->maintain();
+      return at->modemSendv(iov, count, mux);
+    }
+
     int available() override {
+      TINY_GSM_STACK_CALL("available");
       TINY_GSM_YIELD();
 #if defined TINY_GSM_NO_MODEM_BUFFER
       // Returns the number of characters available in the TinyGSM fifo
@@ -140,11 +214,11 @@ class TinyGsmTCP {
       // fifo and the modem chips internal fifo, doing an extra check-in
       // with the modem to see if anything has arrived without a UURC.
       if (!rx.size()) {
-        if (millis() - prev_check > 500) {
+        if (TINY_GSM_MILLIS() - prev_check > 500) {
           // setting got_data to true will tell maintain to run
           // modemGetAvailable(mux)
           got_data   = true;
-          prev_check = millis();
+          prev_check = TINY_GSM_MILLIS();
         }
         at->maintain();
       }
@@ -156,14 +230,15 @@ class TinyGsmTCP {
     }
 
     int read(uint8_t* buf, size_t size) override {
+      TINY_GSM_STACK_CALL("read");
       TINY_GSM_YIELD();
       size_t cnt = 0;
 
 #if defined TINY_GSM_NO_MODEM_BUFFER
       // Reads characters out of the TinyGSM fifo, waiting for any URC's
       // from the modem for new data if there's nothing in the fifo.
-      uint32_t _startMillis = millis();
-      while (cnt < size && millis() - _startMillis < _timeout) {
+      uint32_t _startMillis = TINY_GSM_MILLIS();
+      while (cnt < size && TINY_GSM_MILLIS() - _startMillis < _timeout) {
         size_t chunk = TinyGsmMin(size - cnt, rx.size());
         if (chunk > 0) {
           rx.get(buf, chunk);
@@ -212,11 +287,11 @@ class TinyGsmTCP {
           continue;
         }
         // Workaround: Some modules "forget" to notify about data arrival
-        if (millis() - prev_check > 500) {
+        if (TINY_GSM_MILLIS() - prev_check > 500) {
           // setting got_data to true will tell maintain to run
           // modemGetAvailable()
           got_data   = true;
-          prev_check = millis();
+          prev_check = TINY_GSM_MILLIS();
         }
         // TODO(vshymanskyy): Read directly into user buffer?
         at->maintain();
@@ -236,20 +311,133 @@ class TinyGsmTCP {
     }
 
     int read() override {
+      TINY_GSM_STACK_CALL("read");
       uint8_t c;
+      // Stream::timedRead() and the parse functions come here for every
+      // character, so skip the trip to the modem while the FIFO has data
+      if (rx.get(&c)) { return c; }
       if (read(&c, 1) == 1) { return c; }
       return -1;
     }
 
-	int peek() override {
-		return (uint8_t)rx.peek();
-	}
+    int peek() override {
+      if (!rx.size()) { fillFifo(); }
+      if (!rx.size()) { return -1; }
+      return rx.peek();
+    }
+
+    // These hide the Stream functions of the same name, which would call
+    // read() for each character.  They scan the FIFO directly and only ask
+    // the modem for more data once it is empty.  Like the Stream versions,
+    // they give up once no new data has come in for the Stream timeout.
+    size_t readBytes(char* buffer, size_t length) {
+      size_t cnt = 0;
+      while (cnt < length && waitForFifo()) {
+        cnt += rx.get(reinterpret_cast<uint8_t*>(buffer) + cnt,
+                      TinyGsmMin(length - cnt, rx.size()));
+      }
+      return cnt;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) {
+      return readBytes(reinterpret_cast<char*>(buffer), length);
+    }
+
+    // The terminator is dropped and not copied into the buffer
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+      size_t cnt = 0;
+      while (cnt < length && waitForFifo()) {
+        size_t want = length - cnt;
+        int    end  = rx.indexOf(terminator);
+        if (end >= 0 && static_cast<size_t>(end) < want) {
+          cnt += rx.get(reinterpret_cast<uint8_t*>(buffer) + cnt, end);
+          rx.skip(1);
+          break;
+        }
+        cnt += rx.get(reinterpret_cast<uint8_t*>(buffer) + cnt,
+                      TinyGsmMin(want, rx.size()));
+      }
+      return cnt;
+    }
+    size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+      return readBytesUntil(terminator, reinterpret_cast<char*>(buffer),
+                            length);
+    }
+
+    String readString() {
+      String  ret;
+      uint8_t c;
+      while (waitForFifo()) {
+        while (rx.get(&c)) { ret += static_cast<char>(c); }
+      }
+      return ret;
+    }
+
+    // The terminator is dropped and not added to the string
+    String readStringUntil(char terminator) {
+      String  ret;
+      uint8_t c;
+      while (waitForFifo()) {
+        int end = rx.indexOf(terminator);
+        int cnt = end >= 0 ? end : rx.size();
+        ret.reserve(ret.length() + cnt);
+        while (cnt-- > 0 && rx.get(&c)) { ret += static_cast<char>(c); }
+        if (end >= 0) {
+          rx.skip(1);
+          break;
+        }
+      }
+      return ret;
+    }
+
+    // Reads until the target is found, returns false on a time-out
+    bool find(const char* target, size_t length) {
+      if (length == 0) { return true; }
+      size_t  matched = 0;
+      uint8_t c;
+      while (waitForFifo()) {
+        if (matched == 0) {
+          // jump straight to the next possible start of a match
+          int start = rx.indexOf(target[0]);
+          if (start < 0) {
+            rx.skip(rx.size());
+            continue;
+          }
+          rx.skip(start);
+        }
+        rx.get(&c);
+        if (static_cast<char>(c) == target[matched]) {
+          if (++matched == length) { return true; }
+          continue;
+        }
+        // Fall back to the longest start of the target that ends with c
+        size_t k = matched;
+        while (k > 0 && (target[k - 1] != static_cast<char>(c) ||
+                         memcmp(target, target + matched - k + 1, k - 1))) {
+          k--;
+        }
+        matched = k;
+      }
+      return false;
+    }
+    bool find(const uint8_t* target, size_t length) {
+      return find(reinterpret_cast<const char*>(target), length);
+    }
+    bool find(const char* target) {
+      return find(target, strlen(target));
+    }
+    bool find(const uint8_t* target) {
+      return find(reinterpret_cast<const char*>(target));
+    }
+    bool find(char target) {
+      return find(&target, 1);
+    }
 
     void flush() override {
       at->stream.flush();
     }
 
     uint8_t connected() override {
+      TINY_GSM_STACK_CALL("connected");
       if (available()) { return true; }
 #if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
       // If the modem is one where we can read and check the size of the buffer,
@@ -262,8 +450,16 @@ class TinyGsmTCP {
 #elif defined TINY_GSM_NO_MODEM_BUFFER || defined TINY_GSM_BUFFER_READ_NO_CHECK
       // If the modem doesn't have an internal buffer, or if we can't check how
       // many characters are in the buffer then the cascade won't happen.
-      // We need to call modemGetConnected to check the sock state.
-      return at->modemGetConnected(mux);
+      // The close URC's still clear sock_connected as they arrive, so we only
+      // call modemGetConnected to check the sock state once that is older
+      // than TINY_GSM_CONNECTED_MAX_AGE.
+      if (!sock_connected) { return false; }
+      if (TINY_GSM_MILLIS() - prev_check < TINY_GSM_CONNECTED_MAX_AGE) {
+        return true;
+      }
+      prev_check     = TINY_GSM_MILLIS();
+      sock_connected = at->modemGetConnected(mux);
+      return sock_connected;
 #else
 #error Modem client has been incorrectly created
 #endif
@@ -278,19 +474,89 @@ class TinyGsmTCP {
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
 
+    // Closes the socket without first reading out the data left in the
+    // module's buffer, which the module then throws away.  Modules that can
+    // drop a connection without waiting for the remote end to agree do so
+    // (BG96), the others close it as stop() does.
+    void abort() {
+      sock_available = 0;
+      rx.clear();
+      if (!at->modemAbort(mux)) { stop(); }
+    }
+
+    // Whether stop() (and so also connect()) reads out and discards the data
+    // left in the module's buffer before closing the socket.  Turning this
+    // off skips the read out, as abort() does, but the socket is still
+    // closed the way stop() closes it.
+    void setDrainOnStop(bool drain) {
+      drain_on_stop = drain;
+    }
+
+    // Sockets with a higher priority have their data fetched first when
+    // maintain() runs with a TINY_GSM_READ_BUDGET
+    void setPriority(uint8_t priority) {
+      this->priority = priority;
+    }
+
+    // Sends TCP keepalive probes after idle_s seconds without traffic, then
+    // every interval_s seconds, dropping the connection once count probes go
+    // unanswered.  An idle_s of 0 turns keepalive off.  The settings are sent
+    // to the module on every following connect() and, if the socket is open,
+    // right away.  Modules where keepalive is a module-wide setting only
+    // apply it to connections opened afterwards.
+    bool setKeepAlive(uint16_t idle_s, uint16_t interval_s = 75,
+                      uint8_t count = 9) {
+      keep_alive_idle     = idle_s;
+      keep_alive_interval = interval_s;
+      keep_alive_count    = count;
+      if (!sock_connected) { return true; }
+      return at->modemSetKeepAlive(mux, idle_s, interval_s, count);
+    }
+
    protected:
+    // Tries once to get more data into the FIFO, without removing anything
+    inline void fillFifo() {
+      // available() checks in with the modem, which is also what moves the
+      // data of modules without a buffer into the FIFO
+      available();
+#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE || \
+    defined TINY_GSM_BUFFER_READ_NO_CHECK
+      if (!rx.size() && sock_available > 0) {
+        at->modemRead(TinyGsmMin((uint16_t)rx.free(), sock_available), mux);
+      }
+#endif
+    }
+
+    // Waits for data in the FIFO for up to the Stream timeout; gives up right
+    // away if the socket is closed and there is nothing left to read
+    inline bool waitForFifo() {
+      uint32_t startMillis = TINY_GSM_MILLIS();
+      while (!rx.size()) {
+        fillFifo();
+        if (rx.size()) { break; }
+        if (!sock_connected || TINY_GSM_MILLIS() - startMillis >= _timeout) {
+          return false;
+        }
+        TINY_GSM_YIELD();
+      }
+      return true;
+    }
+
     // Read and dump anything remaining in the modem's internal buffer.
     // Using this in the client stop() function.
     // The socket will appear open in response to connected() even after it
     // closes until all data is read from the buffer.
     // Doing it this way allows the external mcu to find and get all of the
     // data that it wants from the socket even if it was closed externally.
+    // Skipped if setDrainOnStop(false), the module discards the data then.
     inline void dumpModemBuffer(uint32_t maxWaitMs) {
 #if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE || \
     defined TINY_GSM_BUFFER_READ_NO_CHECK
       TINY_GSM_YIELD();
-      uint32_t startMillis = millis();
-      while (sock_available > 0 && (millis() - startMillis < maxWaitMs)) {
+      if (!drain_on_stop) { sock_available = 0; }
+      uint32_t startMillis = TINY_GSM_MILLIS();
+      while (sock_available > 0 &&
+             (TINY_GSM_MILLIS() - startMillis < maxWaitMs)) {
         rx.clear();
         at->modemRead(TinyGsmMin((uint16_t)rx.free(), sock_available), mux);
       }
@@ -313,8 +579,103 @@ class TinyGsmTCP {
     bool       sock_connected;
     bool       got_data;
     RxFifo     rx;
+    uint16_t   keep_alive_idle     = 0;
+    uint16_t   keep_alive_interval = 0;
+    uint8_t    keep_alive_count    = 0;
+    uint8_t    priority            = 0;
+    bool       drain_on_stop       = true;
   };
 
+  /*
+   * Inner Server
+   */
+ public:
+  class GsmServer {
+    // Make all classes created from the modem template friends
+    friend class TinyGsmTCP<modemType, muxCount>;
+
+   public:
+    GsmServer() {}
+
+    // The server number picks the listening socket on modules that can run
+    // more than one server
+    GsmServer(modemType& modem, uint16_t port, uint8_t server = 0) {
+      init(&modem, port, server);
+    }
+
+    bool init(modemType* modem, uint16_t port, uint8_t server = 0) {
+      this->at        = modem;
+      this->port      = port;
+      this->server    = server;
+      this->listening = false;
+      return true;
+    }
+
+   public:
+    // Starts listening for incoming connections on the port
+    bool begin() {
+      end();
+      TINY_GSM_YIELD();
+      listening = at->modemListen(port, server);
+      return listening;
+    }
+
+    void end() {
+      TINY_GSM_YIELD();
+      if (listening) { at->modemStopListen(port, server); }
+      listening = false;
+    }
+
+    // Whether a connection is waiting to be accepted
+    bool hasClient() {
+      if (!listening) { return false; }
+      at->maintain();
+      return at->acceptPending != 0;
+    }
+
+    // Binds the next waiting connection to the client, which takes over the
+    // connection number the module gave it.  The connection numbers are
+    // handed out by the module, so clients created with a fixed mux must not
+    // be kept on a number the module could give to an incoming connection.
+    template <class clientType>
+    bool accept(clientType& client) {
+      if (!hasClient()) { return false; }
+      for (uint8_t mux = 0; mux < muxCount; mux++) {
+        if (!(at->acceptPending & (1U << mux))) { continue; }
+        at->acceptPending &= ~(1U << mux);
+        client.init(at, mux);
+        GsmClient& sock     = client;
+        sock.sock_connected = true;
+        sock.got_data       = true;  // look for data that came in already
+        sock.prev_check     = TINY_GSM_MILLIS();
+        return true;
+      }
+      return false;
+    }
+
+    uint16_t localPort() {
+      return port;
+    }
+
+    operator bool() {
+      return listening;
+    }
+
+   protected:
+    modemType* at;
+    uint16_t   port;
+    uint8_t    server;
+    bool       listening;
+  };
+
+  /*
+   * Constructor
+   */
+ protected:
+  TinyGsmTCP() : readNext(0), acceptPending(0) {
+    clearDnsCache();
+  }
+
   /*
    * Basic functions
    */
@@ -323,6 +684,76 @@ class TinyGsmTCP {
 #if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
     // Keep listening for modem URC's and proactively iterate through
     // sockets asking if any data is avaiable
+    thisModem().modemPollSockets();
+    while (thisModem().stream.available()) {
+      thisModem().waitResponse(15, NULL, NULL);
+    }
+#if TINY_GSM_READ_BUDGET > 0
+    fetchSocketData();
+#endif
+
+#elif defined TINY_GSM_BUFFER_READ_NO_CHECK
+    // Listen for any URC's
+    thisModem().waitResponse(100, NULL, NULL);
+#if TINY_GSM_READ_BUDGET > 0
+    fetchSocketData();
+#endif
+
+#elif defined TINY_GSM_NO_MODEM_BUFFER
+    // Just listen for any URC's
+    thisModem().waitResponse(100, NULL, NULL);
+
+#else
+#error Modem client has been incorrectly created
+#endif
+  }
+
+#if (defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE || \
+     defined TINY_GSM_BUFFER_READ_NO_CHECK) &&        \
+    TINY_GSM_READ_BUDGET > 0
+  // Moves data waiting in the module into the socket FIFOs, so a busy socket
+  // can't hold up the others.  The highest priority sockets go first, sockets
+  // of the same priority take turns at going first, and each socket gets at
+  // most TINY_GSM_READ_BUDGET bytes per call.
+  void fetchSocketData() {
+    int16_t served = 256;  // above any priority
+    for (;;) {
+      // Find the next lower priority with a socket that has data waiting
+      int16_t level = -1;
+      for (int mux = 0; mux < muxCount; mux++) {
+        GsmClient* sock = thisModem().sockets[mux];
+        if (sock && sock->sock_available > 0 && sock->rx.free() > 0 &&
+            sock->priority < served && sock->priority > level) {
+          level = sock->priority;
+        }
+      }
+      if (level < 0) { break; }
+
+      for (int i = 0; i < muxCount; i++) {
+        uint8_t    mux  = (readNext + i) % muxCount;
+        GsmClient* sock = thisModem().sockets[mux];
+        if (!sock || sock->priority != level) { continue; }
+        uint16_t budget = TINY_GSM_READ_BUDGET;
+        while (budget > 0 && sock->sock_available > 0 && sock->rx.free() > 0) {
+          uint16_t chunk = TinyGsmMin(
+              TinyGsmMin(budget, (uint16_t)sock->rx.free()),
+              sock->sock_available);
+          size_t n = thisModem().modemRead(chunk, mux);
+          if (n == 0) { break; }
+          budget -= TinyGsmMin(budget, (uint16_t)n);
+        }
+      }
+      served = level;
+    }
+    readNext = (readNext + 1) % muxCount;
+  }
+#endif
+
+#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+  // Updates sock_available and sock_connected for every socket flagged with
+  // got_data, one socket at a time.  Modules that can report on all of their
+  // sockets in a single command replace this with a bulk snapshot.
+  void modemPollSockets() {
     for (int mux = 0; mux < muxCount; mux++) {
       GsmClient* sock = thisModem().sockets[mux];
       if (sock && sock->got_data) {
@@ -330,35 +761,207 @@ class TinyGsmTCP {
         sock->sock_available = thisModem().modemGetAvailable(mux);
       }
     }
-    while (thisModem().stream.available()) {
-      thisModem().waitResponse(15, NULL, NULL);
+  }
+#endif
+
+  // Moves len bytes of socket data from the stream straight into the free
+  // space of the mux FIFO, waiting up to the socket's time-out for them;
+  // returns the bytes read.  What doesn't fit in the FIFO is read and dropped.
+  size_t moveStreamToFifo(uint8_t mux, size_t len) {
+    GsmClient* sock = thisModem().sockets[mux];
+    if (!sock) return 0;
+    size_t moved = 0;
+    while (moved < len) {
+      int      room;
+      uint8_t* dst  = sock->rx.reserve(room);
+      size_t   want = len - moved;
+      if (room > 0) {
+        want = TinyGsmMin(want, static_cast<size_t>(room));
+      } else {
+        dst = NULL;
+      }
+      size_t got = thisModem().streamGetPayload(dst, want, sock->_timeout);
+      if (dst) { sock->rx.commit(got); }
+      moved += got;
+      if (got < want) { break; }
     }
+    return moved;
+  }
 
-#elif defined TINY_GSM_NO_MODEM_BUFFER || defined TINY_GSM_BUFFER_READ_NO_CHECK
-    // Just listen for any URC's
-    thisModem().waitResponse(100, NULL, NULL);
+  // Sends the buffers one by one, modules that can take them all after a
+  // single send command override this
+  int16_t modemSendv(const TinyGsmIoVec* iov, uint8_t count, uint8_t mux) {
+    int16_t sent = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      int16_t n = thisModem().modemSend(iov[i].iov_base, iov[i].iov_len, mux);
+      sent += n;
+      if (n < static_cast<int16_t>(iov[i].iov_len)) { break; }
+    }
+    return sent;
+  }
+
+  static size_t ioVecLength(const TinyGsmIoVec* iov, uint8_t count) {
+    size_t len = 0;
+    for (uint8_t i = 0; i < count; i++) { len += iov[i].iov_len; }
+    return len;
+  }
+
+  // Writes out all of the buffers, once the module has asked for the data
+  void streamWriteIoVec(const TinyGsmIoVec* iov, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+      thisModem().stream.write(
+          reinterpret_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    thisModem().stream.flush();
+  }
+
+  // Closes a socket at once, without waiting for the remote end; false if
+  // the module can't, and the socket is to be closed with stop()
+  bool modemAbort(uint8_t) {
+    return false;
+  }
+
+  // Overridden by the modules with a native TCP keepalive
+  bool modemSetKeepAlive(uint8_t mux, uint16_t idle_s, uint16_t interval_s,
+                         uint8_t count) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+
+  /*
+   * Server functions
+   */
+ protected:
+  // Overridden by the modules that can accept incoming connections
+  bool modemListen(uint16_t port, uint8_t server) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  void modemStopListen(uint16_t port,
+                       uint8_t server) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+
+  // Called from the modules' incoming connection URC's, the connection then
+  // waits for GsmServer::accept()
+  void modemIncoming(int8_t mux) {
+    if (mux >= 0 && mux < muxCount) { acceptPending |= (1U << mux); }
+  }
+
+  /*
+   * DNS functions
+   */
+ protected:
+  bool getHostByNameImpl(const char* host, IPAddress& ip,
+                         uint32_t timeout_ms = 30000L) {
+    if (ip.fromString(host)) { return true; }  // already an address
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+    DnsCacheSlot* entry = dnsCacheFind(host);
+    if (entry) {
+      ip = entry->address;
+      return entry->address != 0;
+    }
+#endif
+    uint32_t ttl_s    = TINY_GSM_DNS_TTL;
+    bool     resolved = thisModem().modemResolveHost(host, ip, timeout_ms,
+                                                     ttl_s);
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+    // Failed lookups are stored too, with an address of 0
+    if (resolved) {
+      dnsCacheStore(host, ip, TinyGsmMin(ttl_s, (uint32_t)TINY_GSM_DNS_TTL));
+    } else {
+      dnsCacheStore(host, 0, TINY_GSM_DNS_NEGATIVE_TTL);
+    }
+#else
+    (void)ttl_s;
+#endif
+    return resolved;
+  }
 
+  // Resolves host; a module that reports how long the answer holds sets
+  // ttl_s, which otherwise stays TINY_GSM_DNS_TTL
+  bool modemResolveHost(const char* host, IPAddress& ip, uint32_t timeout_ms,
+                        uint32_t& ttl_s) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+
+  // Picks what to hand the module's open command for a host.  With the cache
+  // enabled this is the host's cached (or freshly resolved) address, so the
+  // module doesn't repeat the DNS lookup on every reconnect, and the time the
+  // lookup took is taken off timeout_ms, leaving the connect what is left.
+  // Returns NULL if the host is known not to resolve or there's no time left.
+  const char* dnsConnectTarget(const char* host, String& address,
+                               uint32_t& timeout_ms) {
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+    IPAddress ip;
+    uint32_t  startMillis = TINY_GSM_MILLIS();
+    if (!getHostByNameImpl(host, ip, timeout_ms)) { return NULL; }
+    uint32_t spent = TINY_GSM_MILLIS() - startMillis;
+    if (spent >= timeout_ms) { return NULL; }
+    timeout_ms -= spent;
+    address = GsmClient::TinyGsmStringFromIp(ip);
+    return address.c_str();
 #else
-#error Modem client has been incorrectly created
+    (void)address;
+    (void)timeout_ms;
+    return host;
 #endif
   }
 
-  // Yields up to a time-out period and then reads a character from the stream
-  // into the mux FIFO
-  // TODO(SRGDamia1):  Do we need to wait two _timeout periods for no
-  // character return?  Will wait once in the first "while
-  // !stream.available()" and then will wait again in the stream.read()
-  // function.
-  inline void moveCharFromStreamToFifo(uint8_t mux) {
-    if (!thisModem().sockets[mux]) return;
-    uint32_t startMillis = millis();
-    while (!thisModem().stream.available() &&
-           (millis() - startMillis < thisModem().sockets[mux]->_timeout)) {
-      TINY_GSM_YIELD();
+  // Drops a host's cached address, ie after a connection to it failed
+  void dnsCacheRemove(const char* host) {
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+    DnsCacheSlot* entry = dnsCacheFind(host);
+    if (entry) { entry->used = false; }
+#else
+    (void)host;
+#endif
+  }
+
+#if TINY_GSM_DNS_CACHE_SIZE > 0
+  struct DnsCacheSlot {
+    char     host[TINY_GSM_DNS_HOST_LEN];  // The host name as looked up
+    uint32_t address;    // resolved address, 0 for a failed lookup
+    uint32_t stored_at;  // TINY_GSM_MILLIS() when the lookup was made
+    uint32_t ttl_ms;     // How long from then it holds
+    bool     used;
+  };
+
+  // Host names are case insensitive
+  static bool dnsHostMatches(const char* cached, const char* host) {
+    while (*cached && tolower(*cached) == tolower(*host)) {
+      cached++;
+      host++;
+    }
+    return *cached == *host;
+  }
+
+  DnsCacheSlot* dnsCacheFind(const char* host) {
+    for (uint8_t i = 0; i < TINY_GSM_DNS_CACHE_SIZE; i++) {
+      DnsCacheSlot* entry = &dnsCache[i];
+      if (!entry->used || !dnsHostMatches(entry->host, host)) { continue; }
+      if (TINY_GSM_MILLIS() - entry->stored_at < entry->ttl_ms) {
+        return entry;
+      }
+      entry->used = false;  // expired
+      return NULL;
+    }
+    return NULL;
+  }
+
+  void dnsCacheStore(const char* host, uint32_t address, uint32_t ttl_s) {
+    if (strlen(host) >= TINY_GSM_DNS_HOST_LEN || ttl_s == 0) { return; }
+    // Take a free slot if there is one, otherwise evict the oldest lookup
+    DnsCacheSlot* slot = &dnsCache[0];
+    uint32_t      now  = TINY_GSM_MILLIS();
+    for (uint8_t i = 0; i < TINY_GSM_DNS_CACHE_SIZE && slot->used; i++) {
+      DnsCacheSlot* entry = &dnsCache[i];
+      if (!entry->used || now - entry->stored_at > now - slot->stored_at) {
+        slot = entry;
+      }
     }
-    char c = thisModem().stream.read();
-    thisModem().sockets[mux]->rx.put(c);
+    strcpy(slot->host, host);
+    slot->address   = address;
+    slot->stored_at = now;
+    slot->ttl_ms    = 1000UL * ttl_s;
+    slot->used      = true;
   }
+
+  DnsCacheSlot dnsCache[TINY_GSM_DNS_CACHE_SIZE];
+#endif
+
+  uint8_t  readNext;       // Socket fetchSocketData() serves first next time
+  uint16_t acceptPending;  // Connections waiting for accept(), a bit per mux
 };
 
 #endif  // SRC_TINYGSMTCP_H_
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(TEMPERATURE)
 #define TINY_GSM_MODEM_HAS_TEMPERATURE
+#endif
 
 template <class modemType>
 class TinyGsmTemperature {
@@ -20,6 +22,7 @@ class TinyGsmTemperature {
    * Temperature functions
    */
   float getTemperature() {
+    TINY_GSM_STACK_CALL("getTemperature");
     return thisModem().getTemperatureImpl();
   }
 
@@ -11,7 +11,9 @@
 
 #include "TinyGsmCommon.h"
 
+#if TINY_GSM_USES(TIME)
 #define TINY_GSM_MODEM_HAS_TIME
+#endif
 
 enum TinyGSMDateTimeFormat { DATE_FULL = 0, DATE_TIME = 1, DATE_DATE = 2 };
 
@@ -22,10 +24,22 @@ class TinyGsmTime {
    * Time functions
    */
   String getGSMDateTime(TinyGSMDateTimeFormat format) {
-    return thisModem().getGSMDateTimeImpl(format);
+    TINY_GSM_STACK_CALL("getGSMDateTime");
+    String res;
+    char*  buf = TinyGsmStringBuffer(res, TINY_GSM_SHORT_STRING);
+    size_t len = buf ? getGSMDateTime(format, buf, TINY_GSM_SHORT_STRING) : 0;
+    TinyGsmStringEnd(res, len);
+    return res;
+  }
+  size_t getGSMDateTime(TinyGSMDateTimeFormat format, char* out, size_t cap) {
+    TINY_GSM_STACK_CALL("getGSMDateTime");
+    if (!out || !cap) { return 0; }
+    out[0] = '\0';
+    return thisModem().getGSMDateTimeImpl(format, out, cap);
   }
   bool getNetworkTime(int* year, int* month, int* day, int* hour, int* minute,
                       int* second, float* timezone) {
+    TINY_GSM_STACK_CALL("getNetworkTime");
     return thisModem().getNetworkTimeImpl(year, month, day, hour, minute,
                                           second, timezone);
   }
@@ -45,22 +59,27 @@ class TinyGsmTime {
    * Time functions
    */
  protected:
-  String getGSMDateTimeImpl(TinyGSMDateTimeFormat format) {
+  size_t getGSMDateTimeImpl(TinyGSMDateTimeFormat format, char* out,
+                            size_t cap) {
     thisModem().sendAT(GF("+CCLK?"));
-    if (thisModem().waitResponse(2000L, GF("+CCLK: \"")) != 1) { return ""; }
+    if (thisModem().waitResponse(2000L, GF("+CCLK: \"")) != 1) { return 0; }
 
-    String res;
+    size_t len = 0;
 
     switch (format) {
-      case DATE_FULL: res = thisModem().stream.readStringUntil('"'); break;
+      case DATE_FULL:
+        len = thisModem().streamGetStringBefore('"', out, cap);
+        break;
       case DATE_TIME:
         thisModem().streamSkipUntil(',');
-        res = thisModem().stream.readStringUntil('"');
+        len = thisModem().streamGetStringBefore('"', out, cap);
+        break;
+      case DATE_DATE:
+        len = thisModem().streamGetStringBefore(',', out, cap);
         break;
-      case DATE_DATE: res = thisModem().stream.readStringUntil(','); break;
     }
     thisModem().waitResponse();  // Ends with OK
-    return res;
+    return len;
   }
 
   bool getNetworkTimeImpl(int* year, int* month, int* day, int* hour,
@@ -0,0 +1,413 @@
+/**
+ * @file       TinyGsmTrace.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A deferred form of the library's debug output.  With TINY_GSM_TRACE
+ * defined, DBG() doesn't print, it stores its arguments in a ring buffer in
+ * RAM: the time, the message as a pointer to its literal, numbers as
+ * varints and the first few characters of Strings.  That takes no longer
+ * than copying a few bytes, so the AT traffic runs as it would without
+ * debugging, and the oldest messages make room for the new ones.
+ *
+ * The messages are formatted when asked for, as DBG() would have printed
+ * them,
+ *
+ *   SerialMon.print(TinyGsmTraceLog());
+ *
+ * or written out in binary, with the literals expanded, for
+ * tools/TraceDump to print on a PC:
+ *
+ *   TinyGsmTraceLog().dump(logFile);
+ *
+ * The binary form is the 8 byte magic "TGSMTRC1", followed by one record per
+ * message: the time in ms as 4 bytes little endian, the arguments, each a
+ * tag byte and its value, and a 0 tag.
+ */
+
+#ifndef SRC_TINYGSMTRACE_H_
+#define SRC_TINYGSMTRACE_H_
+
+#include "TinyGsmCommon.h"
+
+// Bytes of RAM holding the messages; each takes 6 bytes plus its arguments
+#if !defined(TINY_GSM_TRACE_SIZE)
+#define TINY_GSM_TRACE_SIZE 512
+#endif
+
+// Characters kept of a String or char buffer argument
+#if !defined(TINY_GSM_TRACE_STRING)
+#define TINY_GSM_TRACE_STRING 24
+#endif
+
+#define TINY_GSM_TRACE_MAGIC "TGSMTRC1"
+
+class TinyGsmTrace : public Printable {
+ public:
+  // What follows the tag of an argument
+  enum Tag {
+    END        = 0,  // Nothing, the record is over
+    TEXT       = 1,  // A pointer to a literal; in a dump, a STRING
+    FLASH_TEXT = 2,  // A pointer to a literal in flash; in a dump, a STRING
+    STRING     = 3,  // Its length in a byte and the characters
+    INT        = 4,  // A zigzag varint
+    UINT       = 5,  // A varint
+    CHAR       = 6,  // One byte
+    FLOAT      = 7,  // 4 bytes, as in memory
+  };
+
+  TinyGsmTrace() {
+    clear();
+  }
+
+  void clear() {
+    head    = 0;
+    used    = 0;
+    count   = 0;
+    dropped = 0;
+  }
+
+  // Messages in the buffer
+  uint16_t messages() const {
+    return count;
+  }
+  // Messages that made room for newer ones, since the last clear()
+  uint32_t droppedMessages() const {
+    return dropped;
+  }
+
+  /*
+   * Recording, what DBG() calls
+   */
+  template <typename... Args>
+  void add(const char* message, Args... args) {
+    begin();
+    putPointer(TEXT, message);
+    putAll(args...);
+    commit();
+  }
+
+  template <typename... Args>
+  void add(const __FlashStringHelper* message, Args... args) {
+    begin();
+    putPointer(FLASH_TEXT, message);
+    putAll(args...);
+    commit();
+  }
+
+  template <typename T, typename... Args>
+  void add(T first, Args... args) {
+    begin();
+    putAll(first, args...);
+    commit();
+  }
+
+  /*
+   * Output
+   */
+  // Prints the messages, oldest first, as DBG() would have
+  size_t printTo(Print& p) const override {
+    size_t n = 0;
+    if (dropped) {
+      n += p.print(GF("... "));
+      n += p.print(dropped);
+      n += p.print(GF(" older messages dropped\r\n"));
+    }
+    uint8_t  record[kRecordMax];
+    uint16_t pos = tail();
+    for (uint16_t i = 0; i < count; i++) {
+      pos = copyRecord(pos, record);
+      n += p.print('[');
+      n += p.print(readTime(record));
+      n += p.print(GF("]"));
+      for (const uint8_t* arg = record + 4; *arg != END;
+           arg += argLength(arg)) {
+        n += p.print(' ');
+        n += printArg(p, arg);
+      }
+      n += p.print(GF("\r\n"));
+    }
+    return n;
+  }
+
+  // Writes the messages in binary, for tools/TraceDump
+  size_t dump(Print& out) const {
+    size_t n =
+        out.write(reinterpret_cast<const uint8_t*>(TINY_GSM_TRACE_MAGIC), 8);
+    uint8_t  record[kRecordMax];
+    uint16_t pos = tail();
+    for (uint16_t i = 0; i < count; i++) {
+      pos = copyRecord(pos, record);
+      n += out.write(record, 4);
+      const uint8_t* arg = record + 4;
+      for (; *arg != END; arg += argLength(arg)) {
+        if (*arg == TEXT || *arg == FLASH_TEXT) {
+          n += dumpText(out, *arg, readPointer(arg));
+        } else {
+          n += out.write(arg, argLength(arg));
+        }
+      }
+      n += out.write(static_cast<uint8_t>(END));
+    }
+    return n;
+  }
+
+  // The length of an argument, with its tag
+  static size_t argLength(const uint8_t* arg) {
+    switch (*arg) {
+      case TEXT:
+      case FLASH_TEXT: return 1 + sizeof(const char*);
+      case STRING: return 2 + arg[1];
+      case INT:
+      case UINT: {
+        size_t len = 2;
+        while (arg[len - 1] & 0x80) { len++; }
+        return len;
+      }
+      case CHAR: return 2;
+      case FLOAT: return 5;
+      default: return 1;
+    }
+  }
+
+ protected:
+  // The longest record: the time, the arguments and the end tag
+  static const uint8_t kRecordMax = 64;
+
+  /*
+   * Building a record
+   */
+  void begin() {
+    uint32_t now = TINY_GSM_MILLIS();
+    for (uint8_t i = 0; i < 4; i++) { rec[i] = now >> (8 * i); }
+    rec_len = 4;
+  }
+
+  // Arguments that don't fit are left out
+  bool reserve(size_t len) {
+    return rec_len + len < kRecordMax;  // Leaves room for the end tag
+  }
+
+  void putAll() {}
+
+  template <typename T, typename... Args>
+  void putAll(T first, Args... rest) {
+    put(first);
+    putAll(rest...);
+  }
+
+  void putPointer(Tag tag, const void* text) {
+    if (!reserve(1 + sizeof(text))) { return; }
+    rec[rec_len++] = tag;
+    memcpy(rec + rec_len, &text, sizeof(text));
+    rec_len += sizeof(text);
+  }
+
+  void putString(const char* s, size_t len) {
+    if (len > TINY_GSM_TRACE_STRING) { len = TINY_GSM_TRACE_STRING; }
+    if (!reserve(2 + len)) { return; }
+    rec[rec_len++] = STRING;
+    rec[rec_len++] = len;
+    memcpy(rec + rec_len, s, len);
+    rec_len += len;
+  }
+
+  template <typename U>
+  void putVarint(Tag tag, U value) {
+    if (!reserve(1 + (sizeof(U) * 8 + 6) / 7)) { return; }
+    rec[rec_len++] = tag;
+    while (value >= 0x80) {
+      rec[rec_len++] = static_cast<uint8_t>(value | 0x80);
+      value >>= 7;
+    }
+    rec[rec_len++] = static_cast<uint8_t>(value);
+  }
+
+  template <typename S>
+  void putSigned(S value) {
+    typedef unsigned long U;
+    U v = static_cast<U>(static_cast<long>(value));
+    putVarint(INT, (v << 1) ^ (value < 0 ? ~static_cast<U>(0) : 0));
+  }
+
+  void put(const __FlashStringHelper* s) {
+    putPointer(FLASH_TEXT, s);
+  }
+  // Char buffers may not outlive the call, so they are copied
+  void put(const char* s) {
+    if (!s) { s = ""; }
+    size_t len = 0;
+    while (len < TINY_GSM_TRACE_STRING && s[len]) { len++; }
+    putString(s, len);
+  }
+  void put(const String& s) {
+    putString(s.c_str(), s.length());
+  }
+  void put(char c) {
+    if (!reserve(2)) { return; }
+    rec[rec_len++] = CHAR;
+    rec[rec_len++] = c;
+  }
+  void put(bool value) {
+    putVarint(UINT, static_cast<unsigned long>(value));
+  }
+  void put(signed char value) {
+    putSigned(value);
+  }
+  void put(short value) {
+    putSigned(value);
+  }
+  void put(int value) {
+    putSigned(value);
+  }
+  void put(long value) {
+    putSigned(value);
+  }
+  void put(unsigned char value) {
+    putVarint(UINT, static_cast<unsigned long>(value));
+  }
+  void put(unsigned short value) {
+    putVarint(UINT, static_cast<unsigned long>(value));
+  }
+  void put(unsigned int value) {
+    putVarint(UINT, static_cast<unsigned long>(value));
+  }
+  void put(unsigned long value) {
+    putVarint(UINT, value);
+  }
+  void put(double value) {
+    if (!reserve(5)) { return; }
+    float f        = value;
+    rec[rec_len++] = FLOAT;
+    memcpy(rec + rec_len, &f, 4);
+    rec_len += 4;
+  }
+
+  // Moves the record into the ring, over the oldest ones if need be
+  void commit() {
+    rec[rec_len++] = END;
+    if (rec_len + 1 > TINY_GSM_TRACE_SIZE) { return; }
+    while (TINY_GSM_TRACE_SIZE - used < rec_len + 1) {
+      uint16_t oldest = tail();
+      used -= buf[oldest] + 1;
+      count--;
+      dropped++;
+    }
+    buf[head] = rec_len;
+    head      = next(head);
+    for (uint8_t i = 0; i < rec_len; i++) {
+      buf[head] = rec[i];
+      head      = next(head);
+    }
+    used += rec_len + 1;
+    count++;
+  }
+
+  /*
+   * Reading the ring
+   */
+  static uint16_t next(uint16_t pos) {
+    return pos + 1 < TINY_GSM_TRACE_SIZE ? pos + 1 : 0;
+  }
+
+  uint16_t tail() const {
+    return head >= used ? head - used : head + TINY_GSM_TRACE_SIZE - used;
+  }
+
+  // Copies out the record at pos, returning where the next one starts
+  uint16_t copyRecord(uint16_t pos, uint8_t* record) const {
+    uint8_t len = buf[pos];
+    pos         = next(pos);
+    for (uint8_t i = 0; i < len; i++) {
+      record[i] = buf[pos];
+      pos       = next(pos);
+    }
+    return pos;
+  }
+
+  static uint32_t readTime(const uint8_t* record) {
+    return static_cast<uint32_t>(record[0]) |
+        static_cast<uint32_t>(record[1]) << 8 |
+        static_cast<uint32_t>(record[2]) << 16 |
+        static_cast<uint32_t>(record[3]) << 24;
+  }
+
+  static const char* readPointer(const uint8_t* arg) {
+    const char* text;
+    memcpy(&text, arg + 1, sizeof(text));
+    return text;
+  }
+
+  static unsigned long readVarint(const uint8_t* arg) {
+    unsigned long value = 0;
+    uint8_t       shift = 0;
+    const uint8_t* p    = arg + 1;
+    do {
+      value |= static_cast<unsigned long>(*p & 0x7F) << shift;
+      shift += 7;
+    } while (*p++ & 0x80);
+    return value;
+  }
+
+  static size_t printArg(Print& p, const uint8_t* arg) {
+    switch (*arg) {
+      case TEXT: return p.print(readPointer(arg));
+      case FLASH_TEXT:
+        return p.print(
+            reinterpret_cast<const __FlashStringHelper*>(readPointer(arg)));
+      case STRING: return p.write(arg + 2, arg[1]);
+      case INT: {
+        unsigned long v = readVarint(arg);
+        return p.print(static_cast<long>(v >> 1) ^ -static_cast<long>(v & 1));
+      }
+      case UINT: return p.print(readVarint(arg));
+      case CHAR: return p.print(static_cast<char>(arg[1]));
+      case FLOAT: {
+        float f;
+        memcpy(&f, arg + 1, 4);
+        return p.print(f);
+      }
+      default: return 0;
+    }
+  }
+
+  // A literal as a STRING, up to 255 characters of it
+  static size_t dumpText(Print& out, uint8_t tag, const char* text) {
+    uint8_t len = 0;
+    while (len < 255 && textChar(tag, text, len)) { len++; }
+    size_t n = out.write(static_cast<uint8_t>(STRING));
+    n += out.write(len);
+    for (uint8_t i = 0; i < len; i++) {
+      n += out.write(static_cast<uint8_t>(textChar(tag, text, i)));
+    }
+    return n;
+  }
+
+  static char textChar(uint8_t tag, const char* text, uint8_t i) {
+#if defined(__AVR__)
+    if (tag == FLASH_TEXT) { return pgm_read_byte(text + i); }
+#else
+    (void)tag;
+#endif
+    return text[i];
+  }
+
+  uint8_t  buf[TINY_GSM_TRACE_SIZE];
+  uint16_t head;  // Where the next record goes
+  uint16_t used;  // Bytes taken, the oldest record starts that far back
+  uint16_t count;
+  uint32_t dropped;
+
+  uint8_t rec[kRecordMax];  // The record being built
+  uint8_t rec_len;
+};
+
+// The trace all of the library's DBG() calls go to
+inline TinyGsmTrace& TinyGsmTraceLog() {
+  static TinyGsmTrace trace;
+  return trace;
+}
+
+#endif  // SRC_TINYGSMTRACE_H_
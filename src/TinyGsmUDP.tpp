@@ -0,0 +1,314 @@
+/**
+ * @file       TinyGsmUDP.tpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#ifndef SRC_TINYGSMUDP_H_
+#define SRC_TINYGSMUDP_H_
+
+#include "TinyGsmCommon.h"
+
+#if TINY_GSM_USES(UDP)
+#define TINY_GSM_MODEM_HAS_UDP
+#endif
+
+#if defined(ARDUINO_DASH)
+#include <ArduinoCompat/Udp.h>
+#else
+#include <Udp.h>
+#endif
+
+// Modules that keep received UDP as a stream without the datagrams' lengths
+// define TINY_GSM_UDP_NO_BOUNDARIES.  On them parsePacket() returns what has
+// arrived since the last read as one packet, so datagrams that come in
+// between two calls are merged; a protocol that needs the framing has to
+// carry it in the data or keep one datagram in flight at a time.
+
+// Largest datagram GsmUDP will send or receive; longer incoming datagrams are
+// truncated and longer outgoing ones are cut off at this size.  Each GsmUDP
+// takes this much RAM for the datagram being written or read, which share
+// the buffer, plus about 20 bytes and the two Strings of the peer's and the
+// sender's address.
+#if !defined(TINY_GSM_UDP_BUFFER)
+#define TINY_GSM_UDP_BUFFER 128
+#endif
+
+template <class modemType, uint8_t muxCount>
+class TinyGsmUDP {
+  /*
+   * CRTP Helper
+   */
+ protected:
+  inline const modemType& thisModem() const {
+    return static_cast<const modemType&>(*this);
+  }
+  inline modemType& thisModem() {
+    return static_cast<modemType&>(*this);
+  }
+
+  /*
+   * Inner UDP socket
+   */
+ public:
+  class GsmUDP : public UDP {
+    // Make all classes created from the modem template friends
+    friend class TinyGsmUDP<modemType, muxCount>;
+    friend modemType;
+
+   public:
+    GsmUDP() {}
+
+    // The mux is used as the socket number, so it must not be shared with a
+    // TCP client or a server; by default the last one is taken
+    explicit GsmUDP(modemType& modem, uint8_t mux = muxCount - 1) {
+      init(&modem, mux);
+    }
+
+    bool init(modemType* modem, uint8_t mux = muxCount - 1) {
+      this->at         = modem;
+      this->mux        = mux;
+      this->sock_open  = false;
+      this->local_port = 0;
+      this->tx_port    = 0;
+      this->peer_set   = false;
+      this->writing    = false;
+      this->tx_len     = 0;
+      this->rx_len     = 0;
+      this->rx_pos     = 0;
+      this->rx_port    = 0;
+      return true;
+    }
+
+   public:
+    uint8_t begin(uint16_t port) override {
+      stop();
+      TINY_GSM_YIELD();
+      local_port = port;
+      sock_open  = at->modemUdpBegin(&mux, port);
+      if (sock_open) { at->udpOpened(mux); }
+      return sock_open;
+    }
+
+    void stop() override {
+      TINY_GSM_YIELD();
+      if (sock_open) {
+        at->modemUdpStop(mux);
+        at->udpClosed(mux);
+      }
+      sock_open = false;
+      tx_host   = "";
+      tx_port   = 0;
+      peer_set  = false;
+      writing   = false;
+      tx_len    = 0;
+      rx_len    = 0;
+      rx_pos    = 0;
+    }
+
+    int beginPacket(IPAddress ip, uint16_t port) override {
+      // UDP is only built in along with TCP, see TINY_GSM_FEATURE_UDP
+      return beginPacket(
+          modemType::GsmClient::TinyGsmStringFromIp(ip).c_str(), port);
+    }
+
+    // Drops what is left unread of the last datagram received, the two share
+    // the buffer
+    int beginPacket(const char* host, uint16_t port) override {
+      if (!sock_open || host == NULL || port == 0) { return 0; }
+      // Modules that only send on a connected socket have to reconnect it
+      // when the datagram goes somewhere else than the last one
+      peer_set = peer_set && tx_port == port && tx_host == host;
+      tx_host  = host;
+      tx_port  = port;
+      writing  = true;
+      tx_len   = 0;
+      rx_len   = 0;
+      rx_pos   = 0;
+      return 1;
+    }
+
+    int endPacket() override {
+      if (!sock_open || !writing) { return 0; }
+      TINY_GSM_YIELD();
+      bool sent = at->modemUdpSend(mux, tx_host.c_str(), tx_port, buf,
+                                   tx_len, !peer_set);
+      peer_set  = sent;
+      writing   = false;
+      tx_len    = 0;
+      return sent;
+    }
+
+    size_t write(uint8_t c) override {
+      return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+      if (!writing) { return 0; }
+      size_t len = TinyGsmMin(size,
+                              static_cast<size_t>(sizeof(buf) - tx_len));
+      memcpy(buf + tx_len, data, len);
+      tx_len += len;
+      return len;
+    }
+
+    // Asks the module for a datagram only once it has said one came, and
+    // then until it has none left, so polling it costs no AT commands.
+    // Drops a datagram being written, the two share the buffer.  With
+    // TINY_GSM_UDP_NO_BOUNDARIES the packet may hold several datagrams.
+    int parsePacket() override {
+      TINY_GSM_YIELD();
+      // Whatever is left of the last datagram is dropped, as on other UDP
+      // implementations
+      rx_len  = 0;
+      rx_pos  = 0;
+      writing = false;
+      tx_len  = 0;
+      if (!sock_open || !at->udpPending(mux)) { return 0; }
+      rx_ip   = tx_host;
+      rx_port = tx_port;
+      int len = at->modemUdpReceive(mux, buf, sizeof(buf), rx_ip, rx_port);
+      if (len <= 0) {
+        at->udpDrained(mux);
+        return 0;
+      }
+      rx_len = len;
+      return rx_len;
+    }
+
+    int available() override {
+      return rx_len - rx_pos;
+    }
+
+    int read() override {
+      if (rx_pos >= rx_len) { return -1; }
+      return buf[rx_pos++];
+    }
+
+    int read(unsigned char* data, size_t size) override {
+      size_t len = TinyGsmMin(size, static_cast<size_t>(rx_len - rx_pos));
+      memcpy(data, buf + rx_pos, len);
+      rx_pos += len;
+      return len;
+    }
+
+    int read(char* data, size_t size) override {
+      return read(reinterpret_cast<unsigned char*>(data), size);
+    }
+
+    int peek() override {
+      if (rx_pos >= rx_len) { return -1; }
+      return buf[rx_pos];
+    }
+
+    void flush() override {
+      rx_len = 0;
+      rx_pos = 0;
+    }
+
+    IPAddress remoteIP() override {
+      IPAddress ip;
+      ip.fromString(rx_ip);
+      return ip;
+    }
+
+    uint16_t remotePort() override {
+      return rx_port;
+    }
+
+    uint16_t localPort() {
+      return local_port;
+    }
+
+    operator bool() {
+      return sock_open;
+    }
+
+    /*
+     * Extended API
+     */
+
+    String remoteIPString() {
+      return rx_ip;
+    }
+
+   protected:
+    modemType* at;
+    uint8_t    mux;
+    bool       sock_open;
+    uint16_t   local_port;
+    String     tx_host;   // Where the datagram goes, and the last peer
+    uint16_t   tx_port;
+    bool       peer_set;  // The socket is connected to tx_host and tx_port
+    bool       writing;   // beginPacket() was called, endPacket() wasn't
+    uint8_t    buf[TINY_GSM_UDP_BUFFER];  // The datagram written or read
+    uint16_t   tx_len;
+    uint16_t   rx_len;
+    uint16_t   rx_pos;
+    String     rx_ip;
+    uint16_t   rx_port;
+  };
+
+  /*
+   * Constructor
+   */
+ protected:
+  TinyGsmUDP() : udpOpen(0), udpData(0) {}
+
+  /*
+   * UDP functions
+   */
+ protected:
+  // Opens the socket, bound to the local port if the module allows it.
+  // Modules that pick the socket number themselves write it back into mux.
+  bool modemUdpBegin(uint8_t* mux,
+                     uint16_t local_port) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  // Sends one datagram; newPeer is set when it goes to a different host or
+  // port than the last one sent on this socket
+  bool modemUdpSend(uint8_t mux, const char* host, uint16_t port,
+                    const uint8_t* buf, size_t len,
+                    bool newPeer) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  // Reads one datagram into buf, returning its length.  Modules that report
+  // the sender overwrite ip and port, otherwise they keep the last peer.
+  int modemUdpReceive(uint8_t mux, uint8_t* buf, size_t size, String& ip,
+                      uint16_t& port) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+  void modemUdpStop(uint8_t mux) TINY_GSM_ATTR_NOT_IMPLEMENTED;
+
+  // Whether mux is an open UDP socket, whose URC's are not a TCP client's
+  bool udpOwns(int8_t mux) const {
+    return mux >= 0 && mux < muxCount && (udpOpen & (1U << mux));
+  }
+  // Called from the modules' data URC's
+  void udpReceived(int8_t mux) {
+    if (udpOwns(mux)) { udpData |= (1U << mux); }
+  }
+
+  void udpOpened(uint8_t mux) {
+    if (mux >= muxCount) { return; }
+    udpOpen |= (1U << mux);
+    udpData &= ~(1U << mux);
+  }
+  void udpClosed(uint8_t mux) {
+    if (mux >= muxCount) { return; }
+    udpOpen &= ~(1U << mux);
+    udpData &= ~(1U << mux);
+  }
+  // Whether a URC said data came on mux, after handling the URC's waiting
+  bool udpPending(uint8_t mux) {
+    while (thisModem().stream.available()) {
+      thisModem().waitResponse(15, NULL, NULL);
+    }
+    return mux < muxCount && (udpData & (1U << mux));
+  }
+  // The module has nothing left to read on mux
+  void udpDrained(uint8_t mux) {
+    if (mux < muxCount) { udpData &= ~(1U << mux); }
+  }
+
+  uint16_t udpOpen;  // The muxes of the open UDP sockets, a bit per mux
+  uint16_t udpData;  // Those the module said data came on
+};
+
+#endif  // SRC_TINYGSMUDP_H_
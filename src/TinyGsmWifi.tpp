@@ -20,9 +20,11 @@ class TinyGsmWifi {
    * WiFi functions
    */
   bool networkConnect(const char* ssid, const char* pwd) {
+    TINY_GSM_STACK_CALL("networkConnect");
     return thisModem().networkConnectImpl(ssid, pwd);
   }
   bool networkDisconnect() {
+    TINY_GSM_STACK_CALL("networkDisconnect");
     return thisModem().networkDisconnectImpl();
   }
 
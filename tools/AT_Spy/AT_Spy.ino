@@ -25,6 +25,16 @@
 #include <AltSoftSerial.h>
 AltSoftSerial BOARD_TX;
 
+// Uncomment to write the traffic to SPY as a binary log with timestamps,
+// to capture on a PC and replay into the library (see TinyGsmRecorder.h),
+// instead of echoing it
+// #define SPY_RECORD
+
+#ifdef SPY_RECORD
+#include <TinyGsmRecorder.h>
+TinyGsmTrafficLog traffic(SPY);
+#endif
+
 
 void setup() {
   // Set console baud rate
@@ -38,9 +48,21 @@ void setup() {
 void loop()
 {
   while (MODEM_TX.available()) {
+#ifdef SPY_RECORD
+    traffic.add(TinyGsmTrafficLog::FROM_MODEM, MODEM_TX.read());
+#else
     SPY.write(MODEM_TX.read());
+#endif
   }
   while (BOARD_TX.available()) {
+#ifdef SPY_RECORD
+    traffic.add(TinyGsmTrafficLog::TO_MODEM, BOARD_TX.read());
+#else
     SPY.write(BOARD_TX.read());
+#endif
   }
+#ifdef SPY_RECORD
+  // Nothing more for now, the record gathered so far can go out
+  traffic.flush();
+#endif
 }
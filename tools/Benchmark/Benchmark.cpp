@@ -0,0 +1,530 @@
+/**
+ * @file       Benchmark.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Data path benchmark for the host build.  A GsmClient of the selected
+ * modem reads the extras/test_*.bin payloads from a ModemEmulator and
+ * writes them back, and the run is measured for throughput, AT commands
+ * per kB, heap allocations, peak stack and where the CPU time went.
+ *
+ *   benchmark_sim800 [--payloads <dir>] [--save <file>] [--compare <file>]
+ *
+ * --save stores the results as a baseline, --compare reports the change
+ * against one and fails if any of the counts got worse: the AT commands,
+ * the heap allocations and the bytes they took, and the peak stack.  Those
+ * are taken on the virtual clock, so they come out the same on every run;
+ * the throughput and the CPU shares depend on the machine and its load and
+ * are only reported.
+ */
+
+#if defined(TINY_GSM_MODEM_SIM800)
+#define BENCH_DIALECT ModemEmulator::SIM800
+#elif defined(TINY_GSM_MODEM_BG96)
+#define BENCH_DIALECT ModemEmulator::BG96
+#elif defined(TINY_GSM_MODEM_SIM7080)
+#define BENCH_DIALECT ModemEmulator::SIM7080
+#else
+#error "The modem emulator has no dialect for the selected modem"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "HostClock.h"
+#include "ModemEmulator.h"
+#include <TinyGsmClient.h>
+
+/*
+ * Heap allocations
+ *
+ * The program is linked with --wrap for the allocation functions, which
+ * catches the calls made by the library and the Arduino core stand-in,
+ * but not the ones inside the C++ runtime made for the emulator.
+ */
+
+static bool     count_allocs = false;
+static uint32_t allocs       = 0;
+static uint64_t alloc_bytes  = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+  if (count_allocs) {
+    allocs++;
+    alloc_bytes += size;
+  }
+  return __real_malloc(size);
+}
+void* __wrap_calloc(size_t n, size_t size) {
+  if (count_allocs) {
+    allocs++;
+    alloc_bytes += n * size;
+  }
+  return __real_calloc(n, size);
+}
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (count_allocs) {
+    allocs++;
+    alloc_bytes += size;
+  }
+  return __real_realloc(ptr, size);
+}
+void __wrap_free(void* ptr) {
+  __real_free(ptr);
+}
+}
+
+/*
+ * Peak stack
+ *
+ * The stack below the caller is painted before a run and checked for the
+ * deepest byte that changed after it.
+ */
+
+static const size_t  kStackPaint = 64 * 1024;
+static const uint8_t kPaint      = 0xA5;
+static uintptr_t     paint_low   = 0;
+
+__attribute__((noinline, no_sanitize_address)) static void paintStack() {
+  volatile uint8_t area[kStackPaint];
+  for (size_t i = 0; i < kStackPaint; i++) { area[i] = kPaint; }
+  paint_low = reinterpret_cast<uintptr_t>(area);
+}
+
+__attribute__((noinline, no_sanitize_address)) static size_t stackUsed() {
+  volatile uint8_t* area = reinterpret_cast<volatile uint8_t*>(paint_low);
+  size_t            i    = 0;
+  while (i < kStackPaint && area[i] == kPaint) { i++; }
+  return kStackPaint - i;
+}
+
+/*
+ * CPU time split
+ *
+ * The time between two calls the driver makes on its Stream goes to what
+ * the driver was doing: parsing responses (the bytes waitResponse and
+ * friends read), copying socket data in or out, or writing commands.
+ * Time in the emulator is left out, and the time before the first call
+ * of a client function is the client's own.
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+// CPU time of the process, which unlike the wall clock is not stretched by
+// whatever else the machine is doing
+static double cpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum Activity { CLIENT, RESPONSE, PAYLOAD, COMMAND, APP, ACTIVITIES };
+
+class BenchStream : public Stream {
+ public:
+  explicit BenchStream(ModemEmulator& emu)
+      : emu(emu), profile(false), counting(false) {
+    reset();
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < ACTIVITIES; i++) { spent[i] = Clock::duration(); }
+    activity = APP;
+    last     = Clock::now();
+  }
+
+  // Switches what the time from now on is counted as
+  void mark(Activity next) {
+    if (!profile) { return; }
+    Clock::time_point now = Clock::now();
+    spent[activity] += now - last;
+    last     = now;
+    activity = next;
+  }
+
+  int available() override {
+    enter();
+    int n = emu.available();
+    leave(activity);
+    return n;
+  }
+  int read() override {
+    enter();
+    bool payload = emu.payloadNext();
+    int  c       = emu.read();
+    leave(c < 0 ? activity : (payload ? PAYLOAD : RESPONSE));
+    return c;
+  }
+  int peek() override {
+    enter();
+    int c = emu.peek();
+    leave(activity);
+    return c;
+  }
+  size_t write(uint8_t c) override {
+    enter();
+    bool payload = emu.sendingData();
+    emu.write(c);
+    leave(payload ? PAYLOAD : COMMAND);
+    return 1;
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    enter();
+    bool payload = emu.sendingData();
+    emu.write(buffer, size);
+    leave(payload ? PAYLOAD : COMMAND);
+    return size;
+  }
+  using Print::write;
+  void flush() override {}
+
+  ModemEmulator&  emu;
+  bool            profile;   // Measure the time split
+  bool            counting;  // Count the driver's allocations
+  Clock::duration spent[ACTIVITIES];
+
+ protected:
+  void enter() {
+    count_allocs = false;
+    if (profile) { mark(activity); }
+  }
+  void leave(Activity next) {
+    if (profile) {
+      // The emulator's own time is dropped
+      last = Clock::now();
+    }
+    activity     = next;
+    count_allocs = counting;
+  }
+
+  Activity          activity;
+  Clock::time_point last;
+};
+
+/*
+ * Results
+ */
+
+struct Result {
+  std::string name;
+  double      mb_per_s;
+  double      commands_per_kb;
+  uint32_t    allocs;
+  uint64_t    alloc_bytes;
+  size_t      peak_stack;
+  double      share[ACTIVITIES];  // Percent of the profiled time
+};
+
+typedef std::map<std::string, double> Metrics;
+
+static void addMetrics(Metrics& metrics, const Result& r) {
+  metrics[r.name + ".mb_per_s"]        = r.mb_per_s;
+  metrics[r.name + ".commands_per_kb"] = r.commands_per_kb;
+  metrics[r.name + ".allocs"]          = r.allocs;
+  metrics[r.name + ".alloc_bytes"]     = r.alloc_bytes;
+  metrics[r.name + ".peak_stack"]      = r.peak_stack;
+  metrics[r.name + ".response_pct"]    = r.share[RESPONSE];
+  metrics[r.name + ".payload_pct"]     = r.share[PAYLOAD];
+}
+
+static bool loadFile(const std::string& path, std::vector<uint8_t>& data) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) { return false; }
+  uint8_t buf[4096];
+  size_t  n;
+  data.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+/*
+ * The runs
+ */
+
+static const char* const kPayloads[] = {"1k", "10k", "100k", "1m"};
+static const size_t      kChunk      = 512;  // Bytes per read() / write()
+// The throughput is the best of up to kRuns runs taking kRunSeconds of CPU
+// time together, the first run counts however long it takes
+static const uint8_t     kRuns       = 20;
+static const double      kRunSeconds = 1;
+
+// Reads the whole payload through the client, returns false on a mismatch
+// or when nothing came for a minute
+static bool readPayload(BenchStream& stream, TinyGsmClient& client,
+                        const std::vector<uint8_t>& payload) {
+  static uint8_t buf[kChunk];
+  size_t         got   = 0;
+  uint32_t       start = millis();
+  while (got < payload.size() && millis() - start < 60000L) {
+    stream.mark(CLIENT);
+    int n = client.read(buf, sizeof(buf));
+    stream.mark(APP);
+    if (n <= 0) { continue; }
+    if (got + n > payload.size() || memcmp(buf, &payload[got], n) != 0) {
+      return false;
+    }
+    got += n;
+    start = millis();
+  }
+  return got == payload.size();
+}
+
+// Writes the whole payload through the client
+static bool writePayload(BenchStream& stream, TinyGsmClient& client,
+                         const std::vector<uint8_t>& payload) {
+  size_t sent = 0;
+  while (sent < payload.size()) {
+    size_t len = payload.size() - sent;
+    if (len > kChunk) { len = kChunk; }
+    stream.mark(CLIENT);
+    size_t n = client.write(&payload[sent], len);
+    stream.mark(APP);
+    if (n == 0) { return false; }
+    sent += n;
+  }
+  return stream.emu.sentCount(0) == payload.size();
+}
+
+// Moves the payload over a fresh connection, returning the CPU seconds the
+// transfer took or a negative number on failure.  Like the emulator's
+// counters, the stream only counts and profiles the transfer itself, not
+// connecting and closing.
+static double runOnce(BenchStream& stream, TinyGsm& modem, bool reading,
+                      const std::vector<uint8_t>& payload,
+                      uint32_t* commands = NULL) {
+  ModemEmulator& emu      = stream.emu;
+  bool           counting = stream.counting;
+  bool           profile  = stream.profile;
+  TinyGsmClient  client(modem, 0);
+  stream.counting = false;
+  stream.profile  = false;
+  if (reading) { emu.addIncoming(0, &payload[0], payload.size()); }
+  if (!client.connect("example.com", 80)) { return -1; }
+
+  emu.resetStats();
+  stream.reset();
+  stream.counting = counting;
+  stream.profile  = profile;
+  count_allocs    = counting;
+  double start    = cpuSeconds();
+  bool   ok       = reading ? readPayload(stream, client, payload)
+                          : writePayload(stream, client, payload);
+  double seconds  = cpuSeconds() - start;
+  stream.mark(APP);
+  stream.counting = false;
+  stream.profile  = false;
+  count_allocs    = false;
+
+  if (commands) { *commands = emu.commandCount(); }
+  client.stop();
+  return ok ? seconds : -1;
+}
+
+static bool runCase(const std::string& name, bool reading,
+                    const std::vector<uint8_t>& payload, Result& r) {
+  r.name = name;
+
+  // Throughput, with the stream only passing calls on
+  double spent = 0;
+  r.mb_per_s   = 0;
+  for (uint8_t run = 0; run < kRuns && spent < kRunSeconds; run++) {
+    ModemEmulator emu(BENCH_DIALECT);
+    BenchStream   stream(emu);
+    TinyGsm       modem(stream);
+    double        seconds = runOnce(stream, modem, reading, payload);
+    if (seconds < 0) { return false; }
+    spent += seconds;
+    if (payload.size() / 1e6 / seconds > r.mb_per_s) {
+      r.mb_per_s = payload.size() / 1e6 / seconds;
+    }
+  }
+
+  // The counts, on the virtual clock so the replies line up with the polling
+  // the same way every run
+  {
+    hostClockSetVirtual(true);
+    ModemEmulator emu(BENCH_DIALECT);
+    BenchStream   stream(emu);
+    TinyGsm       modem(stream);
+    uint32_t      commands = 0;
+    allocs                 = 0;
+    alloc_bytes            = 0;
+    stream.counting        = true;
+    paintStack();
+    bool ok = runOnce(stream, modem, reading, payload, &commands) >= 0;
+    hostClockSetVirtual(false);
+    r.peak_stack      = stackUsed();
+    r.allocs          = allocs;
+    r.alloc_bytes     = alloc_bytes;
+    r.commands_per_kb = commands * 1024.0 / payload.size();
+    if (!ok) { return false; }
+  }
+
+  // Where the time goes
+  {
+    ModemEmulator emu(BENCH_DIALECT);
+    BenchStream   stream(emu);
+    TinyGsm       modem(stream);
+    stream.profile = true;
+    if (runOnce(stream, modem, reading, payload) < 0) { return false; }
+    // Shares of the library's time, the benchmark's own is left out
+    double total = 0;
+    for (uint8_t i = 0; i < APP; i++) {
+      total += std::chrono::duration<double>(stream.spent[i]).count();
+    }
+    for (uint8_t i = 0; i < ACTIVITIES; i++) {
+      double t = std::chrono::duration<double>(stream.spent[i]).count();
+      r.share[i] = total > 0 ? 100 * t / total : 0;
+    }
+  }
+  return true;
+}
+
+/*
+ * Baselines
+ */
+
+static bool saveBaseline(const char* path, const Metrics& metrics) {
+  FILE* f = fopen(path, "w");
+  if (!f) { return false; }
+  fprintf(f, "# TinyGSM data path benchmark baseline\n");
+  for (Metrics::const_iterator it = metrics.begin(); it != metrics.end();
+       ++it) {
+    fprintf(f, "%s %.4f\n", it->first.c_str(), it->second);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool loadBaseline(const char* path, Metrics& metrics) {
+  FILE* f = fopen(path, "r");
+  if (!f) { return false; }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') { continue; }
+    char   key[200];
+    double value;
+    if (sscanf(line, "%199s %lf", key, &value) == 2) { metrics[key] = value; }
+  }
+  fclose(f);
+  return true;
+}
+
+// Prints the changes, returns how many of the counts got worse
+static int compare(const Metrics& base, const Metrics& now) {
+  int worse = 0;
+  printf("\n%-32s %12s %12s %9s\n", "metric", "baseline", "now", "change");
+  for (Metrics::const_iterator it = now.begin(); it != now.end(); ++it) {
+    Metrics::const_iterator b = base.find(it->first);
+    if (b == base.end()) { continue; }
+    const std::string& key    = it->first;
+    double             change = b->second != 0
+                    ? 100 * (it->second - b->second) / b->second
+                    : 0;
+    // Timing depends on the machine and its load, and the stack on the
+    // compiler and its flags, so they are only reported.  The AT commands
+    // and the allocations only depend on the code, and the count run takes
+    // them on the virtual clock, so they come out the same on every run and
+    // build, but for the rounding of the baseline.
+    bool timing = key.find("mb_per_s") != std::string::npos ||
+        key.find("_pct") != std::string::npos;
+    bool build = key.find("peak_stack") != std::string::npos;
+    bool bad   = !timing && !build && it->second > b->second * 1.0001 + 0.0001;
+    const char* note = bad ? "  WORSE"
+        : timing           ? "  (timing)"
+        : build            ? "  (build)"
+                           : "";
+    printf("%-32s %12.2f %12.2f %8.1f%%%s\n", key.c_str(), b->second,
+           it->second, change, note);
+    if (bad) { worse++; }
+  }
+  return worse;
+}
+
+int main(int argc, char** argv) {
+  std::string payload_dir  = TINY_GSM_BENCH_PAYLOADS;
+  const char* save_path    = NULL;
+  const char* compare_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--payloads" && i + 1 < argc) {
+      payload_dir = argv[++i];
+    } else if (arg == "--save" && i + 1 < argc) {
+      save_path = argv[++i];
+    } else if (arg == "--compare" && i + 1 < argc) {
+      compare_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--payloads <dir>] [--save <file>] "
+              "[--compare <file>]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  printf("%-12s %8s %8s %7s %7s %9s %9s %9s %9s\n", "case", "MB/s",
+         "AT/kB", "allocs", "stack", "response", "payload", "command",
+         "client");
+  Metrics metrics;
+  int     failed = 0;
+  for (size_t p = 0; p < sizeof(kPayloads) / sizeof(kPayloads[0]); p++) {
+    std::vector<uint8_t> payload;
+    std::string path = payload_dir + "/test_" + kPayloads[p] + ".bin";
+    if (!loadFile(path, payload) || payload.empty()) {
+      fprintf(stderr, "Can't read %s\n", path.c_str());
+      return 2;
+    }
+    for (int reading = 1; reading >= 0; reading--) {
+      Result      r;
+      std::string name = std::string(reading ? "read_" : "write_") +
+          kPayloads[p];
+      if (!runCase(name, reading, payload, r)) {
+        printf("%-12s FAILED\n", name.c_str());
+        failed++;
+      } else {
+        printf("%-12s %8.2f %8.2f %7u %7zu %8.1f%% %8.1f%% %8.1f%% %8.1f%%\n",
+               name.c_str(), r.mb_per_s, r.commands_per_kb, r.allocs,
+               r.peak_stack, r.share[RESPONSE], r.share[PAYLOAD],
+               r.share[COMMAND], r.share[CLIENT]);
+        addMetrics(metrics, r);
+      }
+    }
+  }
+  if (failed) { return 1; }
+
+  if (save_path && !saveBaseline(save_path, metrics)) {
+    fprintf(stderr, "Can't write %s\n", save_path);
+    return 2;
+  }
+  if (compare_path) {
+    Metrics base;
+    if (!loadBaseline(compare_path, base)) {
+      fprintf(stderr, "Can't read %s\n", compare_path);
+      return 2;
+    }
+    int worse = compare(base, metrics);
+    if (worse) {
+      printf("\n%d metric(s) worse than the baseline\n", worse);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+# Prints the flash and RAM taken by the builds of test_build the size
+# benchmark makes, one per modem and feature selection, next to what the
+# full build of the same modem takes.  Run by the size_benchmark target as
+#
+#   cmake -DSIZE=<size tool> -DBUILDS=<modem>:<features>:<program>;...
+#         -P SizeReport.cmake
+#
+# Flash is the text and the initialized data, RAM the data and the bss.
+# The first build of each modem is the one the rest are compared with.
+
+function(pad_left out text width)
+  string(LENGTH "${text}" len)
+  while(len LESS width)
+    set(text " ${text}")
+    math(EXPR len "${len} + 1")
+  endwhile()
+  set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+function(pad_right out text width)
+  string(LENGTH "${text}" len)
+  while(len LESS width)
+    set(text "${text} ")
+    math(EXPR len "${len} + 1")
+  endwhile()
+  set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+# The change from the full build, as +n or -n
+function(delta out value base)
+  math(EXPR d "${value} - ${base}")
+  if(d GREATER 0)
+    set(d "+${d}")
+  endif()
+  set(${out} "${d}" PARENT_SCOPE)
+endfunction()
+
+message("modem      features           flash   change      RAM   change")
+set(base_modem "")
+foreach(build ${BUILDS})
+  string(REPLACE ":" ";" fields "${build}")
+  list(GET fields 0 modem)
+  list(GET fields 1 features)
+  list(GET fields 2 program)
+
+  execute_process(COMMAND ${SIZE} -B ${program}
+                  OUTPUT_VARIABLE out RESULT_VARIABLE res)
+  if(NOT res EQUAL 0)
+    message(FATAL_ERROR "Can't size ${program}")
+  endif()
+  # The second line: text data bss dec hex filename
+  string(REGEX MATCH "\n *([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)" _ "${out}")
+  math(EXPR flash "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+  math(EXPR ram "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+
+  if(NOT modem STREQUAL base_modem)
+    set(base_modem ${modem})
+    set(base_flash ${flash})
+    set(base_ram ${ram})
+  endif()
+  delta(flash_change ${flash} ${base_flash})
+  delta(ram_change ${ram} ${base_ram})
+
+  pad_right(modem_col "${modem}" 11)
+  pad_right(features_col "${features}" 15)
+  pad_left(flash_col "${flash}" 9)
+  pad_left(flash_change_col "${flash_change}" 9)
+  pad_left(ram_col "${ram}" 9)
+  pad_left(ram_change_col "${ram_change}" 9)
+  message("${modem_col}${features_col}${flash_col}${flash_change_col}"
+          "${ram_col}${ram_change_col}")
+endforeach()
@@ -0,0 +1,247 @@
+/**
+ * @file       StackBudget.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Stack budget check for the host build.  Built with TINY_GSM_STACK, it
+ * goes through the public functions a sketch usually calls, against a
+ * ModemEmulator of the selected modem, and prints the stack each of them
+ * took, as measured by TinyGsmStack.h.  It fails if any took more than the
+ * budget.
+ *
+ *   stack_budget_sim800 [--budget <bytes>]
+ *
+ * The host is a 64 bit machine, where pointers, Strings and frames are
+ * larger than on a microcontroller, so the numbers are an upper bound for
+ * an 8 bit board; to see the real ones, define TINY_GSM_STACK in the sketch
+ * and print TinyGsmStackLog().
+ *
+ * It is linked with "-z now": a function of a shared library is otherwise
+ * looked up the first time it's called, on the stack of whoever called it,
+ * and that takes some kilobytes.
+ */
+
+#if defined(TINY_GSM_MODEM_SIM800)
+#define BUDGET_DIALECT ModemEmulator::SIM800
+#elif defined(TINY_GSM_MODEM_BG96)
+#define BUDGET_DIALECT ModemEmulator::BG96
+#elif defined(TINY_GSM_MODEM_SIM7080)
+#define BUDGET_DIALECT ModemEmulator::SIM7080
+#else
+#error "The modem emulator has no dialect for the selected modem"
+#endif
+
+#if !defined(TINY_GSM_STACK)
+#error "Build with TINY_GSM_STACK defined"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "HostClock.h"
+#include "ModemEmulator.h"
+#include <TinyGsmClient.h>
+
+// The emulator, run on a stack of its own; its replies are worked out in
+// the calls the driver makes on the Stream, which would otherwise take
+// their stack from the driver's and be measured as the library's
+class EmulatorStream : public Stream {
+ public:
+  explicit EmulatorStream(ModemEmulator& emu) : emu(emu) {
+    self = this;
+    getcontext(&emu_context);
+    emu_context.uc_stack.ss_sp   = emu_stack;
+    emu_context.uc_stack.ss_size = sizeof(emu_stack);
+    makecontext(&emu_context, serve, 0);
+  }
+
+  int available() override {
+    return run(AVAILABLE);
+  }
+  int read() override {
+    return run(READ);
+  }
+  int peek() override {
+    return run(PEEK);
+  }
+  size_t write(uint8_t c) override {
+    data = &c;
+    size = 1;
+    return run(WRITE);
+  }
+  size_t write(const uint8_t* buffer, size_t len) override {
+    data = buffer;
+    size = len;
+    return run(WRITE);
+  }
+  using Print::write;
+  void flush() override {}
+
+ protected:
+  enum Op { AVAILABLE, READ, PEEK, WRITE };
+
+  int run(Op what) {
+    op = what;
+    swapcontext(&driver_context, &emu_context);
+    return result;
+  }
+
+  // The emulator's side, answering one call at a time
+  static void serve() {
+    for (;;) {
+      EmulatorStream& s = *self;
+      switch (s.op) {
+        case AVAILABLE: s.result = s.emu.available(); break;
+        case READ: s.result = s.emu.read(); break;
+        case PEEK: s.result = s.emu.peek(); break;
+        case WRITE: s.result = s.emu.write(s.data, s.size); break;
+      }
+      swapcontext(&s.emu_context, &s.driver_context);
+    }
+  }
+
+  static EmulatorStream* self;
+
+  ModemEmulator& emu;
+  ucontext_t     driver_context;
+  ucontext_t     emu_context;
+  uint8_t        emu_stack[256 * 1024];
+  Op             op;
+  const uint8_t* data;
+  size_t         size;
+  int            result;
+};
+
+EmulatorStream* EmulatorStream::self = NULL;
+
+// Replies for the commands the session sends that the emulator's socket
+// model and its default "OK" don't answer
+static void addRules(ModemEmulator& emu) {
+  emu.addRule("ATI", "\r\nSIMCOM_Ltd\r\nSIMCOM_SIM800\r\nRevision:1418B05\r\n"
+                     "\r\nOK\r\n");
+  emu.addRule("AT+CGSN", "\r\n866425030123456\r\n\r\nOK\r\n");
+  emu.addRule("AT+GSN", "\r\n866425030123456\r\n\r\nOK\r\n");
+  emu.addRule("AT+CCID", "\r\n89014103211118510720\r\n\r\nOK\r\n");
+  emu.addRule("AT+QCCID", "\r\n+QCCID: 89014103211118510720\r\n\r\nOK\r\n");
+  emu.addRule("AT+CPIN?", "\r\n+CPIN: READY\r\n\r\nOK\r\n");
+  emu.addRule("AT+CSQ", "\r\n+CSQ: 21,0\r\n\r\nOK\r\n");
+  emu.addRule("AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n");
+  emu.addRule("AT+CGREG?", "\r\n+CGREG: 0,1\r\n\r\nOK\r\n");
+  emu.addRule("AT+CEREG?", "\r\n+CEREG: 0,1\r\n\r\nOK\r\n");
+  emu.addRule("AT+COPS?", "\r\n+COPS: 0,0,\"Example\",7\r\n\r\nOK\r\n");
+  emu.addRule("AT+CGATT?", "\r\n+CGATT: 1\r\n\r\nOK\r\n");
+  emu.addRule("AT+CIFSR", "\r\n10.0.0.2\r\n");
+  emu.addRule("AT+CGPADDR", "\r\n+CGPADDR: 1,\"10.0.0.2\"\r\n\r\nOK\r\n");
+  emu.addRule("AT+CNACT?", "\r\n+CNACT: 0,1,\"10.0.0.2\"\r\n\r\nOK\r\n");
+  emu.addRule("AT+QIACT?", "\r\n+QIACT: 1,1,1,\"10.0.0.2\"\r\n\r\nOK\r\n");
+  emu.addRule("AT+CCLK?", "\r\n+CCLK: \"26/10/19,12:34:56+08\"\r\n\r\nOK\r\n");
+  emu.addRule("AT+CBC", "\r\n+CBC: 0,87,4123\r\n\r\nOK\r\n");
+  emu.addRule("AT+CUSD=1,",
+              "\r\nOK\r\n\r\n+CUSD: 0,\"Your balance is 10.00\",15\r\n");
+  emu.addRule("AT+CMGS", "\r\n> ");
+}
+
+// Makes a call from a small frame of its own: a public function inlined
+// into its caller is measured from the caller's frame, which here would be
+// the session with the modem and client in it.  Says so if the call failed,
+// as a failed call may take another path than a good one.
+template <typename Call>
+__attribute__((noinline)) static void call(const char* text, Call run) {
+  if (!run()) { printf("(%s failed)\n", text); }
+}
+
+#define CALL(expr) call(#expr, [&]() { return static_cast<bool>(expr); })
+
+static void runSession(TinyGsm& modem, ModemEmulator& emu) {
+  char buf[64];
+
+  CALL(modem.init());
+  CALL(modem.getModemInfo().length());
+  CALL(modem.getIMEI().length());
+  CALL(modem.getIMEI(buf, sizeof(buf)));
+  CALL(modem.getSimCCID().length());
+  CALL(modem.getSimStatus() == SIM_READY);
+  CALL(modem.waitForNetwork(10000L));
+  CALL(modem.isNetworkConnected());
+  CALL(modem.getSignalQuality() != 99);
+  CALL(modem.getOperator().length());
+  CALL(modem.gprsConnect("internet"));
+  CALL(modem.isGprsConnected());
+  CALL(modem.localIP() != IPAddress(0, 0, 0, 0));
+#if defined(TINY_GSM_MODEM_HAS_TIME)
+  CALL(modem.getGSMDateTime(DATE_FULL).length());
+#endif
+#if defined(TINY_GSM_MODEM_HAS_BATTERY)
+  CALL(modem.getBattVoltage());
+#endif
+#if defined(TINY_GSM_MODEM_HAS_SMS)
+  CALL(modem.sendUSSD("*100#").length());
+#endif
+
+#if defined(TINY_GSM_MODEM_HAS_TCP)
+  static uint8_t data[1024];
+  for (size_t i = 0; i < sizeof(data); i++) { data[i] = i * 7; }
+  emu.addIncoming(0, data, sizeof(data));
+
+  TinyGsmClient client(modem, 0);
+  CALL(client.connect("example.com", 80));
+  CALL(client.write(data, sizeof(data)) == sizeof(data));
+  size_t   got   = 0;
+  uint32_t start = millis();
+  while (got < sizeof(data) && millis() - start < 10000L) {
+    int n = 0;
+    CALL(client.available() >= 0);
+    CALL((n = client.read(reinterpret_cast<uint8_t*>(buf), sizeof(buf))) >=
+         0);
+    if (n > 0) { got += n; }
+  }
+  CALL(got == sizeof(data));
+  CALL(client.connected());
+  CALL((client.stop(), true));
+#endif
+  CALL((modem.maintain(), true));
+  CALL(modem.gprsDisconnect());
+}
+
+int main(int argc, char** argv) {
+  long budget = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--budget" && i + 1 < argc) {
+      budget = atol(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--budget <bytes>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  hostClockSetVirtual(true);
+  static ModemEmulator  emu(BUDGET_DIALECT);
+  static EmulatorStream stream(emu);
+  addRules(emu);
+  TinyGsm modem(stream);
+  runSession(modem, emu);
+
+  const TinyGsmStack& stack = TinyGsmStackLog();
+  Serial.print(stack);
+  if (!budget) { return 0; }
+
+  int over = 0;
+  for (uint8_t i = 0; i < stack.callCount(); i++) {
+    const TinyGsmStackCall& c = stack.call(i);
+    if (c.full || c.peak > budget) {
+      printf("%s took %s%u bytes, over the budget of %ld\n", c.name,
+             c.full ? "more than " : "", c.peak, budget);
+      over++;
+    }
+  }
+  printf("Deepest call: %u bytes, budget %ld\n", stack.peak(), budget);
+  return over ? 1 : 0;
+}
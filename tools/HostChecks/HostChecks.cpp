@@ -0,0 +1,333 @@
+/**
+ * @file       HostChecks.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Behaviour checks for the host build.  Each one drives the selected modem
+ * against a ModemEmulator and looks at what came out: the number parser,
+ * URC's arriving in the middle of a getter's reply, data pushed on an
+ * ESP8266 connection no client has taken, UDP datagrams coming in, and the
+ * DNS cache.  It prints a line per check and fails if any did.
+ *
+ *   host_checks_sim800
+ *
+ * Everything runs on the virtual clock, so the time-outs and TTL's that
+ * are waited out take no real time.
+ */
+
+#if defined(TINY_GSM_MODEM_SIM800)
+#define CHECK_DIALECT ModemEmulator::SIM800
+#define CHECK_INFO_COMMAND "ATI"
+#define CHECK_DATA_URC "+CIPRXGET: 1,0"
+#elif defined(TINY_GSM_MODEM_BG96)
+#define CHECK_DIALECT ModemEmulator::BG96
+#define CHECK_INFO_COMMAND "ATI"
+#define CHECK_DATA_URC "+QIURC: \"recv\",0"
+#elif defined(TINY_GSM_MODEM_SIM7080)
+#define CHECK_DIALECT ModemEmulator::SIM7080
+#define CHECK_INFO_COMMAND "ATI"
+#define CHECK_DATA_URC "+CADATAIND: 0"
+#elif defined(TINY_GSM_MODEM_ESP8266)
+#define CHECK_DIALECT ModemEmulator::ESP8266
+#define CHECK_INFO_COMMAND "AT+GMR"
+#define CHECK_DATA_URC "1,CONNECT"
+#else
+#error "The modem emulator has no dialect for the selected modem"
+#endif
+
+// A few names, so both a hit and an eviction can be seen
+#define TINY_GSM_DNS_CACHE_SIZE 2
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "HostClock.h"
+#include "ModemEmulator.h"
+#include <TinyGsmClient.h>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) { failures++; }
+}
+
+#define CHECK(expr) check((expr), #expr)
+
+/*
+ * Number parser
+ */
+
+// Feeds text to a TinyGsmNumber, as the stream scanners do
+static TinyGsmNumber parse(const char* text, uint8_t decimals = 0) {
+  TinyGsmNumber number(decimals);
+  while (*text) { number.add(*text++); }
+  return number;
+}
+
+static bool parsesTo(const char* text, uint8_t decimals, int32_t expected) {
+  int32_t value = 0;
+  return parse(text, decimals).get(value) && value == expected;
+}
+
+static bool parsesNot(const char* text, uint8_t decimals = 0) {
+  int32_t value = 0;
+  return !parse(text, decimals).get(value);
+}
+
+static void checkNumbers() {
+  CHECK(parsesTo("42", 0, 42));
+  CHECK(parsesTo("  -17,5", 0, -17));
+  CHECK(parsesTo("+8\r\n", 0, 8));
+  CHECK(parsesTo("0", 0, 0));
+  CHECK(parsesTo("2147483647", 0, 2147483647));
+  CHECK(parsesTo("3.14159", 2, 314));
+  CHECK(parsesTo("1.5", 3, 1500));
+  CHECK(parsesTo("-0.25", 2, -25));
+  CHECK(parsesTo("12.", 1, 120));
+  // A long fraction stops at the first digit that doesn't fit; a smaller one
+  // after it must not take its place, as 21474836.40 for 21474836.48
+  CHECK(parsesTo("1.23456789012345", 9, 1234567890));
+  CHECK(parsesTo("21474836.4790", 2, 2147483647));
+  CHECK(parsesNot("21474836.480", 2));
+  CHECK(parsesNot("-21474836.4817", 2));
+  CHECK(parsesNot("0.2147483648123", 10));
+  CHECK(parsesNot(""));
+  CHECK(parsesNot(" ,"));
+  CHECK(parsesNot("-"));
+  CHECK(parsesNot("abc"));
+  CHECK(parsesNot("2147483648"));
+  CHECK(parsesNot("99999999999"));
+  float value = 0;
+  CHECK(parse("12.5", 1).get(value) && value == 12.5f);
+  CHECK(parse("-0.125", 3).get(value) && value == -0.125f);
+
+#if defined(TINY_GSM_MODEM_HAS_GPRS)
+  ModemEmulator emu(CHECK_DIALECT);
+  TinyGsm       modem(emu);
+  emu.addRule("AT+CSQ", "\r\n+CSQ: 21,0\r\n\r\nOK\r\n");
+  CHECK(modem.getSignalQuality() == 21);
+#endif
+}
+
+/*
+ * URC's inside a reply
+ */
+
+static void checkUrcInGetters() {
+  ModemEmulator emu(CHECK_DIALECT);
+  TinyGsm       modem(emu);
+  TinyGsmClient client(modem, 0);
+  CHECK(client.connect("10.0.0.1", 80));
+
+  // The URC comes between the lines of the reply; it must be handled and
+  // left out of what the getter returns, not end the reply early
+  emu.addRule(CHECK_INFO_COMMAND,
+              "\r\nModel 1\r\n" CHECK_DATA_URC "\r\nRevision 2\r\n\r\nOK\r\n");
+  CHECK(modem.getModemInfo() == "Model 1 Revision 2");
+  char buf[32];
+  CHECK(modem.getModemInfo(buf, sizeof(buf)) == 18 &&
+        !strcmp(buf, "Model 1 Revision 2"));
+
+  // Cut short by the buffer, and still the whole reply read out
+  emu.clearRules();
+  emu.addRule(CHECK_INFO_COMMAND,
+              "\r\nModel 1\r\n" CHECK_DATA_URC "\r\nRevision 2\r\n\r\nOK\r\n");
+  CHECK(modem.getModemInfo(buf, 8) == 7 && !strcmp(buf, "Model 1"));
+  emu.clearRules();
+  CHECK(modem.testAT(1000L));
+  client.stop();
+}
+
+/*
+ * ESP8266 data on a connection no client has
+ */
+
+#if defined(TINY_GSM_MODEM_ESP8266)
+static void checkUnacceptedData() {
+  ModemEmulator emu(CHECK_DIALECT);
+  TinyGsm       modem(emu);
+  TinyGsmClient client(modem, 0);
+  CHECK(client.connect("10.0.0.1", 80));
+
+  // Data pushed on connection 3, which no client has, looks like a response
+  // and like data for the client on 0; it has to be read out and dropped
+  const char foreign[] = "\r\nERROR\r\n+IPD,0,4:evil";
+  std::string push = "\r\n+IPD,3," + std::to_string(strlen(foreign)) + ":" +
+      foreign + "\r\n";
+  emu.addRule("AT+GMR", (push + "AT version:1.7.4\r\n\r\nOK\r\n").c_str());
+  CHECK(modem.getModemInfo() == "AT version:1.7.4");
+  CHECK(client.available() == 0);
+
+  // While the client on 0 still gets its own
+  const uint8_t data[] = "hello";
+  emu.addIncoming(0, data, 5);
+  uint8_t  got[8] = {0};
+  size_t   len    = 0;
+  uint32_t start  = millis();
+  while (len < 5 && millis() - start < 5000L) {
+    int n = client.read(got + len, sizeof(got) - 1 - len);
+    if (n > 0) { len += n; }
+  }
+  CHECK(len == 5 && !memcmp(got, "hello", 5));
+  client.stop();
+}
+#endif
+
+/*
+ * UDP
+ */
+
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+static void checkUdpReceive() {
+  ModemEmulator emu(CHECK_DIALECT);
+  TinyGsm       modem(emu);
+  TinyGsmUdp    udp(modem);
+  uint8_t       mux = TINY_GSM_MUX_COUNT - 1;
+  emu.keepSentData(true);
+  CHECK(udp.begin(5000));
+  CHECK(udp.beginPacket("10.0.0.1", 7));
+  CHECK(udp.write(reinterpret_cast<const uint8_t*>("ping"), 4) == 4);
+  CHECK(udp.endPacket());
+  CHECK(emu.sentData(mux) == "ping");
+
+  // Nothing announced, so nothing asked for
+  uint32_t commands = emu.commandCount();
+  CHECK(udp.parsePacket() == 0);
+  CHECK(emu.commandCount() == commands);
+
+  const uint8_t pong[] = "pong";
+  emu.addIncoming(mux, pong, 4);
+  int len = 0;
+  for (uint32_t start = millis(); !len && millis() - start < 5000L;) {
+    len = udp.parsePacket();
+  }
+  CHECK(len == 4);
+  CHECK(udp.available() == 4);
+  char got[8] = {0};
+  CHECK(udp.read(got, sizeof(got)) == 4 && !strcmp(got, "pong"));
+  CHECK(udp.read() == -1);
+
+  // Read out, so it's back to asking nothing
+  udp.parsePacket();
+  commands = emu.commandCount();
+  CHECK(udp.parsePacket() == 0);
+  CHECK(emu.commandCount() == commands);
+  udp.stop();
+}
+#endif
+
+/*
+ * DNS cache
+ */
+
+#if defined(TINY_GSM_MODEM_HAS_DNS)
+static void addDnsRules(ModemEmulator& emu) {
+#if defined(TINY_GSM_MODEM_BG96)
+  emu.addRule("AT+QIDNSGIP=1,\"example.com\"",
+              "\r\nOK\r\n\r\n+QIURC: \"dnsgip\",0,1,600\r\n"
+              "\r\n+QIURC: \"dnsgip\",\"93.184.216.34\"\r\n");
+  emu.addRule("AT+QIDNSGIP=1,\"example.org\"",
+              "\r\nOK\r\n\r\n+QIURC: \"dnsgip\",0,1,600\r\n"
+              "\r\n+QIURC: \"dnsgip\",\"93.184.216.35\"\r\n");
+  emu.addRule("AT+QIDNSGIP=1,\"example.net\"",
+              "\r\nOK\r\n\r\n+QIURC: \"dnsgip\",0,1,600\r\n"
+              "\r\n+QIURC: \"dnsgip\",\"93.184.216.36\"\r\n");
+  emu.addRule("AT+QIDNSGIP=1,", "\r\nOK\r\n\r\n+QIURC: \"dnsgip\",565\r\n");
+#else
+  emu.addRule("AT+CDNSGIP=\"example.com\"",
+              "\r\nOK\r\n\r\n"
+              "+CDNSGIP: 1,\"example.com\",\"93.184.216.34\"\r\n");
+  emu.addRule("AT+CDNSGIP=\"example.org\"",
+              "\r\nOK\r\n\r\n"
+              "+CDNSGIP: 1,\"example.org\",\"93.184.216.35\"\r\n");
+  emu.addRule("AT+CDNSGIP=\"example.net\"",
+              "\r\nOK\r\n\r\n"
+              "+CDNSGIP: 1,\"example.net\",\"93.184.216.36\"\r\n");
+  emu.addRule("AT+CDNSGIP=", "\r\nOK\r\n\r\n+CDNSGIP: 0,8\r\n");
+#endif
+}
+
+// Resolves host, giving the AT commands it took
+static uint32_t lookup(TinyGsm& modem, ModemEmulator& emu, const char* host,
+                       IPAddress& ip, bool& resolved) {
+  uint32_t commands = emu.commandCount();
+  ip                = IPAddress(0, 0, 0, 0);
+  resolved          = modem.getHostByName(host, ip, 5000L);
+  return emu.commandCount() - commands;
+}
+
+static void checkDnsCache() {
+  ModemEmulator emu(CHECK_DIALECT);
+  TinyGsm       modem(emu);
+  addDnsRules(emu);
+  IPAddress com(93, 184, 216, 34);
+  IPAddress org(93, 184, 216, 35);
+  IPAddress ip;
+  bool      resolved;
+
+  // A miss asks the module, a hit doesn't
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 1);
+  CHECK(resolved && ip == com);
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 0);
+  CHECK(resolved && ip == com);
+
+  // Addresses need no lookup at all
+  CHECK(lookup(modem, emu, "10.1.2.3", ip, resolved) == 0);
+  CHECK(resolved && ip == IPAddress(10, 1, 2, 3));
+
+  // A failed lookup is remembered too, until its shorter TTL runs out
+  CHECK(lookup(modem, emu, "nowhere.invalid", ip, resolved) == 1);
+  CHECK(!resolved);
+  CHECK(lookup(modem, emu, "nowhere.invalid", ip, resolved) == 0);
+  CHECK(!resolved);
+  delay(TINY_GSM_DNS_NEGATIVE_TTL * 1000L + 1000L);
+  CHECK(lookup(modem, emu, "nowhere.invalid", ip, resolved) == 1);
+
+  // A full cache gives up the oldest lookup
+  modem.clearDnsCache();
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 1);
+  CHECK(lookup(modem, emu, "example.org", ip, resolved) == 1);
+  CHECK(resolved && ip == org);
+  CHECK(lookup(modem, emu, "example.net", ip, resolved) == 1);
+  CHECK(lookup(modem, emu, "example.net", ip, resolved) == 0);
+  CHECK(lookup(modem, emu, "example.org", ip, resolved) == 0);
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 1);
+
+  // And an entry is asked for again once its TTL is up
+  delay(TINY_GSM_DNS_TTL * 1000L + 1000L);
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 1);
+  CHECK(resolved && ip == com);
+
+  // Clearing forgets everything
+  modem.clearDnsCache();
+  CHECK(lookup(modem, emu, "example.com", ip, resolved) == 1);
+}
+#endif
+
+int main() {
+  hostClockSetVirtual(true);
+  printf("Number parser\n");
+  checkNumbers();
+  printf("URC's inside a reply\n");
+  checkUrcInGetters();
+#if defined(TINY_GSM_MODEM_ESP8266)
+  printf("Data on a connection no client has\n");
+  checkUnacceptedData();
+#endif
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+  printf("UDP receive\n");
+  checkUdpReceive();
+#endif
+#if defined(TINY_GSM_MODEM_HAS_DNS)
+  printf("DNS cache\n");
+  checkDnsCache();
+#endif
+  printf("%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file       ModemSimulator.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A simulated modem on a pseudo-terminal.  The ModemEmulator runs behind
+ * the master side of a pty, so anything that opens a serial port (a host
+ * build using LinuxSerialStream, a terminal program, a script) talks to it
+ * through a real tty.  Every connection the driver opens is given the
+ * payload to read, and the network can be made to misbehave, for soak
+ * testing reconnects and measuring throughput over hours.
+ *
+ *   modem_simulator [--dialect <name>] [--link <path>] [--script <file>]
+ *                   [--baud <rate>] [--latency <ms>] [--noise <chance>]
+ *                   [--connect-delay <ms>] [--connect-fail <chance>]
+ *                   [--payload <file>] [--close-after-payload]
+ *                   [--drop-after <s>] [--drop-chance <chance>]
+ *                   [--stats <s>] [--seed <n>]
+ *
+ * The dialect is sim800 (the default), bg96, sim7080, esp8266 or generic.
+ * The path of the tty is printed on start, --link also makes a symlink to
+ * it.  --baud paces what the module sends like a serial line of that speed
+ * (0 for no limit).  --connect-delay holds back the result of every open,
+ * like a slow DNS lookup, and --connect-fail makes opens fail.  The remote
+ * end closes a connection once it was open for --drop-after seconds, with
+ * --drop-chance at a random point of the payload, or with
+ * --close-after-payload once the payload was read.  --stats prints the
+ * connections and the throughput every so many seconds.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "ModemEmulator.h"
+
+namespace {
+volatile sig_atomic_t stopping = false;
+
+void onSignal(int) {
+  stopping = true;
+}
+
+bool parseDialect(const std::string& name, ModemEmulator::Dialect& dialect) {
+  if (name == "generic") {
+    dialect = ModemEmulator::GENERIC;
+  } else if (name == "sim800") {
+    dialect = ModemEmulator::SIM800;
+  } else if (name == "bg96") {
+    dialect = ModemEmulator::BG96;
+  } else if (name == "sim7080") {
+    dialect = ModemEmulator::SIM7080;
+  } else if (name == "esp8266") {
+    dialect = ModemEmulator::ESP8266;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool loadFile(const char* path, std::string& data) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { return false; }
+  char   buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) { data.append(buf, n); }
+  fclose(f);
+  return true;
+}
+
+// Opens the master side of a new pty, keeping the slave side open too so
+// the master doesn't hang up between clients
+int openPty(int& slave_fd, std::string& slave_path) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0) { return -1; }
+  if (grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    close(fd);
+    return -1;
+  }
+  slave_path = ptsname(fd);
+  slave_fd   = open(slave_path.c_str(), O_RDWR | O_NOCTTY);
+  if (slave_fd < 0) {
+    close(fd);
+    return -1;
+  }
+  // Raw, like a serial port, for clients that don't set it up themselves
+  struct termios tio;
+  if (tcgetattr(slave_fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+}  // namespace
+
+// The emulator with a remote end that sends the payload on every new
+// connection and drops connections as told
+class SimulatedModem : public ModemEmulator {
+ public:
+  explicit SimulatedModem(Dialect dialect)
+      : ModemEmulator(dialect),
+        close_after_payload(false),
+        drop_after_ms(0),
+        drop_chance(0),
+        connections(0),
+        drops(0) {
+    for (uint8_t i = 0; i < kSockets; i++) {
+      links[i].opened_ms = 0;
+      links[i].drop_at   = 0;
+    }
+  }
+
+  // Closes the connections that are due, from the main loop
+  void checkLinks() {
+    uint32_t now = millis();
+    for (uint8_t mux = 0; mux < kSockets; mux++) {
+      if (!isOpen(mux)) { continue; }
+      Link&  link      = links[mux];
+      size_t delivered = payload.size() - incomingLeft(mux);
+      if ((drop_after_ms && now - link.opened_ms >= drop_after_ms) ||
+          (link.drop_at && delivered >= link.drop_at)) {
+        drop(mux);
+      } else if (close_after_payload && incomingLeft(mux) == 0) {
+        closeRemote(mux);
+      }
+    }
+  }
+
+  std::string payload;
+  bool        close_after_payload;
+  uint32_t    drop_after_ms;
+  float       drop_chance;
+
+  uint32_t connections;
+  uint32_t drops;  // Connections closed before their time
+
+ protected:
+  // The connection breaks, the rest of the payload never makes it
+  void drop(uint8_t mux) {
+    Socket& sock = sockets[mux];
+    sock.incoming.resize(sock.read_pos);
+    drops++;
+    closeRemote(mux);
+  }
+
+  struct Link {
+    uint32_t opened_ms;
+    size_t   drop_at;  // Payload delivered when the connection drops, 0 never
+  };
+
+  void socketOpened(uint8_t mux) override {
+    connections++;
+    links[mux].opened_ms = millis();
+    links[mux].drop_at   = 0;
+    if (drop_chance > 0 && payload.size() > 1 && roll(drop_chance)) {
+      links[mux].drop_at = 1 + rand() % (payload.size() - 1);
+    }
+    if (!payload.empty()) {
+      // Whatever was left from the last connection was thrown away with it
+      addIncoming(mux, reinterpret_cast<const uint8_t*>(payload.data()),
+                  payload.size());
+    }
+  }
+
+  Link links[kSockets];
+};
+
+int main(int argc, char** argv) {
+  ModemEmulator::Dialect dialect = ModemEmulator::SIM800;
+  const char* link_path     = NULL;
+  const char* script_path   = NULL;
+  const char* payload_path  = NULL;
+  uint32_t    baud          = 115200;
+  uint32_t    latency_ms    = 0;
+  float       noise         = 0;
+  uint32_t    connect_delay = 0;
+  float       connect_fail  = 0;
+  bool        close_after   = false;
+  uint32_t    drop_after_s  = 0;
+  float       drop_chance   = 0;
+  uint32_t    stats_s       = 0;
+  uint32_t    seed          = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--dialect" && i + 1 < argc &&
+        parseDialect(argv[i + 1], dialect)) {
+      i++;
+    } else if (arg == "--link" && i + 1 < argc) {
+      link_path = argv[++i];
+    } else if (arg == "--script" && i + 1 < argc) {
+      script_path = argv[++i];
+    } else if (arg == "--baud" && i + 1 < argc) {
+      baud = atol(argv[++i]);
+    } else if (arg == "--latency" && i + 1 < argc) {
+      latency_ms = atol(argv[++i]);
+    } else if (arg == "--noise" && i + 1 < argc) {
+      noise = atof(argv[++i]);
+    } else if (arg == "--connect-delay" && i + 1 < argc) {
+      connect_delay = atol(argv[++i]);
+    } else if (arg == "--connect-fail" && i + 1 < argc) {
+      connect_fail = atof(argv[++i]);
+    } else if (arg == "--payload" && i + 1 < argc) {
+      payload_path = argv[++i];
+    } else if (arg == "--close-after-payload") {
+      close_after = true;
+    } else if (arg == "--drop-after" && i + 1 < argc) {
+      drop_after_s = atol(argv[++i]);
+    } else if (arg == "--drop-chance" && i + 1 < argc) {
+      drop_chance = atof(argv[++i]);
+    } else if (arg == "--stats" && i + 1 < argc) {
+      stats_s = atol(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = atol(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "usage: %s [--dialect generic|sim800|bg96|sim7080|esp8266] "
+              "[--link <path>] [--script <file>] [--baud <rate>] "
+              "[--latency <ms>] [--noise <chance>] [--connect-delay <ms>] "
+              "[--connect-fail <chance>] [--payload <file>] "
+              "[--close-after-payload] [--drop-after <s>] "
+              "[--drop-chance <chance>] [--stats <s>] [--seed <n>]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  SimulatedModem modem(dialect);
+  if (script_path && !modem.loadScript(script_path)) {
+    fprintf(stderr, "Can't read %s\n", script_path);
+    return 2;
+  }
+  if (payload_path && !loadFile(payload_path, modem.payload)) {
+    fprintf(stderr, "Can't read %s\n", payload_path);
+    return 2;
+  }
+  // 8N1 takes ten bits on the line for every byte
+  modem.setByteRate(baud / 10);
+  modem.setLatency(latency_ms);
+  modem.setNoise(noise, seed);
+  modem.setConnectDelay(connect_delay);
+  modem.setConnectFailure(connect_fail);
+  modem.close_after_payload = close_after;
+  modem.drop_after_ms       = drop_after_s * 1000;
+  modem.drop_chance         = drop_chance;
+  srand(seed);
+
+  int         slave_fd;
+  std::string slave_path;
+  int         master_fd = openPty(slave_fd, slave_path);
+  if (master_fd < 0) {
+    fprintf(stderr, "Can't open a pty: %s\n", strerror(errno));
+    return 1;
+  }
+  if (link_path) {
+    unlink(link_path);
+    if (symlink(slave_path.c_str(), link_path) < 0) {
+      fprintf(stderr, "Can't link %s: %s\n", link_path, strerror(errno));
+      return 1;
+    }
+  }
+  printf("%s\n", link_path ? link_path : slave_path.c_str());
+  fflush(stdout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::string pending;  // Output the pty didn't take yet
+  uint32_t    stats_ms   = millis();
+  uint32_t    last_in    = 0;
+  uint32_t    last_out   = 0;
+  uint8_t     buf[4096];
+  while (!stopping) {
+    struct pollfd pfd;
+    pfd.fd     = master_fd;
+    pfd.events = POLLIN | (pending.empty() ? 0 : POLLOUT);
+    // Short enough for timed replies and the paced line to go out on time
+    if (poll(&pfd, 1, 1) < 0 && errno != EINTR) { break; }
+
+    ssize_t n;
+    while ((n = read(master_fd, buf, sizeof(buf))) > 0) {
+      modem.write(buf, n);
+    }
+
+    modem.checkLinks();
+    if (pending.empty()) {
+      int ready = modem.available();
+      while (ready-- > 0) { pending += static_cast<char>(modem.read()); }
+    }
+    if (!pending.empty()) {
+      n = write(master_fd, pending.data(), pending.size());
+      if (n > 0) { pending.erase(0, n); }
+    }
+
+    if (stats_s && millis() - stats_ms >= stats_s * 1000) {
+      double secs = (millis() - stats_ms) / 1000.0;
+      fprintf(stderr,
+              "connections %u, dropped %u, commands %u, "
+              "in %.0f B/s, out %.0f B/s\n",
+              modem.connections, modem.drops, modem.commandCount(),
+              (modem.bytesToModem() - last_in) / secs,
+              (modem.bytesFromModem() - last_out) / secs);
+      last_in  = modem.bytesToModem();
+      last_out = modem.bytesFromModem();
+      stats_ms = millis();
+    }
+  }
+
+  fprintf(stderr, "connections %u, dropped %u, commands %u, in %u B, "
+          "out %u B\n",
+          modem.connections, modem.drops, modem.commandCount(),
+          modem.bytesToModem(), modem.bytesFromModem());
+  if (link_path) { unlink(link_path); }
+  close(master_fd);
+  close(slave_fd);
+  return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file       TraceDump.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Prints a trace written by TinyGsmTrace::dump() as text, one message per
+ * line, as DBG() would have printed it.
+ *
+ *   trace_dump <trace>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "TinyGsmTrace.h"
+
+namespace {
+bool readVarint(FILE* f, uint64_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 70; shift += 7) {
+    int b = fgetc(f);
+    if (b < 0) { return false; }
+    value |= static_cast<uint64_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) { return true; }
+  }
+  return false;
+}
+
+// Appends the argument with the tag to the line
+bool readArg(FILE* f, int tag, std::string& line) {
+  char     buf[32];
+  uint64_t value;
+  switch (tag) {
+    case TinyGsmTrace::STRING: {
+      int len = fgetc(f);
+      if (len < 0) { return false; }
+      std::string text(len, '\0');
+      if (len && fread(&text[0], 1, len, f) != static_cast<size_t>(len)) {
+        return false;
+      }
+      line += text;
+      return true;
+    }
+    case TinyGsmTrace::INT:
+      if (!readVarint(f, value)) { return false; }
+      snprintf(buf, sizeof(buf), "%lld",
+               static_cast<long long>(value >> 1) ^
+                   -static_cast<long long>(value & 1));
+      line += buf;
+      return true;
+    case TinyGsmTrace::UINT:
+      if (!readVarint(f, value)) { return false; }
+      snprintf(buf, sizeof(buf), "%llu",
+               static_cast<unsigned long long>(value));
+      line += buf;
+      return true;
+    case TinyGsmTrace::CHAR: {
+      int c = fgetc(f);
+      if (c < 0) { return false; }
+      line += static_cast<char>(c);
+      return true;
+    }
+    case TinyGsmTrace::FLOAT: {
+      float v;
+      if (fread(&v, 1, 4, f) != 4) { return false; }
+      snprintf(buf, sizeof(buf), "%.2f", v);
+      line += buf;
+      return true;
+    }
+    default: return false;  // Pointers never make it into a dump
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+    return 2;
+  }
+  FILE* f = fopen(argv[1], "rb");
+  if (!f) {
+    fprintf(stderr, "Can't read %s\n", argv[1]);
+    return 2;
+  }
+  char magic[8];
+  if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+      memcmp(magic, TINY_GSM_TRACE_MAGIC, sizeof(magic))) {
+    fprintf(stderr, "%s is not a trace\n", argv[1]);
+    fclose(f);
+    return 2;
+  }
+
+  uint32_t messages = 0;
+  uint8_t  time[4];
+  while (fread(time, 1, sizeof(time), f) == sizeof(time)) {
+    uint32_t ms = time[0] | time[1] << 8 | time[2] << 16 |
+        static_cast<uint32_t>(time[3]) << 24;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "[%u]", ms);
+    std::string line = buf;
+    int         tag;
+    while ((tag = fgetc(f)) > TinyGsmTrace::END) {
+      line += ' ';
+      if (!readArg(f, tag, line)) {
+        fprintf(stderr, "Bad message at %ld\n", ftell(f));
+        fclose(f);
+        return 1;
+      }
+    }
+    if (tag < 0) {
+      fprintf(stderr, "Truncated message at %ld\n", ftell(f));
+      fclose(f);
+      return 1;
+    }
+    printf("%s\n", line.c_str());
+    messages++;
+  }
+  fclose(f);
+  printf("%u messages\n", messages);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file       TrafficDump.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Prints a traffic log made by TinyGsmRecorder (or AT_Spy) as text, one
+ * record per line with its time in ms and direction, ">>" to the modem and
+ * "<<" from it, followed by how much went each way.
+ *
+ *   traffic_dump <log>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "TinyGsmRecorder.h"
+
+namespace {
+bool readVarint(FILE* f, uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    int b = fgetc(f);
+    if (b < 0) { return false; }
+    value |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) { return true; }
+  }
+  return false;
+}
+
+// The bytes as they would be written in C, with the line endings kept
+// visible
+std::string escape(const std::string& data) {
+  std::string out;
+  char        buf[8];
+  for (size_t i = 0; i < data.size(); i++) {
+    uint8_t c = data[i];
+    switch (c) {
+      case '\r': out += "\\r"; break;
+      case '\n': out += "\\n"; break;
+      case '\\': out += "\\\\"; break;
+      default:
+        if (c >= 0x20 && c < 0x7F) {
+          out += static_cast<char>(c);
+        } else {
+          snprintf(buf, sizeof(buf), "\\x%02X", c);
+          out += buf;
+        }
+        break;
+    }
+  }
+  return out;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <log>\n", argv[0]);
+    return 2;
+  }
+  FILE* f = fopen(argv[1], "rb");
+  if (!f) {
+    fprintf(stderr, "Can't read %s\n", argv[1]);
+    return 2;
+  }
+  char magic[8];
+  if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+      memcmp(magic, TINY_GSM_RECORDER_MAGIC, sizeof(magic))) {
+    fprintf(stderr, "%s is not a traffic log\n", argv[1]);
+    fclose(f);
+    return 2;
+  }
+
+  uint32_t now      = 0;
+  uint32_t records  = 0;
+  size_t   to_modem = 0;
+  size_t   from     = 0;
+  int      dir;
+  while ((dir = fgetc(f)) >= 0) {
+    uint32_t delta;
+    uint32_t size;
+    if (dir > TinyGsmTrafficLog::TO_MODEM || !readVarint(f, delta) ||
+        !readVarint(f, size)) {
+      fprintf(stderr, "Bad record at %ld\n", ftell(f));
+      fclose(f);
+      return 1;
+    }
+    std::string data(size, '\0');
+    if (size && fread(&data[0], 1, size, f) != size) {
+      fprintf(stderr, "Truncated record at %ld\n", ftell(f));
+      fclose(f);
+      return 1;
+    }
+    now += delta;
+    records++;
+    if (dir == TinyGsmTrafficLog::TO_MODEM) {
+      to_modem += size;
+    } else {
+      from += size;
+    }
+    printf("%10.3f %s %s\n", now / 1000.0,
+           dir == TinyGsmTrafficLog::TO_MODEM ? ">>" : "<<",
+           escape(data).c_str());
+  }
+  fclose(f);
+  printf("%u records over %.3f s, %zu bytes to the modem, %zu from it\n",
+         records, now / 1000.0, to_modem, from);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file       Arduino.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "Arduino.h"
+#include "HostClock.h"
+
+#include <stdio.h>
+#include <time.h>
+
+HostSerial Serial;
+
+namespace {
+bool     virtual_clock = false;
+uint64_t virtual_us    = 0;
+uint32_t yield_step_us = 1000;
+
+uint64_t realMicros() {
+  static uint64_t start = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = static_cast<uint64_t>(ts.tv_sec) * 1000000ULL +
+      static_cast<uint64_t>(ts.tv_nsec) / 1000ULL;
+  if (!start) start = now;
+  return now - start;
+}
+
+uint64_t monotonicMicros() {
+  // Each look at the virtual clock moves it on a little, so that loops
+  // polling it without yielding still time out
+  if (virtual_clock) { return virtual_us++; }
+  return realMicros();
+}
+}  // namespace
+
+/*
+ * Virtual clock
+ */
+
+void hostClockSetVirtual(bool on) {
+  // On a whole millisecond, so how the clock's reads fall on millis() is
+  // the same every time
+  if (on && !virtual_clock) { virtual_us = realMicros() / 1000 * 1000; }
+  virtual_clock = on;
+}
+
+bool hostClockIsVirtual() {
+  return virtual_clock;
+}
+
+void hostClockAdvance(uint32_t us) {
+  virtual_us += us;
+}
+
+void hostClockSetYieldStep(uint32_t us) {
+  yield_step_us = us;
+}
+
+/*
+ * Timing
+ */
+
+uint32_t millis(void) {
+  return static_cast<uint32_t>(monotonicMicros() / 1000ULL);
+}
+
+uint32_t micros(void) {
+  return static_cast<uint32_t>(monotonicMicros());
+}
+
+void delay(uint32_t ms) {
+  // delay(0) is how the library yields while polling, it must not sleep
+  if (ms == 0) {
+    yield();
+    return;
+  }
+  delayMicroseconds(ms * 1000UL);
+}
+
+void delayMicroseconds(uint32_t us) {
+  if (virtual_clock) {
+    virtual_us += us;
+    return;
+  }
+  struct timespec ts;
+  ts.tv_sec  = us / 1000000UL;
+  ts.tv_nsec = (us % 1000000UL) * 1000UL;
+  while (nanosleep(&ts, &ts) != 0) {}
+}
+
+void yield(void) {
+  if (virtual_clock) { virtual_us += yield_step_us; }
+}
+
+/*
+ * Digital I/O - there are no pins on a host, so these do nothing
+ */
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t) {
+  return LOW;
+}
+
+/*
+ * Serial
+ */
+
+size_t HostSerial::write(uint8_t c) {
+  return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HostSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HostSerial::flush() {
+  fflush(stdout);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file       Arduino.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Minimal Arduino core replacement used for building TinyGSM on a host
+ * (Linux) machine.  Only the parts of the core used by the library, its
+ * examples and tools are provided.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define constrain(amt, low, high) \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t millis(void);
+uint32_t micros(void);
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+void     yield(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+inline bool isDigit(int c) {
+  return isdigit(c) != 0;
+}
+inline bool isAlpha(int c) {
+  return isalpha(c) != 0;
+}
+inline bool isAlphaNumeric(int c) {
+  return isalnum(c) != 0;
+}
+inline bool isHexadecimalDigit(int c) {
+  return isxdigit(c) != 0;
+}
+inline bool isWhitespace(int c) {
+  return c == ' ' || c == '\t';
+}
+
+#include "WString.h"
+#include "Printable.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HostSerial.h"
+
+#endif  // Arduino_h
@@ -0,0 +1,15 @@
+/**
+ * @file       Client.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#ifndef HostClient_h
+#define HostClient_h
+
+// The Client and IPAddress classes are shared with the Hologram Dash build
+#include "ArduinoCompat/Client.h"
+
+#endif  // HostClient_h
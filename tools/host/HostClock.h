@@ -0,0 +1,33 @@
+/**
+ * @file       HostClock.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A virtual clock for millis(), micros() and delay() of the host build, so
+ * a run waiting out a 60 second timeout takes no real time.  Time stands
+ * still until something moves it on: delay() jumps ahead by the delay,
+ * yield() (and so TINY_GSM_YIELD) by the yield step, and every read of the
+ * clock by a microsecond, so loops polling millis() without yielding end
+ * too.  The ModemEmulator times its replies by the same clock.
+ */
+
+#ifndef HostClock_h
+#define HostClock_h
+
+#include <stdint.h>
+
+// Switches between the real monotonic clock and the virtual one, best done
+// once before the modem is used; the virtual clock starts from the time it
+// was switched on at
+void hostClockSetVirtual(bool on);
+bool hostClockIsVirtual();
+
+// Moves the virtual clock on, ie to time out a wait from outside
+void hostClockAdvance(uint32_t us);
+
+// How far yield() moves the virtual clock, 1000 us by default
+void hostClockSetYieldStep(uint32_t us);
+
+#endif  // HostClock_h
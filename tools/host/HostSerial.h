@@ -0,0 +1,44 @@
+/**
+ * @file       HostSerial.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Stand-in for the board's hardware serial port: output goes to stdout and
+ * nothing is ever received.
+ */
+
+#ifndef HostSerial_h
+#define HostSerial_h
+
+#include "Stream.h"
+
+class HostSerial : public Stream {
+ public:
+  void begin(uint32_t) {}
+  void end() {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+  int available() override {
+    return 0;
+  }
+  int read() override {
+    return -1;
+  }
+  int peek() override {
+    return -1;
+  }
+  void flush() override;
+
+  operator bool() {
+    return true;
+  }
+};
+
+extern HostSerial Serial;
+
+#endif  // HostSerial_h
@@ -0,0 +1,248 @@
+/**
+ * @file       LinuxSerialStream.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "LinuxSerialStream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+// How long a write waits for the kernel to take more output
+const uint32_t kWriteTimeoutMs = 1000;
+
+speed_t speedFor(uint32_t baud) {
+  switch (baud) {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default: return B0;
+  }
+}
+}  // namespace
+
+LinuxSerialStream::LinuxSerialStream()
+    : port_fd(-1),
+      epoll_fd(-1),
+      own_fd(false),
+      rx_head(0),
+      rx_tail(0),
+      tx_len(0),
+      read_calls(0),
+      write_calls(0) {}
+
+LinuxSerialStream::~LinuxSerialStream() {
+  end();
+}
+
+bool LinuxSerialStream::begin(const char* path, uint32_t baud) {
+  end();
+  int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) { return false; }
+  if (!attach(fd, true)) { return false; }
+  if (!setBaud(baud)) {
+    end();
+    return false;
+  }
+  // Drop whatever was waiting from before the port was opened
+  tcflush(port_fd, TCIOFLUSH);
+  return true;
+}
+
+void LinuxSerialStream::begin(uint32_t baud) {
+  flush();
+  setBaud(baud);
+}
+
+bool LinuxSerialStream::attach(int fd, bool own) {
+  end();
+  port_fd = fd;
+  own_fd  = own;
+
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    end();
+    return false;
+  }
+
+  // Raw 8N1, no flow control, reads never block
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    end();
+    return false;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = EPOLLIN;
+  ev.data.fd = fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void LinuxSerialStream::end() {
+  if (port_fd >= 0) { flush(); }
+  if (epoll_fd >= 0) { close(epoll_fd); }
+  if (port_fd >= 0 && own_fd) { close(port_fd); }
+  port_fd  = -1;
+  epoll_fd = -1;
+  own_fd   = false;
+  rx_head  = 0;
+  rx_tail  = 0;
+  tx_len   = 0;
+}
+
+bool LinuxSerialStream::setBaud(uint32_t baud) {
+  speed_t speed = speedFor(baud);
+  if (port_fd < 0 || speed == B0) { return false; }
+  struct termios tio;
+  if (tcgetattr(port_fd, &tio) != 0) { return false; }
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  return tcsetattr(port_fd, TCSANOW, &tio) == 0;
+}
+
+/*
+ * Reading
+ */
+
+size_t LinuxSerialStream::pump() {
+  if (port_fd < 0) { return 0; }
+  // Whatever was gathered goes out before waiting on an answer to it
+  if (tx_len) { flush(); }
+  if (rx_head == rx_tail) {
+    rx_head = 0;
+    rx_tail = 0;
+  } else if (rx_tail == sizeof(rx_buf) && rx_head > 0) {
+    memmove(rx_buf, rx_buf + rx_head, rx_tail - rx_head);
+    rx_tail -= rx_head;
+    rx_head = 0;
+  }
+  if (rx_tail == sizeof(rx_buf)) { return 0; }
+  read_calls++;
+  ssize_t n = ::read(port_fd, rx_buf + rx_tail, sizeof(rx_buf) - rx_tail);
+  if (n <= 0) { return 0; }
+  rx_tail += n;
+  return n;
+}
+
+bool LinuxSerialStream::waitReadable(uint32_t timeout_ms) {
+  if (rx_head != rx_tail) { return true; }
+  if (tx_len) { flush(); }
+  return waitFor(EPOLLIN, timeout_ms) && pump() > 0;
+}
+
+bool LinuxSerialStream::waitFor(uint32_t events, uint32_t timeout_ms) {
+  if (epoll_fd < 0) { return false; }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = events;
+  ev.data.fd = port_fd;
+  // The port is only watched for writing while a write waits, as it would
+  // otherwise always be ready
+  if (events != EPOLLIN) { epoll_ctl(epoll_fd, EPOLL_CTL_MOD, port_fd, &ev); }
+  int n;
+  do {
+    n = epoll_wait(epoll_fd, &ev, 1, timeout_ms);
+  } while (n < 0 && errno == EINTR);
+  if (events != EPOLLIN) {
+    ev.events  = EPOLLIN;
+    ev.data.fd = port_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, port_fd, &ev);
+  }
+  return n > 0;
+}
+
+int LinuxSerialStream::available() {
+  if (rx_head == rx_tail) { pump(); }
+  return rx_tail - rx_head;
+}
+
+int LinuxSerialStream::read() {
+  if (rx_head == rx_tail && !pump()) { return -1; }
+  return rx_buf[rx_head++];
+}
+
+int LinuxSerialStream::peek() {
+  if (rx_head == rx_tail && !pump()) { return -1; }
+  return rx_buf[rx_head];
+}
+
+/*
+ * Writing
+ */
+
+size_t LinuxSerialStream::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t LinuxSerialStream::write(const uint8_t* buffer, size_t size) {
+  if (port_fd < 0) { return 0; }
+  if (tx_len + size > sizeof(tx_buf)) {
+    flush();
+    // Too big to gather, it goes out as it is
+    if (size > sizeof(tx_buf)) { return writeAll(buffer, size) ? size : 0; }
+  }
+  memcpy(tx_buf + tx_len, buffer, size);
+  tx_len += size;
+  return size;
+}
+
+void LinuxSerialStream::flush() {
+  if (!tx_len) { return; }
+  writeAll(tx_buf, tx_len);
+  tx_len = 0;
+}
+
+bool LinuxSerialStream::writeAll(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    write_calls++;
+    ssize_t n = ::write(port_fd, data, len);
+    if (n > 0) {
+      data += n;
+      len -= n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && errno != EAGAIN) {
+      return false;
+    } else if (!waitFor(EPOLLOUT, kWriteTimeoutMs)) {
+      return false;
+    }
+  }
+  return true;
+}
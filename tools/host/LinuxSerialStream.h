@@ -0,0 +1,101 @@
+/**
+ * @file       LinuxSerialStream.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A Stream on a Linux serial device (or any tty, like one end of a pty
+ * pair), for running the library natively on a gateway.  The port is raw
+ * and non-blocking; reads fill a large buffer with as much as the kernel
+ * holds in one system call, and writes are gathered until the stream is
+ * flushed or read from, so a whole AT command goes out in one call.  The
+ * file descriptor is exposed for event loops, with pump() to take in what
+ * arrived when it polls readable.
+ */
+
+#ifndef LinuxSerialStream_h
+#define LinuxSerialStream_h
+
+#include <stdint.h>
+
+#include "Stream.h"
+
+#if !defined(LINUX_SERIAL_RX_BUFFER)
+#define LINUX_SERIAL_RX_BUFFER 4096
+#endif
+
+#if !defined(LINUX_SERIAL_TX_BUFFER)
+#define LINUX_SERIAL_TX_BUFFER 1024
+#endif
+
+class LinuxSerialStream : public Stream {
+ public:
+  LinuxSerialStream();
+  ~LinuxSerialStream();
+
+  // Opens the device, ie "/dev/ttyUSB0", as a raw 8N1 port
+  bool begin(const char* path, uint32_t baud = 115200);
+  // Changes the speed of the open port, as HardwareSerial::begin() does
+  void begin(uint32_t baud);
+  // Uses an already open tty, ie the slave of openpty(); it is closed by
+  // end() only if owned
+  bool attach(int fd, bool own = false);
+  void end();
+
+  // The file descriptor, -1 when closed, to watch for reading in an event
+  // loop
+  int fd() const {
+    return port_fd;
+  }
+  operator bool() const {
+    return port_fd >= 0;
+  }
+
+  // Moves whatever the kernel has received into the read buffer, returning
+  // the number of bytes taken; for an event loop to call when fd() polls
+  // readable
+  size_t pump();
+  // Waits until there is something to read, up to timeout_ms
+  bool waitReadable(uint32_t timeout_ms);
+
+  // System calls made on the port, to check the batching
+  uint32_t readCalls() const {
+    return read_calls;
+  }
+  uint32_t writeCalls() const {
+    return write_calls;
+  }
+
+  /*
+   * Stream
+   */
+  int    available() override;
+  int    read() override;
+  int    peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  // Hands the gathered output to the kernel, without waiting for the line
+  void flush() override;
+
+ protected:
+  bool setBaud(uint32_t baud);
+  bool writeAll(const uint8_t* data, size_t len);
+  bool waitFor(uint32_t events, uint32_t timeout_ms);
+
+  int  port_fd;
+  int  epoll_fd;
+  bool own_fd;
+
+  uint8_t rx_buf[LINUX_SERIAL_RX_BUFFER];
+  size_t  rx_head;  // Next byte to read
+  size_t  rx_tail;  // End of the received bytes
+  uint8_t tx_buf[LINUX_SERIAL_TX_BUFFER];
+  size_t  tx_len;
+
+  uint32_t read_calls;
+  uint32_t write_calls;
+};
+
+#endif  // LinuxSerialStream_h
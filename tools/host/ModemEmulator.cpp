@@ -0,0 +1,902 @@
+/**
+ * @file       ModemEmulator.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "ModemEmulator.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+
+namespace {
+// Largest read each module hands out for a single read command
+const size_t kSim800MaxRead  = 1460;
+const size_t kBg96MaxRead    = 1500;
+const size_t kSim7080MaxRead = 1460;
+// Largest +IPD the ESP8266 pushes, one TCP segment
+const size_t kEsp8266MaxPush = 1460;
+// Modules buffer a few kB per socket, more stays with the remote end until
+// there is room, so no more is ever reported as waiting
+const size_t kModuleBuffer = 8192;
+
+std::string toString(unsigned long value) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%lu", value);
+  return buf;
+}
+}  // namespace
+
+ModemEmulator::ModemEmulator(Dialect dialect)
+    : dialect(dialect),
+      default_reply("\r\nOK\r\n"),
+      keep_sent(false),
+      skip_lf(false),
+      data_mux(0),
+      data_len(0),
+      data_left(0),
+      out_pos(0),
+      line_free_us(0),
+      last_micros(0),
+      micros_high(0),
+      latency_ms(0),
+      byte_rate(0),
+      noise_chance(0),
+      noise_state(1),
+      connect_delay_ms(0),
+      connect_failure(0),
+      push_mux(0),
+      commands(0),
+      bytes_in(0),
+      bytes_out(0) {
+  for (uint8_t i = 0; i < kSockets; i++) {
+    sockets[i].open          = false;
+    sockets[i].remote_closed = false;
+    sockets[i].ever_open     = false;
+    sockets[i].read_pos      = 0;
+    sockets[i].sent_count    = 0;
+    sockets[i].open_us       = 0;
+  }
+}
+
+/*
+ * Rules
+ */
+
+void ModemEmulator::addRule(const char* command, const char* reply) {
+  Rule rule;
+  rule.command = command;
+  rule.reply   = reply;
+  rules.push_back(rule);
+}
+
+void ModemEmulator::clearRules() {
+  rules.clear();
+}
+
+bool ModemEmulator::loadScript(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { return false; }
+  char buf[1024];
+  while (fgets(buf, sizeof(buf), f)) {
+    std::string text(buf);
+    while (!text.empty() && (text[text.size() - 1] == '\n' ||
+                             text[text.size() - 1] == '\r')) {
+      text.erase(text.size() - 1);
+    }
+    if (text.empty() || text[0] == '#') { continue; }
+    size_t arrow = text.find(" => ");
+    if (arrow == std::string::npos) { continue; }
+    Rule rule;
+    rule.command = text.substr(0, arrow);
+    rule.reply   = unescape(text.substr(arrow + 4));
+    rules.push_back(rule);
+  }
+  fclose(f);
+  return true;
+}
+
+void ModemEmulator::setDefaultReply(const char* reply) {
+  default_reply = reply;
+}
+
+void ModemEmulator::queueUrc(const char* text, uint32_t delay_ms) {
+  Chunk chunk;
+  chunk.data     = text;
+  chunk.ready_us = nowMicros() + static_cast<uint64_t>(delay_ms) * 1000;
+  chunk.payload  = false;
+  timed.push_back(chunk);
+}
+
+/*
+ * Sockets
+ */
+
+void ModemEmulator::addIncoming(uint8_t mux, const uint8_t* data,
+                                size_t len) {
+  if (mux >= kSockets) { return; }
+  Socket& sock      = sockets[mux];
+  bool    was_empty = sock.read_pos >= sock.incoming.size();
+  sock.incoming.append(reinterpret_cast<const char*>(data), len);
+  // Modules only announce data arriving in an empty buffer
+  if (was_empty && sock.open) { dataReceived(mux); }
+}
+
+bool ModemEmulator::loadIncoming(uint8_t mux, const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { return false; }
+  std::string data;
+  char        buf[4096];
+  size_t      n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) { data.append(buf, n); }
+  fclose(f);
+  addIncoming(mux, reinterpret_cast<const uint8_t*>(data.data()),
+              data.size());
+  return true;
+}
+
+size_t ModemEmulator::incomingLeft(uint8_t mux) const {
+  if (mux >= kSockets) { return 0; }
+  return sockets[mux].incoming.size() - sockets[mux].read_pos;
+}
+
+void ModemEmulator::closeRemote(uint8_t mux) {
+  if (mux >= kSockets || !sockets[mux].open) { return; }
+  // The ESP8266 has nowhere to keep data, it all goes out before the close
+  if (dialect == ESP8266 && sockets[mux].open_us <= nowMicros()) {
+    while (incomingLeft(mux)) { pushIncoming(mux); }
+  }
+  sockets[mux].open          = false;
+  sockets[mux].remote_closed = true;
+  std::string id = toString(mux);
+  switch (dialect) {
+    case SIM800: socketUrc(mux, "\r\n" + id + ", CLOSED\r\n"); break;
+    case BG96: socketUrc(mux, "\r\n+QIURC: \"closed\"," + id + "\r\n"); break;
+    case SIM7080: socketUrc(mux, "\r\n+CASTATE: " + id + ",0\r\n"); break;
+    case ESP8266: socketUrc(mux, "\r\n" + id + ",CLOSED\r\n"); break;
+    default: break;
+  }
+}
+
+size_t ModemEmulator::bufferedIncoming(uint8_t mux) const {
+  size_t left = incomingLeft(mux);
+  return left < kModuleBuffer ? left : kModuleBuffer;
+}
+
+bool ModemEmulator::isOpen(uint8_t mux) const {
+  return mux < kSockets && sockets[mux].open;
+}
+
+const std::string& ModemEmulator::sentData(uint8_t mux) const {
+  return sockets[mux < kSockets ? mux : 0].sent;
+}
+
+uint32_t ModemEmulator::sentCount(uint8_t mux) const {
+  return mux < kSockets ? sockets[mux].sent_count : 0;
+}
+
+void ModemEmulator::keepSentData(bool keep) {
+  keep_sent = keep;
+}
+
+/*
+ * Impairments
+ */
+
+void ModemEmulator::setLatency(uint32_t ms) {
+  latency_ms = ms;
+}
+
+void ModemEmulator::setByteRate(uint32_t bytes_per_s) {
+  byte_rate = bytes_per_s;
+}
+
+void ModemEmulator::setNoise(float chance, uint32_t seed) {
+  noise_chance = chance;
+  noise_state  = seed ? seed : 1;
+}
+
+void ModemEmulator::setConnectDelay(uint32_t ms) {
+  connect_delay_ms = ms;
+}
+
+void ModemEmulator::setConnectFailure(float chance) {
+  connect_failure = chance;
+}
+
+/*
+ * Statistics
+ */
+
+void ModemEmulator::resetStats() {
+  commands  = 0;
+  bytes_in  = 0;
+  bytes_out = 0;
+}
+
+/*
+ * Stream
+ */
+
+int ModemEmulator::available() {
+  return readyBytes();
+}
+
+bool ModemEmulator::payloadNext() {
+  return readyBytes() && output.front().payload;
+}
+
+int ModemEmulator::read() {
+  if (!readyBytes()) { return -1; }
+  Chunk&  chunk = output.front();
+  uint8_t c     = chunk.data[out_pos++];
+  if (out_pos >= chunk.data.size()) {
+    output.pop_front();
+    out_pos = 0;
+  }
+  bytes_out++;
+  return c;
+}
+
+int ModemEmulator::peek() {
+  if (!readyBytes()) { return -1; }
+  return static_cast<uint8_t>(output.front().data[out_pos]);
+}
+
+size_t ModemEmulator::write(uint8_t c) {
+  bytes_in++;
+  // The LF after the CR ending a command belongs to the command, even when
+  // the command started a send
+  if (c == '\n' && skip_lf) {
+    skip_lf = false;
+    return 1;
+  }
+  skip_lf = false;
+  if (data_left > 0) {
+    // Data for a socket, after the send prompt
+    Socket& sock = sockets[data_mux];
+    sock.sent_count++;
+    if (keep_sent) { sock.sent += static_cast<char>(c); }
+    if (--data_left == 0) {
+      std::string id = toString(data_mux);
+      switch (dialect) {
+        case SIM800:
+          reply("\r\nDATA ACCEPT:" + id + "," + toString(data_len) + "\r\n");
+          break;
+        case BG96: reply("\r\nSEND OK\r\n"); break;
+        case ESP8266:
+          reply("\r\nRecv " + toString(data_len) +
+                " bytes\r\n\r\nSEND OK\r\n");
+          break;
+        default: reply("\r\nOK\r\n"); break;
+      }
+    }
+    return 1;
+  }
+  if (c == '\r' || c == '\n') {
+    skip_lf = c == '\r';
+    if (!line.empty()) {
+      std::string command;
+      command.swap(line);
+      dispatch(command);
+    }
+    return 1;
+  }
+  line += static_cast<char>(c);
+  return 1;
+}
+
+size_t ModemEmulator::write(const uint8_t* buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) { write(buffer[i]); }
+  return size;
+}
+
+/*
+ * Command handling
+ */
+
+void ModemEmulator::dispatch(const std::string& command) {
+  commands++;
+  for (size_t i = 0; i < rules.size(); i++) {
+    if (startsWith(command, rules[i].command.c_str())) {
+      reply(rules[i].reply);
+      return;
+    }
+  }
+  if (command.size() < 2 || (command[0] != 'A' && command[0] != 'a') ||
+      (command[1] != 'T' && command[1] != 't')) {
+    return;  // Not a command, real modules ignore it too
+  }
+  std::string cmd = command.substr(2);
+  bool        handled = false;
+  switch (dialect) {
+    case SIM800: handled = handleSim800(cmd); break;
+    case BG96: handled = handleBg96(cmd); break;
+    case SIM7080: handled = handleSim7080(cmd); break;
+    case ESP8266: handled = handleEsp8266(cmd); break;
+    default: break;
+  }
+  if (!handled) { reply(default_reply); }
+}
+
+void ModemEmulator::reply(const std::string& text) {
+  uint64_t ready_us = nowMicros() + static_cast<uint64_t>(latency_ms) * 1000;
+  reply(text, ready_us);
+}
+
+void ModemEmulator::reply(const std::string& text, uint64_t ready_us) {
+  std::string noise;
+  if (noise_chance > 0) {
+    if (roll(noise_chance)) {
+      // Lower case junk, which never ends like a response or a URC
+      static const char junk[] = "abcdefghijklmnopqrstuvwxyz0123456789 .,:";
+      noise = "\r\n";
+      uint8_t len = 4 + (noise_state >> 8) % 24;
+      for (uint8_t i = 0; i < len; i++) {
+        noise_state = noise_state * 1103515245UL + 12345UL;
+        noise += junk[(noise_state >> 16) % (sizeof(junk) - 1)];
+      }
+      noise += "\r\n";
+    }
+  }
+  push(noise + text, ready_us, false);
+}
+
+void ModemEmulator::replyData(const std::string& head, const std::string& data,
+                              const std::string& tail) {
+  reply(head);
+  // Noise never lands inside a reply
+  uint64_t ready_us = output.back().ready_us;
+  if (!data.empty()) { push(data, ready_us, true); }
+  push(tail, ready_us, false);
+}
+
+void ModemEmulator::push(const std::string& text, uint64_t ready_us,
+                         bool payload) {
+  if (text.empty()) { return; }
+  Chunk chunk;
+  chunk.data    = text;
+  chunk.payload = payload;
+  // The serial line sends one reply after the other
+  if (byte_rate && ready_us < line_free_us) { ready_us = line_free_us; }
+  chunk.ready_us = ready_us;
+  if (byte_rate) {
+    line_free_us = ready_us + chunk.data.size() * 1000000ULL / byte_rate;
+  }
+  output.push_back(chunk);
+}
+
+void ModemEmulator::dataReceived(uint8_t mux) {
+  if (incomingLeft(mux) == 0) { return; }
+  std::string id = toString(mux);
+  switch (dialect) {
+    case SIM800: socketUrc(mux, "\r\n+CIPRXGET: 1," + id + "\r\n"); break;
+    case BG96: socketUrc(mux, "\r\n+QIURC: \"recv\"," + id + "\r\n"); break;
+    case SIM7080: socketUrc(mux, "\r\n+CADATAIND: " + id + "\r\n"); break;
+    default: break;  // The ESP8266 pushes the data itself
+  }
+}
+
+void ModemEmulator::socketUrc(uint8_t mux, const std::string& text) {
+  uint64_t open_us = sockets[mux].open_us;
+  if (open_us <= nowMicros()) {
+    reply(text);
+    return;
+  }
+  Chunk chunk;
+  chunk.data     = text;
+  chunk.ready_us = open_us;
+  chunk.payload  = false;
+  timed.push_back(chunk);
+}
+
+void ModemEmulator::pushIncoming(uint8_t mux) {
+  std::string data = takeIncoming(mux, kEsp8266MaxPush);
+  if (data.empty()) { return; }
+  // Pushed as the data comes in, the reply latency has nothing to do with it
+  reply("\r\n+IPD," + toString(mux) + "," + toString(data.size()) + ":",
+        nowMicros());
+  push(data, output.back().ready_us, true);
+}
+
+void ModemEmulator::pushPending() {
+  // One +IPD at a time, once the driver has read everything before it and
+  // is not in the middle of a send
+  if (!output.empty() || data_left > 0) { return; }
+  uint64_t now = nowMicros();
+  for (uint8_t i = 0; i < kSockets; i++) {
+    uint8_t mux = (push_mux + i) % kSockets;
+    if (!sockets[mux].open || sockets[mux].open_us > now ||
+        incomingLeft(mux) == 0) {
+      continue;
+    }
+    pushIncoming(mux);
+    push_mux = (mux + 1) % kSockets;
+    return;
+  }
+}
+
+/*
+ * SIM800 family
+ */
+
+bool ModemEmulator::handleSim800(const std::string& cmd) {
+  if (cmd == "+CIPSTATUS") {
+    // All six connections, used or not
+    std::string text = "\r\nOK\r\n\r\nSTATE: IP PROCESSING\r\n";
+    for (uint8_t mux = 0; mux < 6; mux++) {
+      const Socket& sock = sockets[mux];
+      text += "\r\nC: " + toString(mux);
+      if (sock.ever_open) {
+        text += ",0,\"TCP\",\"10.0.0.1\",\"80\",";
+        text += sock.open ? "\"CONNECTED\"" : "\"CLOSED\"";
+      } else {
+        text += ",,\"\",\"\",\"\",\"INITIAL\"";
+      }
+      text += "\r\n";
+    }
+    reply(text);
+    return true;
+  }
+
+  std::vector<std::string> args = splitArgs(cmd);
+  uint8_t mux = args.size() > 0 ? atoi(args[0].c_str()) : 0;
+  if (startsWith(cmd, "+CIPRXGET=")) {
+    // The mode comes first for this one
+    int mode = mux;
+    mux      = args.size() > 1 ? atoi(args[1].c_str()) : 0;
+    if (mode == 1) { return false; }
+    if (mux >= kSockets || !sockets[mux].ever_open || mode == 3) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    if (mode == 4) {
+      reply("\r\n+CIPRXGET: 4," + toString(mux) + "," +
+            toString(bufferedIncoming(mux)) + "\r\n\r\nOK\r\n");
+      return true;
+    }
+    size_t      size = args.size() > 2 ? atoi(args[2].c_str()) : 0;
+    std::string data = takeIncoming(mux, size < kSim800MaxRead ? size
+                                                               : kSim800MaxRead);
+    replyData("\r\n+CIPRXGET: 2," + toString(mux) + "," +
+                  toString(data.size()) + "," +
+                  toString(bufferedIncoming(mux)) + "\r\n",
+              data, "\r\nOK\r\n");
+    return true;
+  }
+  if (mux >= kSockets) { return false; }
+  std::string id = toString(mux);
+  if (startsWith(cmd, "+CIPSTART=")) {
+    if (sockets[mux].open) {
+      reply("\r\nOK\r\n\r\n" + id + ", ALREADY CONNECT\r\n");
+      return true;
+    }
+    reply("\r\nOK\r\n");
+    connectResult(mux, "\r\n" + id + ", CONNECT OK\r\n",
+                  "\r\n" + id + ", CONNECT FAIL\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+CIPSEND=")) {
+    if (!sockets[mux].open || args.size() < 2) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    reply("\r\n> ");
+    startData(mux, atoi(args[1].c_str()));
+    return true;
+  }
+  if (startsWith(cmd, "+CIPSTATUS=")) {
+    const Socket& sock  = sockets[mux];
+    const char*   state = sock.open ? "CONNECTED"
+                                    : (sock.ever_open ? "CLOSED" : "INITIAL");
+    reply("\r\n+CIPSTATUS: " + id + ",0,\"TCP\",\"10.0.0.1\",\"80\",\"" +
+          state + "\"\r\n\r\nOK\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+CIPCLOSE=")) {
+    if (!sockets[mux].open) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    closeSocket(mux);
+    reply("\r\n" + id + ", CLOSE OK\r\n");
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Quectel BG96 family
+ */
+
+bool ModemEmulator::handleBg96(const std::string& cmd) {
+  std::vector<std::string> args = splitArgs(cmd);
+  if (startsWith(cmd, "+QISTATE=0")) {
+    // Every connection on the context
+    std::string text;
+    for (uint8_t mux = 0; mux < kSockets; mux++) {
+      const Socket& sock = sockets[mux];
+      if (!sock.open && !sock.remote_closed) { continue; }
+      text += "\r\n+QISTATE: " + toString(mux) +
+          ",\"TCP\",\"10.0.0.1\",80,5000," + (sock.open ? "2" : "4") +
+          ",1," + toString(mux) + ",0,\"uart1\"\r\n";
+    }
+    reply(text + "\r\nOK\r\n");
+    return true;
+  }
+  // The socket is the second argument of +QIOPEN and +QISTATE=1
+  bool    second = startsWith(cmd, "+QIOPEN=") || startsWith(cmd, "+QISTATE=");
+  uint8_t mux    = 0;
+  if (args.size() > (second ? 1 : 0)) {
+    mux = atoi(args[second ? 1 : 0].c_str());
+  }
+  if (mux >= kSockets) { return false; }
+  std::string id = toString(mux);
+  if (startsWith(cmd, "+QIOPEN=")) {
+    // Result 563 is "socket identity has been used", 566 is "socket connect
+    // failed"
+    reply("\r\nOK\r\n");
+    if (sockets[mux].open) {
+      reply("\r\n+QIOPEN: " + id + ",563\r\n");
+      return true;
+    }
+    connectResult(mux, "\r\n+QIOPEN: " + id + ",0\r\n",
+                  "\r\n+QIOPEN: " + id + ",566\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+QISEND=")) {
+    if (!sockets[mux].open || args.size() < 2) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    reply("\r\n> ");
+    startData(mux, atoi(args[1].c_str()));
+    return true;
+  }
+  if (startsWith(cmd, "+QIRD=")) {
+    const Socket& sock = sockets[mux];
+    if (!sock.ever_open) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    size_t size = args.size() > 1 ? atoi(args[1].c_str()) : kBg96MaxRead;
+    if (size == 0) {
+      // +QIRD: <total_receive_length>,<have_read_length>,<unread_length>
+      reply("\r\n+QIRD: " + toString(sock.read_pos + bufferedIncoming(mux)) +
+            "," + toString(sock.read_pos) + "," +
+            toString(bufferedIncoming(mux)) + "\r\n\r\nOK\r\n");
+      return true;
+    }
+    std::string data = takeIncoming(mux, size < kBg96MaxRead ? size
+                                                             : kBg96MaxRead);
+    replyData("\r\n+QIRD: " + toString(data.size()) + "\r\n", data,
+              "\r\n\r\nOK\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+QISTATE=")) {
+    const Socket& sock = sockets[mux];
+    std::string   text;
+    if (sock.open || sock.remote_closed) {
+      text = "\r\n+QISTATE: " + id + ",\"TCP\",\"10.0.0.1\",80,5000," +
+          (sock.open ? "2" : "4") + ",1," + id + ",0,\"uart1\"\r\n";
+    }
+    reply(text + "\r\nOK\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+QICLOSE=")) {
+    closeSocket(mux);
+    reply("\r\nOK\r\n");
+    return true;
+  }
+  return false;
+}
+
+/*
+ * SIM7070/SIM7080/SIM7090 family
+ */
+
+bool ModemEmulator::handleSim7080(const std::string& cmd) {
+  if (cmd == "+CARECV?") {
+    // Only the connections with data waiting are listed
+    std::string text;
+    for (uint8_t mux = 0; mux < kSockets; mux++) {
+      if (incomingLeft(mux) == 0) { continue; }
+      text += "\r\n+CARECV: " + toString(mux) + "," +
+          toString(bufferedIncoming(mux)) + "\r\n";
+    }
+    reply(text + "\r\nOK\r\n");
+    return true;
+  }
+  if (cmd == "+CASTATE?") {
+    std::string text;
+    for (uint8_t mux = 0; mux < kSockets; mux++) {
+      const Socket& sock = sockets[mux];
+      if (!sock.open && !sock.remote_closed) { continue; }
+      text += "\r\n+CASTATE: " + toString(mux) + (sock.open ? ",1" : ",0") +
+          "\r\n";
+    }
+    reply(text + "\r\nOK\r\n");
+    return true;
+  }
+
+  std::vector<std::string> args = splitArgs(cmd);
+  uint8_t mux = args.size() > 0 ? atoi(args[0].c_str()) : 0;
+  if (mux >= kSockets) { return false; }
+  std::string id = toString(mux);
+  if (startsWith(cmd, "+CAOPEN=")) {
+    // Result 1 is a socket error
+    if (sockets[mux].open) {
+      reply("\r\n+CAOPEN: " + id + ",1\r\n\r\nOK\r\n");
+      return true;
+    }
+    connectResult(mux, "\r\n+CAOPEN: " + id + ",0\r\n\r\nOK\r\n",
+                  "\r\n+CAOPEN: " + id + ",1\r\n\r\nOK\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+CASEND=")) {
+    if (!sockets[mux].open || args.size() < 2) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    reply("\r\n>");
+    startData(mux, atoi(args[1].c_str()));
+    return true;
+  }
+  if (startsWith(cmd, "+CARECV=")) {
+    if (!sockets[mux].ever_open) {
+      reply("\r\nERROR\r\n");
+      return true;
+    }
+    size_t size = args.size() > 1 ? atoi(args[1].c_str()) : kSim7080MaxRead;
+    std::string data = takeIncoming(
+        mux, size < kSim7080MaxRead ? size : kSim7080MaxRead);
+    if (data.empty()) {
+      reply("\r\n+CARECV: 0\r\n\r\nOK\r\n");
+    } else {
+      replyData("\r\n+CARECV: " + toString(data.size()) + ",", data,
+                "\r\n\r\nOK\r\n");
+    }
+    return true;
+  }
+  if (startsWith(cmd, "+CACLOSE=")) {
+    closeSocket(mux);
+    reply("\r\nOK\r\n");
+    return true;
+  }
+  return false;
+}
+
+/*
+ * ESP8266
+ */
+
+bool ModemEmulator::handleEsp8266(const std::string& cmd) {
+  if (cmd == "+CIPSTATUS") {
+    // Status 3 while there are connections, 2 with only an address
+    std::string text;
+    for (uint8_t mux = 0; mux < kSockets; mux++) {
+      if (!sockets[mux].open) { continue; }
+      text += "+CIPSTATUS:" + toString(mux) +
+          ",\"TCP\",\"10.0.0.1\",80,50000,0\r\n";
+    }
+    reply(std::string("\r\nSTATUS:") + (text.empty() ? "2" : "3") +
+          "\r\n" + text + "\r\nOK\r\n");
+    return true;
+  }
+
+  std::vector<std::string> args = splitArgs(cmd);
+  uint8_t mux = args.size() > 0 ? atoi(args[0].c_str()) : 0;
+  if (mux >= kSockets) { return false; }
+  std::string id = toString(mux);
+  if (startsWith(cmd, "+CIPSTART=")) {
+    if (sockets[mux].open) {
+      reply("\r\nALREADY CONNECTED\r\n\r\nERROR\r\n");
+      return true;
+    }
+    connectResult(mux, "\r\n" + id + ",CONNECT\r\n\r\nOK\r\n",
+                  "\r\n" + id + ",CLOSED\r\n\r\nERROR\r\n");
+    return true;
+  }
+  if (startsWith(cmd, "+CIPSEND=")) {
+    if (!sockets[mux].open || args.size() < 2) {
+      reply("\r\nlink is not valid\r\n\r\nERROR\r\n");
+      return true;
+    }
+    reply("\r\nOK\r\n> ");
+    startData(mux, atoi(args[1].c_str()));
+    return true;
+  }
+  if (startsWith(cmd, "+CIPCLOSE=")) {
+    if (!sockets[mux].open) {
+      reply("\r\nUNLINK\r\n\r\nERROR\r\n");
+      return true;
+    }
+    closeSocket(mux);
+    reply("\r\n" + id + ",CLOSED\r\n\r\nOK\r\n");
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Socket helpers
+ */
+
+void ModemEmulator::connectResult(uint8_t mux, const std::string& success,
+                                  const std::string& failure) {
+  uint64_t ready_us = nowMicros() +
+      (static_cast<uint64_t>(latency_ms) + connect_delay_ms) * 1000;
+  bool fails = connect_failure > 0 && roll(connect_failure);
+  if (!fails) {
+    openSocket(mux);
+    sockets[mux].open_us = ready_us;
+  }
+  const std::string& text = fails ? failure : success;
+  if (connect_delay_ms) {
+    Chunk chunk;
+    chunk.data     = text;
+    chunk.ready_us = ready_us;
+    chunk.payload  = false;
+    timed.push_back(chunk);
+  } else {
+    reply(text, ready_us);
+  }
+  if (fails) { return; }
+  // Data added by the hook to an empty socket is announced as it is added
+  bool waiting = incomingLeft(mux) > 0;
+  socketOpened(mux);
+  if (waiting) { dataReceived(mux); }
+}
+
+bool ModemEmulator::openSocket(uint8_t mux) {
+  Socket& sock = sockets[mux];
+  if (sock.open) { return false; }
+  sock.open          = true;
+  sock.remote_closed = false;
+  sock.ever_open     = true;
+  return true;
+}
+
+void ModemEmulator::closeSocket(uint8_t mux) {
+  Socket& sock = sockets[mux];
+  // Closing a connection throws away whatever was not read, while data
+  // added to a closed socket waits for the next connection
+  if (sock.open || sock.remote_closed) {
+    sock.incoming.clear();
+    sock.read_pos = 0;
+  }
+  sock.open          = false;
+  sock.remote_closed = false;
+}
+
+std::string ModemEmulator::takeIncoming(uint8_t mux, size_t max) {
+  Socket& sock = sockets[mux];
+  size_t  left = sock.incoming.size() - sock.read_pos;
+  size_t  n    = max < left ? max : left;
+  std::string data = sock.incoming.substr(sock.read_pos, n);
+  sock.read_pos += n;
+  if (sock.read_pos >= sock.incoming.size()) {
+    sock.incoming.clear();
+    sock.read_pos = 0;
+  }
+  return data;
+}
+
+void ModemEmulator::startData(uint8_t mux, size_t len) {
+  if (len == 0) { return; }
+  data_mux  = mux;
+  data_len  = len;
+  data_left = len;
+}
+
+bool ModemEmulator::startsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Splits the parameters after the '=' at the commas outside of quotes,
+// dropping the quotes
+std::vector<std::string> ModemEmulator::splitArgs(const std::string& cmd) {
+  std::vector<std::string> args;
+  size_t                   eq = cmd.find('=');
+  if (eq == std::string::npos) { return args; }
+  std::string arg;
+  bool        quoted = false;
+  for (size_t i = eq + 1; i < cmd.size(); i++) {
+    char c = cmd[i];
+    if (c == '"') {
+      quoted = !quoted;
+    } else if (c == ',' && !quoted) {
+      args.push_back(arg);
+      arg.clear();
+    } else {
+      arg += c;
+    }
+  }
+  args.push_back(arg);
+  return args;
+}
+
+std::string ModemEmulator::unescape(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] != '\\' || i + 1 >= s.size()) {
+      out += s[i];
+      continue;
+    }
+    char c = s[++i];
+    switch (c) {
+      case 'r': out += '\r'; break;
+      case 'n': out += '\n'; break;
+      case 't': out += '\t'; break;
+      case 'x':
+        if (i + 2 < s.size() && isxdigit(s[i + 1]) && isxdigit(s[i + 2])) {
+          out += static_cast<char>(
+              strtol(s.substr(i + 1, 2).c_str(), NULL, 16));
+          i += 2;
+        } else {
+          out += c;
+        }
+        break;
+      default: out += c; break;
+    }
+  }
+  return out;
+}
+
+/*
+ * Output timing
+ */
+
+bool ModemEmulator::roll(float chance) {
+  noise_state = noise_state * 1103515245UL + 12345UL;
+  return ((noise_state >> 16) & 0x7FFF) < chance * 32768;
+}
+
+void ModemEmulator::releaseTimed() {
+  if (timed.empty()) { return; }
+  uint64_t now = nowMicros();
+  for (size_t i = 0; i < timed.size();) {
+    if (timed[i].ready_us <= now) {
+      reply(timed[i].data, now);
+      timed.erase(timed.begin() + i);
+    } else {
+      i++;
+    }
+  }
+}
+
+size_t ModemEmulator::readyBytes() {
+  releaseTimed();
+  if (dialect == ESP8266) { pushPending(); }
+  if (output.empty()) { return 0; }
+  uint64_t now   = nowMicros();
+  size_t   ready = 0;
+  size_t   skip  = out_pos;
+  for (size_t i = 0; i < output.size(); i++) {
+    const Chunk& chunk = output[i];
+    if (chunk.ready_us > now) { break; }
+    size_t sent = chunk.data.size();
+    if (byte_rate) {
+      uint64_t on_line = (now - chunk.ready_us) * byte_rate / 1000000ULL;
+      if (on_line < sent) { sent = on_line; }
+    }
+    if (sent > skip) { ready += sent - skip; }
+    if (sent < chunk.data.size()) { break; }
+    skip = 0;
+  }
+  return ready;
+}
+
+uint64_t ModemEmulator::nowMicros() {
+  // Widens the wrapping 32 bit micros()
+  uint32_t now = micros();
+  if (now < last_micros) { micros_high += 1ULL << 32; }
+  last_micros = now;
+  return micros_high + now;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file       ModemEmulator.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A Stream that stands in for a modem on its serial port, for running the
+ * drivers on a PC without hardware.  Commands are answered from a table of
+ * rules, which can be loaded from a script file, and from a built-in model
+ * of the socket commands of the SIM800, BG96 and SIM7080 families and of
+ * the ESP8266.  Incoming socket data is served from memory or files and
+ * announced with the module's URC's, or pushed as +IPD by the ESP8266.
+ * Replies can be slowed down and mixed with noise, and connections can be
+ * slow to open or fail.
+ */
+
+#ifndef ModemEmulator_h
+#define ModemEmulator_h
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Stream.h"
+
+class ModemEmulator : public Stream {
+ public:
+  // The AT dialect used for the socket commands
+  enum Dialect {
+    GENERIC,  // Rules and the default reply only
+    SIM800,   // +CIPSTART, +CIPSEND, +CIPRXGET, +CIPSTATUS, +CIPCLOSE
+    BG96,     // +QIOPEN, +QISEND, +QIRD, +QISTATE, +QICLOSE
+    SIM7080,  // +CAOPEN, +CASEND, +CARECV, +CASTATE, +CACLOSE
+    ESP8266   // +CIPSTART, +CIPSEND, +IPD, +CIPSTATUS, +CIPCLOSE
+  };
+
+  static const uint8_t kSockets = 12;
+
+  explicit ModemEmulator(Dialect dialect = GENERIC);
+  virtual ~ModemEmulator() {}
+
+  /*
+   * Rules
+   */
+  // Answers every command starting with the given text (ie "AT+CSQ") with
+  // the reply, which is sent as is, so it needs its own line endings.
+  // Rules are checked in the order they were added and before the dialect.
+  void addRule(const char* command, const char* reply);
+  void clearRules();
+  // Loads rules from a script with one "<command> => <reply>" per line.
+  // The reply may use \r, \n, \t, \\ and \xNN escapes.  Empty lines and
+  // lines starting with # are skipped.
+  bool loadScript(const char* path);
+  // The reply to commands no rule or dialect handles
+  void setDefaultReply(const char* reply);
+
+  // Sends an unsolicited line after the given delay
+  void queueUrc(const char* text, uint32_t delay_ms = 0);
+
+  /*
+   * Sockets
+   */
+  // Data the remote end sends on a socket; it is announced with the data
+  // URC once the socket is open
+  void addIncoming(uint8_t mux, const uint8_t* data, size_t len);
+  bool loadIncoming(uint8_t mux, const char* path);
+  size_t incomingLeft(uint8_t mux) const;
+  // The remote end closes the socket, data not yet read stays readable
+  void closeRemote(uint8_t mux);
+  bool isOpen(uint8_t mux) const;
+  // Everything the driver sent on the socket, if kept
+  const std::string& sentData(uint8_t mux) const;
+  void keepSentData(bool keep);
+  // How many bytes the driver sent on the socket, kept or not
+  uint32_t sentCount(uint8_t mux) const;
+  // Whether the next byte read is socket data rather than part of a
+  // response, and whether written bytes go to a socket
+  bool payloadNext();
+  bool sendingData() const {
+    return data_left > 0;
+  }
+
+  /*
+   * Impairments
+   */
+  // Every reply is held back for this long
+  void setLatency(uint32_t ms);
+  // Limits the speed replies are read at, like the baud rate of a real
+  // serial port; 0 for no limit
+  void setByteRate(uint32_t bytes_per_s);
+  // Puts a line of junk before a reply with the given chance (0-1).  The
+  // junk is in lower case, so it never looks like a response or URC.
+  void setNoise(float chance, uint32_t seed = 1);
+  // Connections take this long to open, like a slow DNS lookup or
+  // handshake, before the result of the open command is sent
+  void setConnectDelay(uint32_t ms);
+  // Opening a connection fails with the given chance (0-1)
+  void setConnectFailure(float chance);
+
+  /*
+   * Statistics
+   */
+  uint32_t commandCount() const {
+    return commands;
+  }
+  uint32_t bytesToModem() const {
+    return bytes_in;
+  }
+  uint32_t bytesFromModem() const {
+    return bytes_out;
+  }
+  void resetStats();
+
+  /*
+   * Stream
+   */
+  int    available() override;
+  int    read() override;
+  int    peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override {}
+
+ protected:
+  struct Rule {
+    std::string command;
+    std::string reply;
+  };
+
+  struct Socket {
+    bool        open;
+    bool        remote_closed;
+    bool        ever_open;
+    std::string incoming;
+    size_t      read_pos;
+    std::string sent;
+    uint32_t    sent_count;
+    uint64_t    open_us;  // When the result of the connect goes out
+  };
+
+  // One piece of output, readable from ready_us on
+  struct Chunk {
+    std::string data;
+    uint64_t    ready_us;
+    bool        payload;  // Socket data inside a read response
+  };
+
+  void dispatch(const std::string& command);
+  void reply(const std::string& text);
+  void reply(const std::string& text, uint64_t ready_us);
+  // A read response carrying socket data
+  void replyData(const std::string& head, const std::string& data,
+                 const std::string& tail);
+  void push(const std::string& text, uint64_t ready_us, bool payload);
+  void dataReceived(uint8_t mux);
+  // A URC about a socket, held back until the result of its connect is out
+  void socketUrc(uint8_t mux, const std::string& text);
+  // Hands a chunk of the data waiting on a socket to the driver, as the
+  // ESP8266 does without being asked
+  void pushIncoming(uint8_t mux);
+  void pushPending();
+
+  bool handleSim800(const std::string& cmd);
+  bool handleBg96(const std::string& cmd);
+  bool handleSim7080(const std::string& cmd);
+  bool handleEsp8266(const std::string& cmd);
+
+  // Called when a connection opens, before the data waiting on it is
+  // announced, ie to give every new connection something to read
+  virtual void socketOpened(uint8_t mux) {}
+
+  // Socket helpers shared by the dialects
+  // Opens the socket and sends the result of the connect, after the connect
+  // delay, or sends the failure if the connect fails
+  void connectResult(uint8_t mux, const std::string& success,
+                     const std::string& failure);
+  bool        openSocket(uint8_t mux);
+  void        closeSocket(uint8_t mux);
+  std::string takeIncoming(uint8_t mux, size_t max);
+  void        startData(uint8_t mux, size_t len);
+  // What the module reports as waiting, at most one module buffer
+  size_t bufferedIncoming(uint8_t mux) const;
+
+  static bool startsWith(const std::string& s, const char* prefix);
+  static std::vector<std::string> splitArgs(const std::string& cmd);
+  static std::string              unescape(const std::string& s);
+
+  // Rolls the dice, true with the given chance (0-1)
+  bool     roll(float chance);
+  void     releaseTimed();
+  size_t   readyBytes();
+  uint64_t nowMicros();
+
+  Dialect           dialect;
+  std::vector<Rule> rules;
+  std::string       default_reply;
+  Socket            sockets[kSockets];
+  bool              keep_sent;
+
+  std::string line;       // The command being received
+  bool        skip_lf;    // The command ended with a CR, drop the LF
+  uint8_t     data_mux;   // The socket data is being sent on
+  size_t      data_len;   // Length of the data being sent
+  size_t      data_left;  // Bytes of data still to come, 0 in command mode
+
+  std::deque<Chunk>  output;        // Replies, oldest first
+  size_t             out_pos;       // Read position in output.front()
+  std::vector<Chunk> timed;         // URC's waiting for their time
+  uint64_t           line_free_us;  // When the last reply is fully sent
+
+  uint32_t last_micros;
+  uint64_t micros_high;
+
+  uint32_t latency_ms;
+  uint32_t byte_rate;
+  float    noise_chance;
+  uint32_t noise_state;
+  uint32_t connect_delay_ms;
+  float    connect_failure;
+  uint8_t  push_mux;  // The socket the ESP8266 pushes data from next
+
+  uint32_t commands;
+  uint32_t bytes_in;
+  uint32_t bytes_out;
+};
+
+#endif  // ModemEmulator_h
@@ -0,0 +1,24 @@
+/**
+ * @file       Sketch.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Builds an Arduino sketch as a host program: the .ino file named by
+ * TINY_GSM_HOST_SKETCH is compiled as C++ and run by the usual
+ * setup()/loop() main of the Arduino core.
+ */
+
+#include "Arduino.h"
+
+#include TINY_GSM_HOST_SKETCH
+
+int main() {
+  setup();
+  for (;;) {
+    loop();
+    yield();
+  }
+  return 0;
+}
@@ -0,0 +1,242 @@
+/**
+ * @file       Stream.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "Arduino.h"
+#include "Stream.h"
+
+#define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
+
+int Stream::timedRead() {
+  int c;
+  _startMillis = millis();
+  do {
+    c = read();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - _startMillis < _timeout);
+  return -1;  // -1 indicates timeout
+}
+
+int Stream::timedPeek() {
+  int c;
+  _startMillis = millis();
+  do {
+    c = peek();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - _startMillis < _timeout);
+  return -1;  // -1 indicates timeout
+}
+
+int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal) {
+  int c;
+  while (1) {
+    c = timedPeek();
+
+    if (c < 0 || c == '-' || (c >= '0' && c <= '9') ||
+        (detectDecimal && c == '.'))
+      return c;
+
+    switch (lookahead) {
+      case SKIP_NONE: return -1;  // Fail code.
+      case SKIP_WHITESPACE:
+        switch (c) {
+          case ' ':
+          case '\t':
+          case '\r':
+          case '\n': break;
+          default: return -1;  // Fail code.
+        }
+      case SKIP_ALL: break;
+    }
+    read();  // discard non-numeric
+  }
+}
+
+bool Stream::find(const char* target) {
+  return findUntil(target, strlen(target), NULL, 0);
+}
+
+bool Stream::find(const char* target, size_t length) {
+  return findUntil(target, length, NULL, 0);
+}
+
+bool Stream::findUntil(const char* target, const char* terminator) {
+  return findUntil(target, strlen(target), terminator, strlen(terminator));
+}
+
+bool Stream::findUntil(const char* target, size_t targetLen,
+                       const char* terminator, size_t termLen) {
+  if (terminator == NULL) {
+    MultiTarget t[1] = {{target, targetLen, 0}};
+    return findMulti(t, 1) == 0;
+  } else {
+    MultiTarget t[2] = {{target, targetLen, 0}, {terminator, termLen, 0}};
+    return findMulti(t, 2) == 0;
+  }
+}
+
+long Stream::parseInt(LookaheadMode lookahead, char ignore) {
+  bool isNegative = false;
+  long value      = 0;
+  int  c;
+
+  c = peekNextDigit(lookahead, false);
+  // ignore non numeric leading characters
+  if (c < 0) return 0;  // zero returned if timeout
+
+  do {
+    if (c == ignore) {
+      // ignore this character
+    } else if (c == '-') {
+      isNegative = true;
+    } else if (c >= '0' && c <= '9') {
+      value = value * 10 + c - '0';
+    }
+    read();  // consume the character we got with peek
+    c = timedPeek();
+  } while ((c >= '0' && c <= '9') || c == ignore);
+
+  if (isNegative) value = -value;
+  return value;
+}
+
+float Stream::parseFloat(LookaheadMode lookahead, char ignore) {
+  bool  isNegative = false;
+  bool  isFraction = false;
+  long  value      = 0;
+  int   c;
+  float fraction = 1.0;
+
+  c = peekNextDigit(lookahead, true);
+  // ignore non numeric leading characters
+  if (c < 0) return 0;  // zero returned if timeout
+
+  do {
+    if (c == ignore) {
+      // ignore
+    } else if (c == '-') {
+      isNegative = true;
+    } else if (c == '.') {
+      isFraction = true;
+    } else if (c >= '0' && c <= '9') {
+      value = value * 10 + c - '0';
+      if (isFraction) fraction *= 0.1;
+    }
+    read();  // consume the character we got with peek
+    c = timedPeek();
+  } while ((c >= '0' && c <= '9') || (c == '.' && !isFraction) ||
+           c == ignore);
+
+  if (isNegative) value = -value;
+  if (isFraction) return value * fraction;
+  return value;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = static_cast<char>(c);
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t index = 0;
+  while (index < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    *buffer++ = static_cast<char>(c);
+    index++;
+  }
+  return index;  // return number of characters, not including null terminator
+}
+
+String Stream::readString() {
+  String ret;
+  int    c = timedRead();
+  while (c >= 0) {
+    ret += static_cast<char>(c);
+    c = timedRead();
+  }
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int    c = timedRead();
+  while (c >= 0 && c != terminator) {
+    ret += static_cast<char>(c);
+    c = timedRead();
+  }
+  return ret;
+}
+
+int Stream::findMulti(struct Stream::MultiTarget* targets, int tCount) {
+  // any zero length target string automatically matches and would make
+  // a mess of the rest of the algorithm.
+  for (struct MultiTarget* t = targets; t < targets + tCount; ++t) {
+    if (t->len <= 0) return t - targets;
+  }
+
+  while (1) {
+    int c = timedRead();
+    if (c < 0) return -1;
+
+    for (struct MultiTarget* t = targets; t < targets + tCount; ++t) {
+      // the simple case is if we match, deal with that first.
+      if (c == t->str[t->index]) {
+        if (++t->index == t->len) {
+          return t - targets;
+        } else {
+          continue;
+        }
+      }
+
+      // if not we need to walk back and see if we could have matched further
+      // down the stream (ie '1112' doesn't match the first position in
+      // '11112' but it will match the second position so we can't just reset
+      // the current index to 0 when we find a mismatch.
+      if (t->index == 0) continue;
+
+      int origIndex = t->index;
+      do {
+        --t->index;
+        // first check if current char works against the new current index
+        if (c != t->str[t->index]) continue;
+
+        // if it's the only char then we're good, nothing more to check
+        if (t->index == 0) {
+          t->index++;
+          break;
+        }
+
+        // otherwise we need to check the rest of the found string
+        int diff = origIndex - t->index;
+        size_t i;
+        for (i = 0; i < t->index; ++i) {
+          if (t->str[i] != t->str[i + diff]) break;
+        }
+
+        // if we successfully got through the previous loop then our current
+        // index is good.
+        if (i == t->index) {
+          t->index++;
+          break;
+        }
+
+        // otherwise we just try the next index
+      } while (t->index);
+    }
+  }
+  // unreachable
+  return -1;
+}
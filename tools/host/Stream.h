@@ -0,0 +1,92 @@
+/**
+ * @file       Stream.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#ifndef Stream_h
+#define Stream_h
+
+#include <inttypes.h>
+
+#include "Print.h"
+
+// Lookahead options for parseInt and parseFloat
+enum LookaheadMode {
+  SKIP_ALL,   // All invalid characters are ignored.
+  SKIP_NONE,  // Nothing is skipped, the stream is not touched
+  SKIP_WHITESPACE  // Only tabs, spaces, line feeds & carriage returns skipped
+};
+
+#define NO_IGNORE_CHAR '\x01'
+
+class Stream : public Print {
+ protected:
+  uint32_t _timeout;      // number of milliseconds to wait for the next char
+  uint32_t _startMillis;  // used for timeout measurement
+  int      timedRead();   // read stream with timeout
+  int      timedPeek();   // peek stream with timeout
+  int      peekNextDigit(LookaheadMode lookahead, bool detectDecimal);
+
+ public:
+  virtual int available() = 0;
+  virtual int read()      = 0;
+  virtual int peek()      = 0;
+
+  Stream() : _timeout(1000), _startMillis(0) {}
+
+  void setTimeout(uint32_t timeout) {
+    _timeout = timeout;
+  }
+  uint32_t getTimeout(void) {
+    return _timeout;
+  }
+
+  bool find(const char* target);
+  bool find(const uint8_t* target) {
+    return find(reinterpret_cast<const char*>(target));
+  }
+  bool find(const char* target, size_t length);
+  bool find(const uint8_t* target, size_t length) {
+    return find(reinterpret_cast<const char*>(target), length);
+  }
+  bool find(char target) {
+    return find(&target, 1);
+  }
+
+  bool findUntil(const char* target, const char* terminator);
+  bool findUntil(const char* target, size_t targetLen, const char* terminate,
+                 size_t termLen);
+
+  long  parseInt(LookaheadMode lookahead = SKIP_ALL,
+                 char          ignore    = NO_IGNORE_CHAR);
+  float parseFloat(LookaheadMode lookahead = SKIP_ALL,
+                   char          ignore    = NO_IGNORE_CHAR);
+
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+    return readBytesUntil(terminator, reinterpret_cast<char*>(buffer), length);
+  }
+
+  String readString();
+  String readStringUntil(char terminator);
+
+ protected:
+  struct MultiTarget {
+    const char* str;    // string you're searching for
+    size_t      len;    // length of string you're searching for
+    size_t      index;  // index used by the search routine.
+  };
+
+  // Finds the first of several targets, returning its index or -1
+  int findMulti(struct MultiTarget* targets, int tCount);
+};
+
+#undef NO_IGNORE_CHAR
+#endif  // Stream_h
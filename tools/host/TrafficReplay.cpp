@@ -0,0 +1,177 @@
+/**
+ * @file       TrafficReplay.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "TrafficReplay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "TinyGsmRecorder.h"
+
+namespace {
+bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (p >= end) { return false; }
+    uint8_t b = *p++;
+    value |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) { return true; }
+  }
+  return false;
+}
+}  // namespace
+
+TrafficReplay::TrafficReplay()
+    : rx_total(0),
+      time_scale(0),
+      reply_idx(0),
+      reply_pos(0),
+      tx_pos(0),
+      command_idx(0),
+      anchor_us(0),
+      anchor_ms(0),
+      mismatched(0),
+      first_mismatch(-1),
+      last_micros(0),
+      micros_high(0) {}
+
+bool TrafficReplay::load(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { return false; }
+  std::string data;
+  char        buf[4096];
+  size_t      n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) { data.append(buf, n); }
+  fclose(f);
+  return load(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+bool TrafficReplay::load(const uint8_t* data, size_t len) {
+  replies.clear();
+  commands.clear();
+  tx_data.clear();
+  rx_total = 0;
+  const size_t magic_len = strlen(TINY_GSM_RECORDER_MAGIC);
+  if (len < magic_len || memcmp(data, TINY_GSM_RECORDER_MAGIC, magic_len)) {
+    return false;
+  }
+  const uint8_t* p   = data + magic_len;
+  const uint8_t* end = data + len;
+  uint32_t       now = 0;
+  while (p < end) {
+    uint8_t  dir = *p++;
+    uint32_t delta;
+    uint32_t size;
+    if (dir > TinyGsmTrafficLog::TO_MODEM || !readVarint(p, end, delta) ||
+        !readVarint(p, end, size) || size > static_cast<size_t>(end - p)) {
+      return false;  // Truncated or not a traffic log
+    }
+    now += delta;
+    if (dir == TinyGsmTrafficLog::TO_MODEM) {
+      tx_data.append(reinterpret_cast<const char*>(p), size);
+      Command command;
+      command.at_ms  = now;
+      command.tx_end = tx_data.size();
+      commands.push_back(command);
+    } else {
+      Reply reply;
+      reply.at_ms     = now;
+      reply.tx_before = tx_data.size();
+      reply.data.assign(reinterpret_cast<const char*>(p), size);
+      replies.push_back(reply);
+      rx_total += size;
+    }
+    p += size;
+  }
+  rewind();
+  return true;
+}
+
+void TrafficReplay::rewind() {
+  reply_idx      = 0;
+  reply_pos      = 0;
+  tx_pos         = 0;
+  command_idx    = 0;
+  anchor_us      = nowMicros();
+  anchor_ms      = 0;
+  mismatched     = 0;
+  first_mismatch = -1;
+}
+
+void TrafficReplay::setTimeScale(float scale) {
+  time_scale = scale;
+}
+
+bool TrafficReplay::finished() const {
+  return reply_idx >= replies.size();
+}
+
+bool TrafficReplay::released() {
+  if (reply_idx >= replies.size()) { return false; }
+  const Reply& reply = replies[reply_idx];
+  if (tx_pos < reply.tx_before) { return false; }
+  if (time_scale <= 0 || reply.at_ms <= anchor_ms) { return true; }
+  uint64_t due = anchor_us +
+      static_cast<uint64_t>((reply.at_ms - anchor_ms) * 1000.0 * time_scale);
+  return nowMicros() >= due;
+}
+
+/*
+ * Stream
+ */
+
+int TrafficReplay::available() {
+  if (!released()) { return 0; }
+  return replies[reply_idx].data.size() - reply_pos;
+}
+
+int TrafficReplay::read() {
+  if (!released()) { return -1; }
+  const std::string& data = replies[reply_idx].data;
+  uint8_t            c    = data[reply_pos++];
+  if (reply_pos >= data.size()) {
+    reply_idx++;
+    reply_pos = 0;
+  }
+  return c;
+}
+
+int TrafficReplay::peek() {
+  if (!released()) { return -1; }
+  return static_cast<uint8_t>(replies[reply_idx].data[reply_pos]);
+}
+
+size_t TrafficReplay::write(uint8_t c) {
+  if (tx_pos >= tx_data.size() || static_cast<uint8_t>(tx_data[tx_pos]) != c) {
+    if (first_mismatch < 0) { first_mismatch = tx_pos; }
+    mismatched++;
+  }
+  tx_pos++;
+  // The replies to a command are timed from when it was written
+  while (command_idx < commands.size() &&
+         commands[command_idx].tx_end <= tx_pos) {
+    anchor_us = nowMicros();
+    anchor_ms = commands[command_idx].at_ms;
+    command_idx++;
+  }
+  return 1;
+}
+
+size_t TrafficReplay::write(const uint8_t* buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) { write(buffer[i]); }
+  return size;
+}
+
+uint64_t TrafficReplay::nowMicros() {
+  // Widens the wrapping 32 bit micros()
+  uint32_t now = micros();
+  if (now < last_micros) { micros_high += 1ULL << 32; }
+  last_micros = now;
+  return micros_high + now;
+}
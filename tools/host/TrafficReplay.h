@@ -0,0 +1,109 @@
+/**
+ * @file       TrafficReplay.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * A Stream that plays a traffic log made by TinyGsmRecorder (or AT_Spy)
+ * back to a driver, in place of the modem.  The bytes the modem sent come
+ * out in the order they were recorded, each one only once the driver wrote
+ * as much as had gone to the modem before it, so a run of the same sketch
+ * sees the same answers to the same commands.  What the driver writes is
+ * checked against the log, to spot a run that went a different way; a
+ * driver polling on a timer can, as the poll may come due at another point
+ * of the run, and the replies after it then answer the wrong commands.
+ */
+
+#ifndef TrafficReplay_h
+#define TrafficReplay_h
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Stream.h"
+
+class TrafficReplay : public Stream {
+ public:
+  TrafficReplay();
+
+  bool load(const char* path);
+  // Parses a log already in memory
+  bool load(const uint8_t* data, size_t len);
+  // Starts over from the beginning of the log
+  void rewind();
+
+  // 1 keeps the recorded time between a command and the replies to it, 2
+  // halves it; 0, the default, hands out the replies as soon as the driver
+  // sent what came before them
+  void setTimeScale(float scale);
+
+  // Everything the modem sent was read
+  bool finished() const;
+  // Bytes the driver wrote that differ from the log, or go beyond it
+  uint32_t mismatches() const {
+    return mismatched;
+  }
+  // The offset into what went to the modem of the first mismatch, -1 while
+  // there is none
+  long firstMismatch() const {
+    return first_mismatch;
+  }
+  size_t bytesFromModem() const {
+    return rx_total;
+  }
+  size_t bytesToModem() const {
+    return tx_data.size();
+  }
+
+  /*
+   * Stream
+   */
+  int    available() override;
+  int    read() override;
+  int    peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override {}
+
+ protected:
+  // Bytes the modem sent
+  struct Reply {
+    uint32_t    at_ms;      // Time in the log
+    size_t      tx_before;  // Bytes that went to the modem before it
+    std::string data;
+  };
+
+  // A run of bytes to the modem, ending at tx_end in tx_data
+  struct Command {
+    uint32_t at_ms;
+    size_t   tx_end;
+  };
+
+  // Whether the reply at the cursor may be read yet
+  bool     released();
+  uint64_t nowMicros();
+
+  std::vector<Reply>   replies;
+  std::vector<Command> commands;
+  std::string          tx_data;  // Everything that went to the modem
+  size_t               rx_total;
+  float                time_scale;
+
+  size_t   reply_idx;  // The reply being read
+  size_t   reply_pos;  // Read position in it
+  size_t   tx_pos;     // Bytes the driver wrote so far
+  size_t   command_idx;
+  uint64_t anchor_us;  // When the last command was written in this run
+  uint32_t anchor_ms;  // And when in the log
+  uint32_t mismatched;
+  long     first_mismatch;
+
+  uint32_t last_micros;
+  uint64_t micros_high;
+};
+
+#endif  // TrafficReplay_h
@@ -0,0 +1,15 @@
+/**
+ * @file       Udp.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#ifndef HostUdp_h
+#define HostUdp_h
+
+// The UDP class is shared with the Hologram Dash build
+#include "ArduinoCompat/Udp.h"
+
+#endif  // HostUdp_h
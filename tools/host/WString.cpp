@@ -0,0 +1,500 @@
+/**
+ * @file       WString.cpp
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ */
+
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+namespace {
+void formatInteger(char* buf, unsigned long long value, unsigned char base,
+                   bool negative) {
+  char  tmp[8 * sizeof(value) + 2];
+  char* p = &tmp[sizeof(tmp) - 1];
+  *p      = '\0';
+  if (base < 2) base = 10;
+  do {
+    unsigned char d = value % base;
+    *--p            = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  strcpy(buf, p);  // NOLINT(runtime/printf)
+}
+
+void formatSigned(char* buf, long long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    formatInteger(buf, 0ULL - static_cast<unsigned long long>(value), base,
+                  true);
+  } else {
+    formatInteger(buf, static_cast<unsigned long long>(value), base, false);
+  }
+}
+}  // namespace
+
+/*
+ * Constructors
+ */
+
+String::String(const char* cstr) {
+  init();
+  *this = cstr;
+}
+
+String::String(const String& value) {
+  init();
+  *this = value;
+}
+
+String::String(String&& rval) {
+  buffer        = rval.buffer;
+  capacity      = rval.capacity;
+  len           = rval.len;
+  rval.buffer   = NULL;
+  rval.capacity = 0;
+  rval.len      = 0;
+  rval.changeBuffer(0);
+}
+
+String::String(const __FlashStringHelper* str) {
+  init();
+  *this = str;
+}
+
+String::String(char c) {
+  init();
+  char buf[2] = {c, 0};
+  *this       = buf;
+}
+
+String::String(unsigned char value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned char)];
+  formatInteger(buf, value, base, false);
+  *this = buf;
+}
+
+String::String(int value, unsigned char base) {
+  init();
+  char buf[2 + 8 * sizeof(int)];
+  formatSigned(buf, value, base);
+  *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned int)];
+  formatInteger(buf, value, base, false);
+  *this = buf;
+}
+
+String::String(long value, unsigned char base) {
+  init();
+  char buf[2 + 8 * sizeof(long)];
+  formatSigned(buf, value, base);
+  *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned long)];
+  formatInteger(buf, value, base, false);
+  *this = buf;
+}
+
+String::String(long long value, unsigned char base) {
+  init();
+  char buf[2 + 8 * sizeof(long long)];
+  formatSigned(buf, value, base);
+  *this = buf;
+}
+
+String::String(unsigned long long value, unsigned char base) {
+  init();
+  char buf[1 + 8 * sizeof(unsigned long long)];
+  formatInteger(buf, value, base, false);
+  *this = buf;
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+  init();
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  *this = buf;
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+  init();
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  *this = buf;
+}
+
+String::~String() {
+  free(buffer);
+}
+
+/*
+ * Memory management
+ */
+
+// Leaves the buffer unallocated, so the constructors must assign a value;
+// this keeps a String to one allocation, as on the boards
+void String::init(void) {
+  buffer   = NULL;
+  capacity = 0;
+  len      = 0;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buffer && capacity >= size) return true;
+  return changeBuffer(size);
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+  char* newbuffer = static_cast<char*>(realloc(buffer, maxStrLen + 1));
+  if (!newbuffer) return false;
+  if (!buffer) newbuffer[0] = '\0';
+  buffer   = newbuffer;
+  capacity = maxStrLen;
+  return true;
+}
+
+void String::copy(const char* cstr, unsigned int length) {
+  if (!reserve(length)) return;
+  len = length;
+  memmove(buffer, cstr, length);
+  buffer[len] = '\0';
+}
+
+/*
+ * Assignment
+ */
+
+String& String::operator=(const String& rhs) {
+  if (this == &rhs) return *this;
+  copy(rhs.buffer, rhs.len);
+  return *this;
+}
+
+String& String::operator=(String&& rval) {
+  if (this != &rval) {
+    free(buffer);
+    buffer        = rval.buffer;
+    capacity      = rval.capacity;
+    len           = rval.len;
+    rval.buffer   = NULL;
+    rval.capacity = 0;
+    rval.len      = 0;
+    rval.changeBuffer(0);
+  }
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  } else {
+    copy("", 0);
+  }
+  return *this;
+}
+
+String& String::operator=(const __FlashStringHelper* str) {
+  return *this = reinterpret_cast<const char*>(str);
+}
+
+/*
+ * Concatenation
+ */
+
+bool String::concat(const char* cstr, unsigned int length) {
+  unsigned int newlen = len + length;
+  if (!cstr) return false;
+  if (length == 0) return true;
+  if (newlen > capacity) {
+    // grow geometrically so repeated single character appends stay linear
+    unsigned int grow = capacity + (capacity >> 1);
+    if (!reserve(newlen > grow ? newlen : grow)) return false;
+  }
+  memmove(buffer + len, cstr, length);
+  len         = newlen;
+  buffer[len] = '\0';
+  return true;
+}
+
+bool String::concat(const String& s) {
+  return concat(s.buffer, s.len);
+}
+
+bool String::concat(const char* cstr) {
+  if (!cstr) return false;
+  return concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c) {
+  return concat(&c, 1);
+}
+
+bool String::concat(unsigned char num) {
+  return concat(String(num));
+}
+
+bool String::concat(int num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned int num) {
+  return concat(String(num));
+}
+
+bool String::concat(long num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned long num) {
+  return concat(String(num));
+}
+
+bool String::concat(long long num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned long long num) {
+  return concat(String(num));
+}
+
+bool String::concat(float num) {
+  return concat(String(num));
+}
+
+bool String::concat(double num) {
+  return concat(String(num));
+}
+
+bool String::concat(const __FlashStringHelper* str) {
+  return concat(reinterpret_cast<const char*>(str));
+}
+
+/*
+ * Comparison
+ */
+
+int String::compareTo(const String& s) const {
+  return strcmp(buffer, s.buffer);
+}
+
+bool String::equals(const String& s2) const {
+  return len == s2.len && compareTo(s2) == 0;
+}
+
+bool String::equals(const char* cstr) const {
+  if (!cstr) return len == 0;
+  return strcmp(buffer, cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& s2) const {
+  if (len != s2.len) return false;
+  for (unsigned int i = 0; i < len; i++) {
+    if (tolower(buffer[i]) != tolower(s2.buffer[i])) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String& s2) const {
+  if (len < s2.len) return false;
+  return startsWith(s2, 0);
+}
+
+bool String::startsWith(const String& s2, unsigned int offset) const {
+  if (offset > len - s2.len || len < s2.len) return false;
+  return strncmp(&buffer[offset], s2.buffer, s2.len) == 0;
+}
+
+bool String::endsWith(const String& s2) const {
+  if (len < s2.len) return false;
+  return strcmp(&buffer[len - s2.len], s2.buffer) == 0;
+}
+
+/*
+ * Character access
+ */
+
+char String::charAt(unsigned int loc) const {
+  return operator[](loc);
+}
+
+void String::setCharAt(unsigned int loc, char c) {
+  if (loc < len) buffer[loc] = c;
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy_writable_char;
+  if (index >= len) {
+    dummy_writable_char = 0;
+    return dummy_writable_char;
+  }
+  return buffer[index];
+}
+
+char String::operator[](unsigned int index) const {
+  if (index >= len) return 0;
+  return buffer[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize,
+                      unsigned int index) const {
+  if (!bufsize || !buf) return;
+  if (index >= len) {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = bufsize - 1;
+  if (n > len - index) n = len - index;
+  memcpy(buf, buffer + index, n);
+  buf[n] = 0;
+}
+
+/*
+ * Search
+ */
+
+int String::indexOf(char c) const {
+  return indexOf(c, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char* temp = strchr(buffer + fromIndex, ch);
+  if (temp == NULL) return -1;
+  return temp - buffer;
+}
+
+int String::indexOf(const String& s2) const {
+  return indexOf(s2, 0);
+}
+
+int String::indexOf(const String& s2, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char* found = strstr(buffer + fromIndex, s2.buffer);
+  if (found == NULL) return -1;
+  return found - buffer;
+}
+
+int String::lastIndexOf(char theChar) const {
+  return lastIndexOf(theChar, len - 1);
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  for (int i = fromIndex; i >= 0; i--) {
+    if (buffer[i] == ch) return i;
+  }
+  return -1;
+}
+
+int String::lastIndexOf(const String& s2) const {
+  return lastIndexOf(s2, len - s2.len);
+}
+
+int String::lastIndexOf(const String& s2, unsigned int fromIndex) const {
+  if (s2.len == 0 || len == 0 || s2.len > len) return -1;
+  if (fromIndex >= len) fromIndex = len - 1;
+  int found = -1;
+  for (const char* p = buffer; p <= buffer + fromIndex; p++) {
+    p = strstr(p, s2.buffer);
+    if (!p) break;
+    if (static_cast<unsigned int>(p - buffer) <= fromIndex) found = p - buffer;
+  }
+  return found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+  if (left > right) {
+    unsigned int temp = right;
+    right             = left;
+    left              = temp;
+  }
+  String out;
+  if (left >= len) return out;
+  if (right > len) right = len;
+  out.copy(buffer + left, right - left);
+  return out;
+}
+
+/*
+ * Modification
+ */
+
+void String::replace(char find, char replace) {
+  for (char* p = buffer; *p; p++) {
+    if (*p == find) *p = replace;
+  }
+}
+
+void String::replace(const String& find, const String& replace) {
+  if (len == 0 || find.len == 0) return;
+  String      out;
+  const char* readFrom = buffer;
+  const char* foundAt;
+  while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
+    out.concat(readFrom, foundAt - readFrom);
+    out.concat(replace);
+    readFrom = foundAt + find.len;
+  }
+  if (readFrom == buffer) return;
+  out.concat(readFrom);
+  *this = static_cast<String&&>(out);
+}
+
+void String::remove(unsigned int index) {
+  remove(index, static_cast<unsigned int>(-1));
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= len) return;
+  if (count > len - index) count = len - index;
+  memmove(buffer + index, buffer + index + count, len - index - count);
+  len -= count;
+  buffer[len] = 0;
+}
+
+void String::toLowerCase(void) {
+  for (char* p = buffer; *p; p++) *p = tolower(*p);
+}
+
+void String::toUpperCase(void) {
+  for (char* p = buffer; *p; p++) *p = toupper(*p);
+}
+
+void String::trim(void) {
+  if (len == 0) return;
+  char* begin = buffer;
+  while (isspace(*begin)) begin++;
+  char* end = buffer + len - 1;
+  while (isspace(*end) && end >= begin) end--;
+  len = end + 1 - begin;
+  if (begin > buffer) memmove(buffer, begin, len);
+  buffer[len] = 0;
+}
+
+/*
+ * Parsing / Conversion
+ */
+
+long String::toInt(void) const {
+  return atol(buffer);
+}
+
+float String::toFloat(void) const {
+  return static_cast<float>(toDouble());
+}
+
+double String::toDouble(void) const {
+  return atof(buffer);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file       WString.h
+ * @author     Volodymyr Shymanskyy
+ * @license    LGPL-3.0
+ * @copyright  Copyright (c) 2016 Volodymyr Shymanskyy
+ * @date       Oct 2026
+ *
+ * Heap backed String class mirroring the Arduino core API, for host builds.
+ */
+
+#ifndef String_class_h
+#define String_class_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+class __FlashStringHelper;
+#define F(string_literal) \
+  (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+class String {
+ public:
+  String(const char* cstr = "");
+  String(const String& str);
+  String(String&& rval);
+  explicit String(const __FlashStringHelper* str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  // memory management
+  bool reserve(unsigned int size);
+  inline unsigned int length(void) const {
+    return len;
+  }
+  inline bool isEmpty(void) const {
+    return len == 0;
+  }
+
+  // assignment
+  String& operator=(const String& rhs);
+  String& operator=(const char* cstr);
+  String& operator=(const __FlashStringHelper* str);
+  String& operator=(String&& rval);
+
+  // concatenation
+  bool concat(const String& str);
+  bool concat(const char* cstr);
+  bool concat(const char* cstr, unsigned int length);
+  bool concat(char c);
+  bool concat(unsigned char num);
+  bool concat(int num);
+  bool concat(unsigned int num);
+  bool concat(long num);
+  bool concat(unsigned long num);
+  bool concat(long long num);
+  bool concat(unsigned long long num);
+  bool concat(float num);
+  bool concat(double num);
+  bool concat(const __FlashStringHelper* str);
+
+  template <typename T>
+  String& operator+=(const T& rhs) {
+    concat(rhs);
+    return (*this);
+  }
+  String& operator+=(const char* cstr) {
+    concat(cstr);
+    return (*this);
+  }
+
+  template <typename T>
+  friend String operator+(const String& lhs, const T& rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+  }
+  friend String operator+(const String& lhs, const char* rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+  }
+  friend String operator+(const char* lhs, const String& rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+  }
+  friend String operator+(char lhs, const String& rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+  }
+
+  // comparison
+  int  compareTo(const String& s) const;
+  bool equals(const String& s) const;
+  bool equals(const char* cstr) const;
+  bool equalsIgnoreCase(const String& s) const;
+  bool operator==(const String& rhs) const {
+    return equals(rhs);
+  }
+  bool operator==(const char* cstr) const {
+    return equals(cstr);
+  }
+  bool operator!=(const String& rhs) const {
+    return !equals(rhs);
+  }
+  bool operator!=(const char* cstr) const {
+    return !equals(cstr);
+  }
+  bool operator<(const String& rhs) const {
+    return compareTo(rhs) < 0;
+  }
+  bool operator>(const String& rhs) const {
+    return compareTo(rhs) > 0;
+  }
+  bool operator<=(const String& rhs) const {
+    return compareTo(rhs) <= 0;
+  }
+  bool operator>=(const String& rhs) const {
+    return compareTo(rhs) >= 0;
+  }
+  bool startsWith(const String& prefix) const;
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const;
+
+  // character access
+  char  charAt(unsigned int index) const;
+  void  setCharAt(unsigned int index, char c);
+  char  operator[](unsigned int index) const;
+  char& operator[](unsigned int index);
+  void  getBytes(unsigned char* buf, unsigned int bufsize,
+                 unsigned int index = 0) const;
+  void  toCharArray(char* buf, unsigned int bufsize,
+                    unsigned int index = 0) const {
+    getBytes(reinterpret_cast<unsigned char*>(buf), bufsize, index);
+  }
+  const char* c_str() const {
+    return buffer;
+  }
+  char* begin() {
+    return buffer;
+  }
+  char* end() {
+    return buffer + len;
+  }
+
+  // search
+  int    indexOf(char ch) const;
+  int    indexOf(char ch, unsigned int fromIndex) const;
+  int    indexOf(const String& str) const;
+  int    indexOf(const String& str, unsigned int fromIndex) const;
+  int    lastIndexOf(char ch) const;
+  int    lastIndexOf(char ch, unsigned int fromIndex) const;
+  int    lastIndexOf(const String& str) const;
+  int    lastIndexOf(const String& str, unsigned int fromIndex) const;
+  String substring(unsigned int beginIndex) const {
+    return substring(beginIndex, len);
+  }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  // modification
+  void replace(char find, char replace);
+  void replace(const String& find, const String& replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase(void);
+  void toUpperCase(void);
+  void trim(void);
+
+  // parsing/conversion
+  long   toInt(void) const;
+  float  toFloat(void) const;
+  double toDouble(void) const;
+
+ protected:
+  char*        buffer;
+  unsigned int capacity;
+  unsigned int len;
+
+  void init(void);
+  bool changeBuffer(unsigned int maxStrLen);
+  void copy(const char* cstr, unsigned int length);
+};
+
+#endif  // String_class_h
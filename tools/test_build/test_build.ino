@@ -42,6 +42,12 @@ void loop() {
   modem.getLocalIP();
   modem.localIP();
 
+  // Test the getters that write into a buffer instead of a String
+  char buf[64];
+  modem.getModemInfo(buf, sizeof(buf));
+  modem.getModemName(buf, sizeof(buf));
+  modem.getLocalIP(buf, sizeof(buf));
+
 // Test the GPRS and SIM card functions
 #if defined(TINY_GSM_MODEM_HAS_GPRS)
   modem.simUnlock("1234");
@@ -55,6 +61,11 @@ void loop() {
   modem.gprsConnect("myAPN", "myAPNUser", "myAPNPass");
   modem.gprsDisconnect();
   modem.getOperator();
+
+  modem.getSimCCID(buf, sizeof(buf));
+  modem.getIMEI(buf, sizeof(buf));
+  modem.getIMSI(buf, sizeof(buf));
+  modem.getOperator(buf, sizeof(buf));
 #endif
 
 // Test WiFi Functions
@@ -63,7 +74,8 @@ void loop() {
   modem.networkDisconnect();
 #endif
 
-  // Test TCP functions
+// Test TCP functions
+#if defined(TINY_GSM_MODEM_HAS_TCP)
   modem.maintain();
   TinyGsmClient client;
   TinyGsmClient client2(modem);
@@ -91,6 +103,54 @@ void loop() {
 
   client.stop();
 
+  // Test the extended client functions
+  client.setPriority(1);
+  client.setDrainOnStop(false);
+  client.connect(server, 80);
+  TinyGsmIoVec iov[2] = {{resource, strlen(resource)}, {"\r\n\r\n", 4}};
+  client.writev(iov, 2);
+  client.find("\r\n\r\n");
+  client.readStringUntil('\n');
+  client.abort();
+#endif
+
+#if defined(TINY_GSM_MODEM_HAS_KEEPALIVE)
+  client.setKeepAlive(60);
+  client.setKeepAlive(60, 10, 3);
+#endif
+
+#if defined(TINY_GSM_MODEM_HAS_DNS)
+  IPAddress address;
+  modem.getHostByName(server, address);
+  modem.clearDnsCache();
+#endif
+
+#if defined(TINY_GSM_MODEM_HAS_SERVER)
+  TinyGsmServer listener(modem, 8080);
+  listener.begin();
+  if (listener.hasClient()) {
+    TinyGsmClient incoming;
+    listener.accept(incoming);
+    incoming.stop();
+  }
+  listener.end();
+#endif
+
+// Test UDP functions
+#if defined(TINY_GSM_MODEM_HAS_UDP)
+  TinyGsmUdp udp(modem);
+  udp.begin(5000);
+  udp.beginPacket("somewhere", 5000);
+  udp.write(reinterpret_cast<const uint8_t*>("ping"), 4);
+  udp.endPacket();
+  if (udp.parsePacket()) {
+    udp.read(reinterpret_cast<uint8_t*>(buf), sizeof(buf));
+    udp.remoteIP();
+    udp.remotePort();
+  }
+  udp.stop();
+#endif
+
 #if defined(TINY_GSM_MODEM_HAS_SSL)
   // modem.addCertificate();  // not yet impemented
   // modem.deleteCertificate();  // not yet impemented
@@ -136,6 +196,7 @@ void loop() {
 
 #if not defined(TINY_GSM_MODEM_XBEE) && not defined(TINY_GSM_MODEM_SARAR4)
   modem.sendUSSD("*111#");
+  modem.sendUSSD("*111#", buf, sizeof(buf));
 #endif
 
 #if not defined(TINY_GSM_MODEM_XBEE) && not defined(TINY_GSM_MODEM_M590) && \
@@ -168,6 +229,7 @@ void loop() {
 #if defined(TINY_GSM_MODEM_HAS_GPS) && not defined(__AVR_ATmega32U4__)
   modem.enableGPS();
   modem.getGPSraw();
+  modem.getGPSraw(buf, sizeof(buf));
   float latitude  = -9999;
   float longitude = -9999;
   float speed     = 0;
@@ -195,6 +257,7 @@ void loop() {
 // Test the Network time function
 #if defined(TINY_GSM_MODEM_HAS_TIME) && not defined(__AVR_ATmega32U4__)
   modem.getGSMDateTime(DATE_FULL);
+  modem.getGSMDateTime(DATE_FULL, buf, sizeof(buf));
   int   year3    = 0;
   int   month3   = 0;
   int   day3     = 0;